@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * End-to-end throughput benchmark.
+ *
+ * Builds a throwaway work directory with synthetic FFmpeg testsrc movies and
+ * background music, points config.json at the in-process mock services, runs
+ * run_generation() and prints per-stage timings from the metrics registry.
+ * No network access or real movie is needed, so runs are reproducible.
+ *
+ * With --procs N the movies are shared by N worker processes through a job
+ * directory (the same claim/lease protocol separate hosts use), to measure
+ * how throughput scales with the number of nodes.
+ */
+
+#include "generator.h"
+#include "metrics.h"
+#include "mock_server.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef struct {
+  const char *workdir;
+  int movies;
+  int duration_s;
+  const char *size;
+  int procs;
+} BenchOpts;
+
+static int sh(const char *fmt, ...) {
+  char cmd[4096];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(cmd, sizeof(cmd), fmt, ap);
+  va_end(ap);
+  return system(cmd);
+}
+
+static bool ensure_dir(const char *p) {
+  return mkdir(p, 0755) == 0 || errno == EEXIST;
+}
+
+static char *slurp(const char *path, size_t *len_out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (n < 0) { fclose(f); return NULL; }
+  char *buf = (char *)malloc((size_t)n + 1);
+  if (buf && fread(buf, 1, (size_t)n, f) != (size_t)n) { free(buf); buf = NULL; }
+  fclose(f);
+  if (buf) { buf[n] = 0; *len_out = (size_t)n; }
+  return buf;
+}
+
+static bool make_fixtures(const BenchOpts *o) {
+  if (!ensure_dir("movies") || !ensure_dir("backgroundmusic") || !ensure_dir("bench_assets")) return false;
+
+  for (int i = 1; i <= o->movies; i++) {
+    char path[256];
+    snprintf(path, sizeof(path), "movies/Bench Movie %d.mp4", i);
+    if (access(path, F_OK) == 0) continue;
+
+    fprintf(stderr, "[bench] generating %s (%ds, %s)\n", path, o->duration_s, o->size);
+    if (sh("ffmpeg -y -hide_banner -loglevel error "
+           "-f lavfi -i testsrc=duration=%d:size=%s:rate=24 "
+           "-f lavfi -i sine=frequency=330:duration=%d "
+           "-c:v libx264 -preset ultrafast -pix_fmt yuv420p -c:a aac -shortest '%s'",
+           o->duration_s, o->size, o->duration_s, path) != 0) {
+      return false;
+    }
+  }
+
+  if (access("backgroundmusic/bench_bgm.mp3", F_OK) != 0 &&
+      sh("ffmpeg -y -hide_banner -loglevel error -f lavfi -i sine=frequency=220:duration=180 "
+         "-c:a libmp3lame -b:a 128k backgroundmusic/bench_bgm.mp3") != 0) {
+    return false;
+  }
+
+  if (access("bench_assets/tts.mp3", F_OK) != 0 &&
+      sh("ffmpeg -y -hide_banner -loglevel error -f lavfi -i sine=frequency=550:duration=6 "
+         "-c:a libmp3lame -b:a 128k bench_assets/tts.mp3") != 0) {
+    return false;
+  }
+  return true;
+}
+
+static bool write_config(int port) {
+  FILE *f = fopen("config.json", "wb");
+  if (!f) return false;
+  fprintf(f,
+          "{\n"
+          "  \"open_api_key\": \"bench\",\n"
+          "  \"elevenlabs_api_key\": \"bench\",\n"
+          "  \"subf2m_base_url\": \"http://127.0.0.1:%d\",\n"
+          "  \"imsdb_base_url\": \"http://127.0.0.1:%d\",\n"
+          "  \"openai_base_url\": \"http://127.0.0.1:%d\",\n"
+          "  \"elevenlabs_base_url\": \"http://127.0.0.1:%d\"\n"
+          "}\n",
+          port, port, port, port);
+  fclose(f);
+  return true;
+}
+
+static void reset_outputs(void) {
+  /* The pipeline retires sources after a successful run; put them back first. */
+  sh("mkdir -p movies && for f in movies_retired/*.mp4; do [ -e \"$f\" ] && mv \"$f\" movies/; done; true");
+  sh("rm -rf output tiktok_output clips scripts movies_retired jobs");
+}
+
+static void report(double wall) {
+  printf("\n%-10s %8s %12s %12s\n", "stage", "count", "total_s", "mean_s");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    unsigned long long cnt = 0;
+    double sum = 0.0;
+    metrics_stage_totals((MetricsStage)s, &cnt, &sum);
+    printf("%-10s %8llu %12.3f %12.3f\n", metrics_stage_name((MetricsStage)s), cnt, sum,
+           cnt ? sum / (double)cnt : 0.0);
+  }
+
+  unsigned long long done   = metrics_counter_get(METRIC_MOVIES_PROCESSED);
+  unsigned long long failed = metrics_counter_get(METRIC_MOVIES_FAILED);
+  unsigned long long clips  = metrics_counter_get(METRIC_CLIPS_BUILT);
+  MockStats ms = mock_server_stats();
+
+  printf("\nmovies ok/failed : %llu / %llu\n", done, failed);
+  printf("clips built      : %llu\n", clips);
+  printf("http requests    : %llu (%llu bytes)\n",
+         metrics_counter_get(METRIC_HTTP_REQUESTS), metrics_counter_get(METRIC_BYTES_DOWNLOADED));
+  printf("mock hits        : subf2m=%lu imsdb=%lu openai=%lu tts=%lu 404=%lu\n",
+         ms.subf2m, ms.imsdb, ms.openai, ms.tts, ms.not_found);
+  printf("ffmpeg seconds   : %.3f\n", metrics_encode_seconds());
+  printf("wall seconds     : %.3f\n", wall);
+  if (done > 0) printf("seconds / movie  : %.3f\n", wall / (double)done);
+  if (clips > 0) printf("clips / minute   : %.2f\n", (double)clips * 60.0 / wall);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--workdir DIR] [--movies N] [--duration SECONDS] [--size WxH] [--procs N]\n",
+          argv0);
+}
+
+/* Forks procs workers that share the movies through jobs/; each exits with
+   the number of movies it finished. Returns the total. */
+static int run_processes(int procs) {
+  pid_t pids[64];
+  int started = 0;
+  for (int i = 0; i < procs && i < 64; i++) {
+    pid_t pid = fork();
+    if (pid < 0) break;
+    if (pid == 0) {
+      char node[32];
+      snprintf(node, sizeof(node), "bench-%d", i + 1);
+      GeneratorOptions opt;
+      generator_options_init(&opt);
+      opt.jobs_dir = "jobs";
+      opt.node = node;
+      run_generation_with(&opt);
+      unsigned long long done = metrics_counter_get(METRIC_MOVIES_PROCESSED);
+      _exit(done > 255 ? 255 : (int)done);
+    }
+    pids[started++] = pid;
+  }
+
+  int total = 0;
+  for (int i = 0; i < started; i++) {
+    int status = 0;
+    if (waitpid(pids[i], &status, 0) == pids[i] && WIFEXITED(status)) {
+      fprintf(stderr, "[bench] worker %d finished %d movie(s)\n", i + 1, WEXITSTATUS(status));
+      total += WEXITSTATUS(status);
+    }
+  }
+  return total;
+}
+
+int main(int argc, char **argv) {
+  BenchOpts o = { "_bench_work", 1, 600, "640x360", 1 };
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--workdir") == 0 && i + 1 < argc) o.workdir = argv[++i];
+    else if (strcmp(argv[i], "--movies") == 0 && i + 1 < argc) o.movies = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) o.duration_s = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) o.size = argv[++i];
+    else if (strcmp(argv[i], "--procs") == 0 && i + 1 < argc) o.procs = atoi(argv[++i]);
+    else { usage(argv[0]); return 2; }
+  }
+  if (o.movies < 1) o.movies = 1;
+  if (o.duration_s < 120) o.duration_s = 120;
+  if (o.procs < 1) o.procs = 1;
+  if (o.procs > 64) o.procs = 64;
+
+  if (!ensure_dir(o.workdir) || chdir(o.workdir) != 0) {
+    fprintf(stderr, "[bench] cannot use workdir %s\n", o.workdir);
+    return 1;
+  }
+
+  reset_outputs();
+  if (!make_fixtures(&o)) {
+    fprintf(stderr, "[bench] fixture generation failed (is ffmpeg with libx264/libmp3lame installed?)\n");
+    return 1;
+  }
+
+  size_t tts_len = 0;
+  char *tts = slurp("bench_assets/tts.mp3", &tts_len);
+  if (!tts) return 1;
+
+  MockConfig mc = { o.duration_s, tts, tts_len };
+  int port = mock_server_start(&mc);
+  if (port <= 0) {
+    fprintf(stderr, "[bench] mock server failed to start\n");
+    free(tts);
+    return 1;
+  }
+  fprintf(stderr, "[bench] mock services on http://127.0.0.1:%d\n", port);
+
+  if (!write_config(port)) {
+    mock_server_stop();
+    free(tts);
+    return 1;
+  }
+
+  if (o.procs > 1) {
+    double t0 = metrics_now();
+    int done = run_processes(o.procs);
+    double wall = metrics_now() - t0;
+    MockStats ms = mock_server_stats();
+    mock_server_stop();
+
+    printf("\nprocesses        : %d\n", o.procs);
+    printf("movies done      : %d / %d\n", done, o.movies);
+    printf("mock hits        : subf2m=%lu imsdb=%lu openai=%lu tts=%lu 404=%lu\n",
+           ms.subf2m, ms.imsdb, ms.openai, ms.tts, ms.not_found);
+    printf("wall seconds     : %.3f\n", wall);
+    if (done > 0) printf("seconds / movie  : %.3f\n", wall / (double)done);
+    free(tts);
+    return done == o.movies ? 0 : 1;
+  }
+
+  double t0 = metrics_now();
+  run_generation();
+  double wall = metrics_now() - t0;
+
+  mock_server_stop();
+  report(wall);
+  free(tts);
+  return metrics_counter_get(METRIC_MOVIES_PROCESSED) == (unsigned long long)o.movies ? 0 : 1;
+}
@@ -0,0 +1,319 @@
+#define _POSIX_C_SOURCE 200809L
+
+/*
+ * Micro-benchmarks for the text-processing hot paths.
+ *
+ * Each case runs over a representative corpus (multi-MB SRT, IMSDb-style page,
+ * large clip-plan JSON) until --min-time has elapsed and reports MB/s and heap
+ * allocations per call. Allocation counting needs the GNU ld --wrap options set
+ * up in CMakeLists.txt (BENCH_COUNT_ALLOCS); elsewhere it prints "n/a".
+ */
+
+#include "htmlscan.h"
+#include "jsonw.h"
+#include "metrics.h"
+#include "plan.h"
+#include "textproc.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cJSON.h"
+
+/* ------------------------ allocation counting ------------------------ */
+
+static unsigned long long g_allocs = 0;
+
+#ifdef BENCH_COUNT_ALLOCS
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t a, size_t b);
+void *__real_realloc(void *p, size_t n);
+char *__real_strdup(const char *s);
+
+void *__wrap_malloc(size_t n) { g_allocs++; return __real_malloc(n); }
+void *__wrap_calloc(size_t a, size_t b) { g_allocs++; return __real_calloc(a, b); }
+void *__wrap_realloc(void *p, size_t n) { g_allocs++; return __real_realloc(p, n); }
+char *__wrap_strdup(const char *s) { g_allocs++; return __real_strdup(s); }
+
+/* cJSON may be a shared library, so route its allocator through the counter too. */
+static void *counting_malloc(size_t n) { return __wrap_malloc(n); }
+static void install_cjson_hooks(void) {
+  cJSON_Hooks h = { counting_malloc, free };
+  cJSON_InitHooks(&h);
+}
+#else
+static void install_cjson_hooks(void) {}
+#endif
+
+/* ------------------------ corpora ------------------------ */
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} Corpus;
+
+static void corpus_put(Corpus *c, const char *s, size_t n) {
+  if (c->len + n + 1 > c->cap) {
+    size_t cap = c->cap ? c->cap : 1 << 16;
+    while (c->len + n + 1 > cap) cap *= 2;
+    c->data = (char *)realloc(c->data, cap);
+    if (!c->data) { fprintf(stderr, "OOM\n"); exit(1); }
+    c->cap = cap;
+  }
+  memcpy(c->data + c->len, s, n);
+  c->len += n;
+  c->data[c->len] = 0;
+}
+
+static void corpus_puts(Corpus *c, const char *s) { corpus_put(c, s, strlen(s)); }
+
+static bool corpus_load(Corpus *c, const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  char tmp[65536];
+  size_t n;
+  while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0) corpus_put(c, tmp, n);
+  fclose(f);
+  return c->len > 0;
+}
+
+/* Dialogue-heavy SRT with italics, multi-byte UTF-8 and the odd Latin-1 byte. */
+static void make_srt(Corpus *c, size_t target) {
+  static const char *lines[] = {
+    "<i>Where were you last night?</i>\n",
+    "I told you already \xE2\x80\x94 I was at the caf\xC3\xA9.\n",
+    "Nobody believes that, not even Andr\xE9.\n",
+    "- Move! Move!\n- Get down!\n",
+    "\xE2\x99\xAA Soft music playing \xE2\x99\xAA\n",
+    "The money's gone. All of it.\n",
+  };
+  char cue[128];
+  int idx = 1;
+  while (c->len < target) {
+    int a = idx * 3;
+    int b = a + 2;
+    snprintf(cue, sizeof(cue), "%d\n%02d:%02d:%02d,250 --> %02d:%02d:%02d,900\n",
+             idx, a / 3600, (a / 60) % 60, a % 60, b / 3600, (b / 60) % 60, b % 60);
+    corpus_puts(c, cue);
+    corpus_puts(c, lines[idx % 6]);
+    corpus_puts(c, "\n");
+    idx++;
+  }
+}
+
+/* IMSDb-like page: navigation chrome, then a long <pre> block of screenplay. */
+static void make_page(Corpus *c, size_t target) {
+  corpus_puts(c, "<html><head><title>Script</title><script>var x = 1;</script></head><body>\n");
+  for (int i = 0; i < 200; i++) {
+    corpus_puts(c, "<a href=\"/genre/Drama\">Drama</a> <a href=\"/alphabetical/A\">A</a>\n");
+  }
+  corpus_puts(c, "<table><tr><td class=\"scrtext\">\n<pre>\n");
+  int scene = 1;
+  char buf[512];
+  while (c->len + 64 < target) {
+    snprintf(buf, sizeof(buf),
+             "<b>INT. APARTMENT - NIGHT (%d)</b><br>\n"
+             "Rain hammers the window. She crosses to the desk &amp; opens a drawer.<br>\n"
+             "<b>                    DETECTIVE</b><br>\n"
+             "          You&nbsp;knew &lt;exactly&gt; what was in it.<br>\n\n",
+             scene++);
+    corpus_puts(c, buf);
+  }
+  corpus_puts(c, "</pre>\n</td></tr></table></body></html>\n");
+}
+
+static void make_plan(Corpus *c, int clips) {
+  corpus_puts(c, "{\"clips\":[");
+  char buf[512];
+  for (int i = 0; i < clips; i++) {
+    snprintf(buf, sizeof(buf),
+             "%s{\"start\":%d,\"end\":%d,\"narration\":\"Clip %d: the crew regroups, "
+             "tempers flare, and a \\\"simple\\\" job turns into something else entirely.\"}",
+             i ? "," : "", 100 + i * 20, 112 + i * 20, i + 1);
+    corpus_puts(c, buf);
+  }
+  corpus_puts(c, "]}");
+}
+
+/* ------------------------ harness ------------------------ */
+
+typedef struct {
+  const Corpus *srt;
+  const Corpus *page;
+  const Corpus *plan;
+  const char *srt_in_path;
+  const char *srt_out_path;
+  const char *pre_start;
+  size_t pre_len;
+} Ctx;
+
+typedef size_t (*BenchFn)(const Ctx *ctx);
+
+static double g_min_time = 1.0;
+
+static void run_case(const char *name, BenchFn fn, const Ctx *ctx) {
+  /* warm-up */
+  size_t bytes = fn(ctx);
+
+  unsigned long long a0 = g_allocs;
+  unsigned long iters = 0;
+  double t0 = metrics_now();
+  double el = 0.0;
+  do {
+    fn(ctx);
+    iters++;
+    el = metrics_now() - t0;
+  } while (el < g_min_time);
+  unsigned long long allocs = g_allocs - a0;
+
+  double mb = (double)bytes / (1024.0 * 1024.0);
+  char alloc_s[32];
+#ifdef BENCH_COUNT_ALLOCS
+  snprintf(alloc_s, sizeof(alloc_s), "%.1f", (double)allocs / (double)iters);
+#else
+  (void)allocs;
+  snprintf(alloc_s, sizeof(alloc_s), "n/a");
+#endif
+  printf("%-34s %9.2f %8lu %10.3f %10.1f %12s\n",
+         name, mb, iters, el * 1000.0 / (double)iters, mb * (double)iters / el, alloc_s);
+  fflush(stdout);
+}
+
+static size_t b_sanitize(const Ctx *c) {
+  free(sanitize_utf8_lossy(c->srt->data));
+  return c->srt->len;
+}
+
+static size_t b_trim(const Ctx *c) {
+  free(trim_copy_utf8_safe(c->srt->data, 320000));
+  return c->srt->len;
+}
+
+/* The OpenAI request path: sanitize + trim + escape into one body buffer. */
+static size_t b_json_body(const Ctx *c) {
+  JsonWriter w;
+  jw_init(&w, 320000 + 320000 / 8);
+  jw_object_begin(&w);
+  jw_key(&w, "content");
+  jw_string_begin(&w);
+  jw_string_append_lossy(&w, c->srt->data, c->srt->len, 320000);
+  jw_string_end(&w);
+  jw_object_end(&w);
+  jw_free(&w);
+  return c->srt->len < 320000 ? c->srt->len : 320000;
+}
+
+static size_t b_html(const Ctx *c) {
+  size_t n = 0;
+  free(html_to_text_basic(c->pre_start, c->pre_len, &n));
+  return c->pre_len;
+}
+
+/* Whole page through the streaming scanner in 16 KB chunks, as curl delivers it. */
+static size_t b_html_scan(const Ctx *c) {
+  HtmlScan scan;
+  html_scan_init(&scan, NULL, NULL, true);
+  for (size_t off = 0; off < c->page->len; off += 16384) {
+    size_t n = c->page->len - off < 16384 ? c->page->len - off : 16384;
+    if (!html_scan_feed(&scan, c->page->data + off, n)) break;
+  }
+  free(html_scan_take_script(&scan, NULL));
+  html_scan_free(&scan);
+  return c->page->len;
+}
+
+static size_t b_strcasestr_hit(const Ctx *c) {
+  volatile char *p = strcasestr_local(c->page->data, "</PRE>");
+  (void)p;
+  return c->page->len;
+}
+
+static size_t b_strcasestr_miss(const Ctx *c) {
+  volatile char *p = strcasestr_local(c->page->data, "class='nope'");
+  (void)p;
+  return c->page->len;
+}
+
+static size_t b_srt_convert(const Ctx *c) {
+  convert_srt_timestamps_to_seconds(c->srt_in_path, c->srt_out_path);
+  return c->srt->len;
+}
+
+static size_t b_plan(const Ctx *c) {
+  ClipPlanList l = parse_clip_plan_json(c->plan->data);
+  free_clip_plan_list(&l);
+  return c->plan->len;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--min-time SECONDS] [--srt FILE] [--html FILE] [--plan FILE]\n"
+          "  defaults: synthetic 8 MB SRT, 2 MB IMSDb page, 20000-clip plan\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *srt_path = NULL, *html_path = NULL, *plan_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) g_min_time = atof(argv[++i]);
+    else if (strcmp(argv[i], "--srt") == 0 && i + 1 < argc) srt_path = argv[++i];
+    else if (strcmp(argv[i], "--html") == 0 && i + 1 < argc) html_path = argv[++i];
+    else if (strcmp(argv[i], "--plan") == 0 && i + 1 < argc) plan_path = argv[++i];
+    else { usage(argv[0]); return 2; }
+  }
+  if (g_min_time <= 0.0) g_min_time = 0.1;
+
+  install_cjson_hooks();
+
+  Corpus srt = {0}, page = {0}, plan = {0};
+  if (srt_path ? !corpus_load(&srt, srt_path) : (make_srt(&srt, 8u << 20), false)) {
+    fprintf(stderr, "cannot read %s\n", srt_path);
+    return 1;
+  }
+  if (html_path ? !corpus_load(&page, html_path) : (make_page(&page, 2u << 20), false)) {
+    fprintf(stderr, "cannot read %s\n", html_path);
+    return 1;
+  }
+  if (plan_path ? !corpus_load(&plan, plan_path) : (make_plan(&plan, 20000), false)) {
+    fprintf(stderr, "cannot read %s\n", plan_path);
+    return 1;
+  }
+
+  Ctx ctx = { &srt, &page, &plan, "bench_text_in.srt", "bench_text_out.srt", page.data, page.len };
+  const char *pre = strcasestr_local(page.data, "<pre");
+  const char *pend = pre ? strcasestr_local(pre, "</pre>") : NULL;
+  if (pre && pend) {
+    ctx.pre_start = pre;
+    ctx.pre_len = (size_t)(pend - pre);
+  }
+
+  FILE *f = fopen(ctx.srt_in_path, "wb");
+  if (!f || fwrite(srt.data, 1, srt.len, f) != srt.len) {
+    fprintf(stderr, "cannot write %s\n", ctx.srt_in_path);
+    return 1;
+  }
+  fclose(f);
+
+  printf("utf8 scanner: %s (override with TEXTPROC_SIMD=scalar|sse2|avx2)\n\n", textproc_simd_level());
+  printf("%-34s %9s %8s %10s %10s %12s\n", "case", "input_MB", "iters", "ms/call", "MB/s", "allocs/call");
+  run_case("sanitize_utf8_lossy(srt)", b_sanitize, &ctx);
+  run_case("trim_copy_utf8_safe(srt, 320000)", b_trim, &ctx);
+  run_case("jw_string_append_lossy(srt, 320000)", b_json_body, &ctx);
+  run_case("html_to_text_basic(pre block)", b_html, &ctx);
+  run_case("html_scan(page, 16K chunks)", b_html_scan, &ctx);
+  run_case("strcasestr_local(page, hit@end)", b_strcasestr_hit, &ctx);
+  run_case("strcasestr_local(page, miss)", b_strcasestr_miss, &ctx);
+  run_case("convert_srt_timestamps_to_seconds", b_srt_convert, &ctx);
+  run_case("parse_clip_plan_json", b_plan, &ctx);
+
+  unlink(ctx.srt_in_path);
+  unlink(ctx.srt_out_path);
+  free(srt.data);
+  free(page.data);
+  free(plan.data);
+  return 0;
+}
@@ -0,0 +1,391 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "mock_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cJSON.h"
+
+static MockConfig g_cfg;
+static int g_listen_fd = -1;
+static atomic_int g_stop;
+static pthread_t g_thread;
+static bool g_running = false;
+
+static atomic_ulong g_hits_subf2m, g_hits_imsdb, g_hits_openai, g_hits_tts, g_hits_404;
+
+/* ------------------------ small buffer ------------------------ */
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} Buf;
+
+static void buf_reserve(Buf *b, size_t extra) {
+  if (b->len + extra + 1 <= b->cap) return;
+  size_t cap = b->cap ? b->cap : 4096;
+  while (cap < b->len + extra + 1) cap *= 2;
+  char *p = (char *)realloc(b->data, cap);
+  if (!p) { fprintf(stderr, "mock: OOM\n"); exit(1); }
+  b->data = p;
+  b->cap = cap;
+}
+
+static void buf_put(Buf *b, const void *p, size_t n) {
+  buf_reserve(b, n);
+  memcpy(b->data + b->len, p, n);
+  b->len += n;
+  b->data[b->len] = 0;
+}
+
+static void buf_printf(Buf *b, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0) return;
+  buf_reserve(b, (size_t)n);
+  va_start(ap, fmt);
+  vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  b->len += (size_t)n;
+}
+
+static void put_u16(Buf *b, unsigned v) {
+  unsigned char x[2] = { (unsigned char)(v & 0xFF), (unsigned char)((v >> 8) & 0xFF) };
+  buf_put(b, x, 2);
+}
+
+static void put_u32(Buf *b, unsigned long v) {
+  unsigned char x[4] = {
+    (unsigned char)(v & 0xFF), (unsigned char)((v >> 8) & 0xFF),
+    (unsigned char)((v >> 16) & 0xFF), (unsigned char)((v >> 24) & 0xFF)
+  };
+  buf_put(b, x, 4);
+}
+
+/* ------------------------ canned content ------------------------ */
+
+static unsigned long crc32_bytes(const unsigned char *p, size_t n) {
+  static unsigned long table[256];
+  static int init = 0;
+  if (!init) {
+    for (unsigned long i = 0; i < 256; i++) {
+      unsigned long c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    init = 1;
+  }
+  unsigned long c = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < n; i++) c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFUL;
+}
+
+/* One cue every 4 seconds across the movie, like a dense dialogue track. */
+static void make_srt(Buf *out) {
+  int idx = 1;
+  for (int t = 2; t + 3 < g_cfg.movie_duration_s; t += 4, idx++) {
+    int a = t, b = t + 3;
+    buf_printf(out,
+               "%d\n%02d:%02d:%02d,000 --> %02d:%02d:%02d,500\n"
+               "<i>Line %d:</i> the detective studies the evidence and says something important.\n\n",
+               idx, a / 3600, (a / 60) % 60, a % 60, b / 3600, (b / 60) % 60, b % 60, idx);
+  }
+}
+
+/* Single stored (uncompressed) entry, which every unzip implementation accepts. */
+static void make_zip(Buf *out, const char *name, const Buf *content) {
+  size_t name_len = strlen(name);
+  unsigned long crc = crc32_bytes((const unsigned char *)content->data, content->len);
+
+  put_u32(out, 0x04034b50UL);
+  put_u16(out, 20); put_u16(out, 0); put_u16(out, 0);
+  put_u16(out, 0); put_u16(out, 0x21);
+  put_u32(out, crc);
+  put_u32(out, (unsigned long)content->len);
+  put_u32(out, (unsigned long)content->len);
+  put_u16(out, (unsigned)name_len); put_u16(out, 0);
+  buf_put(out, name, name_len);
+  buf_put(out, content->data, content->len);
+
+  size_t cd_off = out->len;
+  put_u32(out, 0x02014b50UL);
+  put_u16(out, 20); put_u16(out, 20); put_u16(out, 0); put_u16(out, 0);
+  put_u16(out, 0); put_u16(out, 0x21);
+  put_u32(out, crc);
+  put_u32(out, (unsigned long)content->len);
+  put_u32(out, (unsigned long)content->len);
+  put_u16(out, (unsigned)name_len); put_u16(out, 0); put_u16(out, 0);
+  put_u16(out, 0); put_u16(out, 0); put_u32(out, 0);
+  put_u32(out, 0);
+  buf_put(out, name, name_len);
+  size_t cd_len = out->len - cd_off;
+
+  put_u32(out, 0x06054b50UL);
+  put_u16(out, 0); put_u16(out, 0); put_u16(out, 1); put_u16(out, 1);
+  put_u32(out, (unsigned long)cd_len);
+  put_u32(out, (unsigned long)cd_off);
+  put_u16(out, 0);
+}
+
+static void make_script_page(Buf *out, const char *title) {
+  buf_printf(out, "<html><head><title>%s Script</title></head><body>\n"
+                  "<table><tr><td class=\"scrtext\">\n<pre>\n", title);
+  for (int scene = 1; scene <= 400; scene++) {
+    buf_printf(out,
+               "<b>INT. WAREHOUSE - NIGHT (SCENE %d)</b><br>\n"
+               "The DETECTIVE moves between the crates &amp; listens.<br>\n"
+               "<b>DETECTIVE</b><br>\nWe&nbsp;are running out of time.<br>\n\n",
+               scene);
+  }
+  buf_printf(out, "</pre>\n</td></tr></table></body></html>\n");
+}
+
+static int requested_clip_count(const char *body) {
+  const char *p = body ? strstr(body, "Choose ") : NULL;
+  int n = p ? atoi(p + 7) : 0;
+  if (n <= 0) n = 20;
+  return n;
+}
+
+static void make_openai_response(Buf *out, const char *req_body) {
+  int n = requested_clip_count(req_body);
+  int span = g_cfg.movie_duration_s - 20;
+  int step = span / n;
+  if (step < 2) step = 2;
+  int len = step > 12 ? 12 : step - 1;
+  if (len < 1) len = 1;
+
+  cJSON *plan = cJSON_CreateObject();
+  cJSON *clips = cJSON_AddArrayToObject(plan, "clips");
+  for (int i = 0; i < n; i++) {
+    int start = 10 + i * step;
+    if (start + len >= g_cfg.movie_duration_s) break;
+
+    char nar[256];
+    snprintf(nar, sizeof(nar),
+             "Clip %d moves the story forward. The detective finds another clue. "
+             "Nobody expected what happens next.", i + 1);
+
+    cJSON *c = cJSON_CreateObject();
+    cJSON_AddNumberToObject(c, "start", start);
+    cJSON_AddNumberToObject(c, "end", start + len);
+    cJSON_AddStringToObject(c, "narration", nar);
+    cJSON_AddItemToArray(clips, c);
+  }
+  char *plan_txt = cJSON_PrintUnformatted(plan);
+  cJSON_Delete(plan);
+
+  cJSON *root = cJSON_CreateObject();
+  cJSON *output = cJSON_AddArrayToObject(root, "output");
+  cJSON *msg = cJSON_CreateObject();
+  cJSON *content = cJSON_AddArrayToObject(msg, "content");
+  cJSON *part = cJSON_CreateObject();
+  cJSON_AddStringToObject(part, "type", "output_text");
+  cJSON_AddStringToObject(part, "text", plan_txt ? plan_txt : "{}");
+  cJSON_AddItemToArray(content, part);
+  cJSON_AddItemToArray(output, msg);
+  char *txt = cJSON_PrintUnformatted(root);
+  cJSON_Delete(root);
+
+  if (txt) buf_put(out, txt, strlen(txt));
+  cJSON_free(txt);
+  cJSON_free(plan_txt);
+}
+
+/* ------------------------ HTTP plumbing ------------------------ */
+
+static void send_all(int fd, const void *p, size_t n) {
+  const char *c = (const char *)p;
+  while (n > 0) {
+    ssize_t w = send(fd, c, n, 0);
+    if (w <= 0) return;
+    c += w;
+    n -= (size_t)w;
+  }
+}
+
+static void respond(int fd, int code, const char *ctype, const void *body, size_t n) {
+  char hdr[256];
+  int hn = snprintf(hdr, sizeof(hdr),
+                    "HTTP/1.1 %d %s\r\n"
+                    "Content-Type: %s\r\n"
+                    "Content-Length: %zu\r\n"
+                    "Connection: close\r\n\r\n",
+                    code, code == 200 ? "OK" : "Not Found", ctype, n);
+  send_all(fd, hdr, (size_t)hn);
+  if (n) send_all(fd, body, n);
+}
+
+static bool read_request(int fd, Buf *req, size_t *hdr_end_out) {
+  char tmp[8192];
+  size_t hdr_end = 0;
+  size_t want = 0;
+
+  for (;;) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 5000) <= 0) return false;
+    ssize_t r = recv(fd, tmp, sizeof(tmp), 0);
+    if (r <= 0) return hdr_end != 0 && req->len >= want;
+    buf_put(req, tmp, (size_t)r);
+
+    if (!hdr_end) {
+      char *e = strstr(req->data, "\r\n\r\n");
+      if (!e) continue;
+      hdr_end = (size_t)(e - req->data) + 4;
+
+      size_t clen = 0;
+      for (char *h = req->data; h && h < e; h = strstr(h, "\r\n")) {
+        if (*h == '\r') h += 2;
+        if (strncasecmp(h, "Content-Length:", 15) == 0) clen = (size_t)strtoul(h + 15, NULL, 10);
+      }
+      want = hdr_end + clen;
+    }
+    if (req->len >= want) break;
+  }
+
+  *hdr_end_out = hdr_end;
+  return true;
+}
+
+static void handle(int fd) {
+  Buf req = {0};
+  size_t hdr_end = 0;
+  if (!read_request(fd, &req, &hdr_end)) { free(req.data); return; }
+
+  char method[8] = {0}, path[2048] = {0};
+  sscanf(req.data, "%7s %2047s", method, path);
+  const char *body = req.data + hdr_end;
+
+  Buf out = {0};
+  const char *ctype = "text/html";
+  int code = 200;
+
+  char *q = strchr(path, '?');
+  if (q) *q = 0;
+
+  if (strncmp(path, "/subtitles/", 11) == 0) {
+    atomic_fetch_add(&g_hits_subf2m, 1);
+    const char *slug = path + 11;
+    const char *slash = strchr(slug, '/');
+    int slug_len = slash ? (int)(slash - slug) : (int)strlen(slug);
+
+    size_t plen = strlen(path);
+    if (plen > 9 && strcmp(path + plen - 9, "/download") == 0) {
+      Buf srt = {0};
+      make_srt(&srt);
+      char name[600];
+      snprintf(name, sizeof(name), "%.*s.srt", slug_len, slug);
+      make_zip(&out, name, &srt);
+      free(srt.data);
+      ctype = "application/zip";
+    } else if (plen > 8 && strcmp(path + plen - 8, "/english") == 0) {
+      buf_printf(&out, "<html><body><ul>\n"
+                       "<li><a href=\"/u/uploader\">uploader</a></li>\n"
+                       "<li><a href=\"/subtitles/%.*s/english/1000001\">English subtitle</a></li>\n"
+                       "</ul></body></html>\n", slug_len, slug);
+    } else {
+      buf_printf(&out, "<html><body><a class=\"download\" href=\"%s/download\">Download</a></body></html>\n", path);
+    }
+  } else if (strncmp(path, "/scripts/", 9) == 0 || strncmp(path, "/Movie%20Scripts/", 17) == 0) {
+    atomic_fetch_add(&g_hits_imsdb, 1);
+    make_script_page(&out, path);
+  } else if (strcmp(method, "POST") == 0 && strcmp(path, "/v1/responses") == 0) {
+    atomic_fetch_add(&g_hits_openai, 1);
+    make_openai_response(&out, body);
+    ctype = "application/json";
+  } else if (strcmp(method, "POST") == 0 && strncmp(path, "/v1/text-to-speech/", 19) == 0) {
+    atomic_fetch_add(&g_hits_tts, 1);
+    buf_put(&out, g_cfg.tts_mp3, g_cfg.tts_mp3_len);
+    ctype = "audio/mpeg";
+  } else {
+    atomic_fetch_add(&g_hits_404, 1);
+    buf_printf(&out, "not found\n");
+    code = 404;
+  }
+
+  respond(fd, code, ctype, out.data, out.len);
+  free(out.data);
+  free(req.data);
+}
+
+static void *server_main(void *p) {
+  (void)p;
+  while (!atomic_load(&g_stop)) {
+    struct pollfd pfd = { g_listen_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 200) <= 0) continue;
+    int cfd = accept(g_listen_fd, NULL, NULL);
+    if (cfd < 0) continue;
+    handle(cfd);
+    close(cfd);
+  }
+  return NULL;
+}
+
+int mock_server_start(const MockConfig *cfg) {
+  if (g_running || !cfg) return -1;
+  g_cfg = *cfg;
+  if (g_cfg.movie_duration_s < 60) g_cfg.movie_duration_s = 60;
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = 0;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  socklen_t alen = sizeof(addr);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 64) != 0 ||
+      getsockname(fd, (struct sockaddr *)&addr, &alen) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  g_listen_fd = fd;
+  atomic_store(&g_stop, 0);
+  if (pthread_create(&g_thread, NULL, server_main, NULL) != 0) {
+    close(fd);
+    g_listen_fd = -1;
+    return -1;
+  }
+  g_running = true;
+  return (int)ntohs(addr.sin_port);
+}
+
+void mock_server_stop(void) {
+  if (!g_running) return;
+  atomic_store(&g_stop, 1);
+  pthread_join(g_thread, NULL);
+  close(g_listen_fd);
+  g_listen_fd = -1;
+  g_running = false;
+}
+
+MockStats mock_server_stats(void) {
+  MockStats s;
+  s.subf2m    = atomic_load(&g_hits_subf2m);
+  s.imsdb     = atomic_load(&g_hits_imsdb);
+  s.openai    = atomic_load(&g_hits_openai);
+  s.tts       = atomic_load(&g_hits_tts);
+  s.not_found = atomic_load(&g_hits_404);
+  return s;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Local stand-in for subf2m, IMSDb, the OpenAI Responses API and ElevenLabs.
+// Every response is deterministic so benchmark runs are comparable.
+
+typedef struct {
+  int movie_duration_s;      // used to place subtitle cues and plan ranges
+  const void *tts_mp3;       // bytes returned for every text-to-speech request
+  size_t tts_mp3_len;
+} MockConfig;
+
+// Starts serving on 127.0.0.1 with an ephemeral port; returns the port or -1.
+int  mock_server_start(const MockConfig *cfg);
+void mock_server_stop(void);
+
+// Requests served so far, by route family.
+typedef struct {
+  unsigned long subf2m;
+  unsigned long imsdb;
+  unsigned long openai;
+  unsigned long tts;
+  unsigned long not_found;
+} MockStats;
+
+MockStats mock_server_stats(void);
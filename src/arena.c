@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "arena.h"
+#include "log.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #define ARENA_TLS __declspec(thread)
+#else
+  #define ARENA_TLS _Thread_local
+#endif
+
+#define ARENA_ALIGN 16u
+
+typedef struct Block {
+  struct Block *next;
+  size_t cap;
+  size_t used;
+  size_t pad_;              /* keeps data[] 16-byte aligned on 64-bit targets */
+  unsigned char data[];
+} Block;
+
+struct Arena {
+  Block *first;             /* kept across resets */
+  Block *cur;               /* block being bumped */
+  Block *big;               /* dedicated blocks for oversized requests */
+  size_t block_size;
+  size_t used;
+  size_t reserved;
+};
+
+static size_t align_up(size_t n) {
+  return (n + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static Block *block_new(size_t cap) {
+  Block *b = (Block *)malloc(sizeof(Block) + cap);
+  if (!b) die("OOM");
+  b->next = NULL;
+  b->cap = cap;
+  b->used = 0;
+  return b;
+}
+
+static void free_chain(Block *b) {
+  while (b) {
+    Block *next = b->next;
+    free(b);
+    b = next;
+  }
+}
+
+Arena *arena_new(size_t block_size) {
+  Arena *a = (Arena *)calloc(1, sizeof(*a));
+  if (!a) die("OOM");
+  a->block_size = align_up(block_size < 4096 ? 4096 : block_size);
+  a->first = a->cur = block_new(a->block_size);
+  a->reserved = a->block_size;
+  return a;
+}
+
+void arena_free(Arena *a) {
+  if (!a) return;
+  free_chain(a->first);
+  free_chain(a->big);
+  free(a);
+}
+
+void arena_reset(Arena *a) {
+  if (!a) return;
+  free_chain(a->first->next);
+  free_chain(a->big);
+  a->first->next = NULL;
+  a->first->used = 0;
+  a->cur = a->first;
+  a->big = NULL;
+  a->used = 0;
+  a->reserved = a->first->cap;
+}
+
+void *arena_alloc(Arena *a, size_t n) {
+  n = align_up(n ? n : 1);
+  a->used += n;
+
+  /* Large buffers (file contents, prompts) get an exact block so they do not
+     strand the rest of a normal one. */
+  if (n > a->block_size / 4) {
+    Block *b = block_new(n);
+    b->used = n;
+    b->next = a->big;
+    a->big = b;
+    a->reserved += n;
+    return b->data;
+  }
+
+  if (a->cur->cap - a->cur->used < n) {
+    Block *b = block_new(a->block_size);
+    a->cur->next = b;
+    a->cur = b;
+    a->reserved += b->cap;
+  }
+  void *p = a->cur->data + a->cur->used;
+  a->cur->used += n;
+  return p;
+}
+
+char *arena_strndup(Arena *a, const char *s, size_t n) {
+  char *p = (char *)arena_alloc(a, n + 1);
+  memcpy(p, s, n);
+  p[n] = 0;
+  return p;
+}
+
+char *arena_strdup(Arena *a, const char *s) {
+  return arena_strndup(a, s, strlen(s));
+}
+
+char *arena_sprintf(Arena *a, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  if (n < 0) die("arena_sprintf: bad format");
+
+  char *p = (char *)arena_alloc(a, (size_t)n + 1);
+  va_start(ap, fmt);
+  vsnprintf(p, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  return p;
+}
+
+size_t arena_used(const Arena *a) {
+  return a ? a->used : 0;
+}
+
+size_t arena_reserved(const Arena *a) {
+  return a ? a->reserved : 0;
+}
+
+/* ------------------------ cJSON hooks ------------------------ */
+
+/* Every hooked allocation carries a small header saying where it came from,
+   so cJSON_free works on trees from either source. */
+#define TAG_HEAP  0x48454150u   /* "HEAP" */
+#define TAG_ARENA 0x4152454Eu   /* "AREN" */
+
+typedef union {
+  uint32_t tag;
+  unsigned char pad[ARENA_ALIGN];
+} HookHeader;
+
+static ARENA_TLS Arena *t_bound = NULL;
+static bool g_hooks_installed = false;
+
+static void *hook_malloc(size_t n) {
+  HookHeader *h;
+  if (t_bound) {
+    h = (HookHeader *)arena_alloc(t_bound, sizeof(*h) + n);
+    h->tag = TAG_ARENA;
+  } else {
+    h = (HookHeader *)malloc(sizeof(*h) + n);
+    if (!h) return NULL;
+    h->tag = TAG_HEAP;
+  }
+  return h + 1;
+}
+
+static void hook_free(void *p) {
+  if (!p) return;
+  HookHeader *h = (HookHeader *)p - 1;
+  if (h->tag == TAG_HEAP) free(h);
+}
+
+void arena_install_cjson_hooks(void) {
+  if (g_hooks_installed) return;
+  cJSON_Hooks hooks = { hook_malloc, hook_free };
+  cJSON_InitHooks(&hooks);
+  g_hooks_installed = true;
+}
+
+Arena *arena_bind(Arena *a) {
+  Arena *prev = t_bound;
+  t_bound = a;
+  return prev;
+}
+
+Arena *arena_bound(void) {
+  return t_bound;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump allocator for data that lives exactly as long as one unit of work (a
+// movie): escaped shell arguments, parsed plans, cJSON trees.
+// Nothing is freed individually; arena_reset() drops everything at once and
+// keeps the first block for the next unit, so a long batch runs at a flat
+// footprint. Allocation failure is fatal, like the rest of the generator.
+
+typedef struct Arena Arena;
+
+// block_size is the normal block size; bigger requests get their own block.
+Arena *arena_new(size_t block_size);
+void arena_free(Arena *a);
+
+// Releases every allocation; the first block is kept for reuse.
+void arena_reset(Arena *a);
+
+// 16-byte aligned, never NULL.
+void *arena_alloc(Arena *a, size_t n);
+char *arena_strdup(Arena *a, const char *s);
+char *arena_strndup(Arena *a, const char *s, size_t n);
+char *arena_sprintf(Arena *a, const char *fmt, ...);
+
+// Bytes handed out since the last reset / bytes currently held from malloc.
+size_t arena_used(const Arena *a);
+size_t arena_reserved(const Arena *a);
+
+// ---- cJSON routing ----
+//
+// Once the hooks are installed, cJSON allocations made on a thread with a
+// bound arena come from that arena (cJSON_Delete on them is a no-op), and all
+// other cJSON allocations use the heap as before. Strings returned by
+// cJSON_Print* must be released with cJSON_free, never free.
+// A cJSON tree built while an arena is bound must not outlive its reset.
+
+void arena_install_cjson_hooks(void);   // idempotent; call before threads start
+
+// Binds a (or NULL) to the calling thread; returns the previous binding.
+Arena *arena_bind(Arena *a);
+Arena *arena_bound(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,236 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "audiomix.h"
+#include "fileview.h"
+#include "log.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Output frames mixed (and written) at a time. */
+#define MIX_BLOCK 4096
+
+/* A source as placed on the output timeline, in frames. */
+typedef struct {
+  FileView view;
+  int channels;
+  int64_t start;
+  int64_t end;
+  float gain;
+} Track;
+
+static int64_t frames_at(double s) {
+  return s > 0.0 ? (int64_t)llround(s * AUDIOMIX_RATE) : 0;
+}
+
+static bool track_open(Track *t, const AudioMixSource *src, float gain) {
+  memset(t, 0, sizeof(*t));
+  if (!file_view_open(&t->view, src->path)) {
+    logw("audiomix: cannot read %s: %s", src->path, strerror(errno));
+    return false;
+  }
+  t->channels = src->channels == 1 ? 1 : 2;
+  int64_t frames = (int64_t)(t->view.len / (2u * (size_t)t->channels));
+  if (src->max_s > 0.0 && frames > frames_at(src->max_s)) frames = frames_at(src->max_s);
+  t->start = frames_at(src->start_s);
+  t->end = t->start + frames;
+  t->gain = gain;
+  return true;
+}
+
+/* Piecewise linear gain over output frames: at[] ascending, the curve holds
+   its first and last value beyond the ends. */
+typedef struct {
+  int64_t *at;
+  float *gain;
+  size_t n, cap;
+  size_t next;              /* first point after the frame last evaluated */
+} Envelope;
+
+static void env_point(Envelope *e, int64_t at, float gain) {
+  if (e->n == e->cap) {
+    e->cap = e->cap ? e->cap * 2 : 32;
+    e->at = (int64_t *)realloc(e->at, e->cap * sizeof(int64_t));
+    e->gain = (float *)realloc(e->gain, e->cap * sizeof(float));
+    if (!e->at || !e->gain) die("OOM");
+  }
+  if (e->n > 0 && at < e->at[e->n - 1]) at = e->at[e->n - 1];
+  e->at[e->n] = at;
+  e->gain[e->n] = gain;
+  e->n++;
+}
+
+typedef struct {
+  int64_t start, end;
+} Span;
+
+static int span_cmp(const void *a, const void *b) {
+  int64_t x = ((const Span *)a)->start, y = ((const Span *)b)->start;
+  return (x > y) - (x < y);
+}
+
+/* The bed's duck curve from where the narration tracks sit. Gaps shorter
+   than the hold or than both ramps together stay ducked, so the music never
+   pumps between clips. */
+static void duck_envelope(Envelope *e, const Track *voice, size_t nv, const AudioMixDuck *d) {
+  Span *spans = (Span *)malloc((nv ? nv : 1) * sizeof(Span));
+  if (!spans) die("OOM");
+  size_t ns = 0;
+  for (size_t i = 0; i < nv; i++) {
+    if (voice[i].end > voice[i].start) spans[ns++] = (Span){ voice[i].start, voice[i].end };
+  }
+  qsort(spans, ns, sizeof(Span), span_cmp);
+
+  int64_t attack = frames_at(d->attack_s), release = frames_at(d->release_s);
+  int64_t min_gap = frames_at(d->hold_s);
+  if (min_gap < attack + release) min_gap = attack + release;
+  float depth = d->depth < 0.0f ? 0.0f : (d->depth > 1.0f ? 1.0f : d->depth);
+
+  env_point(e, 0, 1.0f);
+  for (size_t i = 0; i < ns; i++) {
+    int64_t a = spans[i].start, b = spans[i].end;
+    while (i + 1 < ns && spans[i + 1].start - b < min_gap) {
+      if (spans[i + 1].end > b) b = spans[i + 1].end;
+      i++;
+    }
+    env_point(e, a > attack ? a - attack : 0, 1.0f);
+    env_point(e, a, depth);
+    env_point(e, b, depth);
+    env_point(e, b + release, 1.0f);
+  }
+  free(spans);
+}
+
+/* Frames are asked for in increasing order. */
+static float env_at(Envelope *e, int64_t f) {
+  while (e->next < e->n && e->at[e->next] <= f) e->next++;
+  if (e->next == 0) return e->gain[0];
+  if (e->next == e->n) return e->gain[e->n - 1];
+  size_t k = e->next - 1;
+  float t = (float)(f - e->at[k]) / (float)(e->at[e->next] - e->at[k]);
+  return e->gain[k] + (e->gain[e->next] - e->gain[k]) * t;
+}
+
+static int16_t get_le16(const unsigned char *p) {
+  return (int16_t)(uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* Adds the part of t inside [at, at + n) to the interleaved stereo acc,
+   scaled by env[] (one gain per frame of the block) when given. */
+static void track_add(const Track *t, float *acc, int64_t at, int64_t n, const float *env) {
+  int64_t from = at > t->start ? at : t->start;
+  int64_t to = at + n < t->end ? at + n : t->end;
+  if (from >= to) return;
+
+  size_t frame_bytes = 2u * (size_t)t->channels;
+  const unsigned char *s = (const unsigned char *)t->view.data + (size_t)(from - t->start) * frame_bytes;
+  float *o = acc + (from - at) * 2;
+  const float g = t->gain / 32768.0f;
+  for (int64_t f = from; f < to; f++) {
+    float k = env ? g * env[f - at] : g;
+    float l = (float)get_le16(s) * k;
+    float r = t->channels == 2 ? (float)get_le16(s + 2) * k : l;
+    s += frame_bytes;
+    o[0] += l;
+    o[1] += r;
+    o += 2;
+  }
+}
+
+static void put_le16(unsigned char *p, uint16_t v) {
+  p[0] = (unsigned char)(v & 0xff);
+  p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_le32(unsigned char *p, uint32_t v) {
+  put_le16(p, (uint16_t)(v & 0xffff));
+  put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+/* Canonical 44-byte header for 16-bit PCM. */
+static bool write_wav_header(FILE *f, uint32_t data_bytes) {
+  unsigned char h[44];
+  memcpy(h, "RIFF", 4);
+  put_le32(h + 4, 36u + data_bytes);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put_le32(h + 16, 16);
+  put_le16(h + 20, 1);
+  put_le16(h + 22, AUDIOMIX_CHANNELS);
+  put_le32(h + 24, AUDIOMIX_RATE);
+  put_le32(h + 28, AUDIOMIX_RATE * AUDIOMIX_CHANNELS * 2);
+  put_le16(h + 32, AUDIOMIX_CHANNELS * 2);
+  put_le16(h + 34, 16);
+  memcpy(h + 36, "data", 4);
+  put_le32(h + 40, data_bytes);
+  return fwrite(h, 1, sizeof(h), f) == sizeof(h);
+}
+
+/* Mixes tracks block by block into f, after the header. The first nb
+   tracks are the bed and follow env (NULL = flat). */
+static bool write_mix(FILE *f, const Track *tracks, size_t nb, size_t nt, Envelope *env,
+                      int64_t total) {
+  if (!write_wav_header(f, (uint32_t)(total * 2 * AUDIOMIX_CHANNELS))) return false;
+
+  float acc[MIX_BLOCK * 2];
+  float duck[MIX_BLOCK];
+  unsigned char out[MIX_BLOCK * 2 * 2];
+  for (int64_t at = 0; at < total; at += MIX_BLOCK) {
+    int64_t n = total - at < MIX_BLOCK ? total - at : MIX_BLOCK;
+    memset(acc, 0, (size_t)n * 2 * sizeof(float));
+    if (env && nb > 0) {
+      for (int64_t i = 0; i < n; i++) duck[i] = env_at(env, at + i);
+    }
+    for (size_t t = 0; t < nt; t++) track_add(&tracks[t], acc, at, n, t < nb && env ? duck : NULL);
+
+    for (int64_t i = 0; i < n * 2; i++) {
+      float v = acc[i];
+      if (v > 1.0f) v = 1.0f;
+      if (v < -1.0f) v = -1.0f;
+      put_le16(out + i * 2, (uint16_t)(int16_t)lrintf(v * 32767.0f));
+    }
+    if (fwrite(out, 4, (size_t)n, f) != (size_t)n) return false;
+  }
+  return true;
+}
+
+bool audiomix_write_wav(const AudioMix *m, const char *out_wav) {
+  int64_t total = frames_at(m->total_s);
+  /* A WAV file tops out at 4 GiB, about six hours of output. */
+  int64_t max_frames = (int64_t)((UINT32_MAX - 36u) / (2u * AUDIOMIX_CHANNELS));
+  if (total > max_frames) total = max_frames;
+
+  FILE *f = fopen(out_wav, "wb");
+  if (!f) {
+    logw("audiomix: cannot create %s: %s", out_wav, strerror(errno));
+    return false;
+  }
+
+  size_t nt = m->voice_n + m->bed_n, open_n = 0;
+  Track *tracks = (Track *)calloc(nt ? nt : 1, sizeof(Track));
+  if (!tracks) die("OOM");
+  for (size_t i = 0; i < m->bed_n; i++) {
+    if (track_open(&tracks[open_n], &m->bed[i], m->bed_gain)) open_n++;
+  }
+  size_t bed_n = open_n;
+  for (size_t i = 0; i < m->voice_n; i++) {
+    if (track_open(&tracks[open_n], &m->voice[i], m->voice_gain)) open_n++;
+  }
+
+  Envelope env = {0};
+  bool ducked = m->duck && m->duck->depth < 1.0f && bed_n > 0;
+  if (ducked) duck_envelope(&env, tracks + bed_n, open_n - bed_n, m->duck);
+
+  bool ok = write_mix(f, tracks, bed_n, open_n, ducked ? &env : NULL, total);
+  free(env.at);
+  free(env.gain);
+  if (fclose(f) != 0) ok = false;
+  if (!ok) logw("audiomix: failed writing %s", out_wav);
+
+  for (size_t t = 0; t < open_n; t++) file_view_close(&tracks[t].view);
+  free(tracks);
+  return ok;
+}
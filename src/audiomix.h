@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Soundtrack assembly in PCM. FFmpeg decodes every narration clip and music
+// part once to raw signed 16-bit little-endian samples at AUDIOMIX_RATE; this
+// module places them on the movie's timeline, applies the gains and sums them
+// in one pass, and writes a single WAV file that the final mux encodes once.
+//
+// Sources are read through file views, so memory stays at one block of mixed
+// samples however long the movie is.
+//
+// The music is ducked under narration. Where the narration sits is known
+// before mixing (the clip timeline), so the bed's gain curve is computed up
+// front from the voice placements and applied as a plain multiply; nothing
+// listens to the narration while mixing.
+
+#define AUDIOMIX_RATE 48000
+#define AUDIOMIX_CHANNELS 2   // the output; sources may be mono or stereo
+
+typedef struct {
+  const char *path;         // raw s16le at AUDIOMIX_RATE
+  int channels;             // 1 or 2; mono is copied to both output channels
+  double start_s;           // timeline position of the first sample
+  double max_s;             // cut after this long; 0 = the whole source
+} AudioMixSource;
+
+// Bed gain around narration: it falls to bed_gain * depth over attack_s,
+// reaching it as the narration starts, and recovers over release_s after it
+// ends. Narration gaps too short to recover in stay ducked.
+typedef struct {
+  float depth;              // 0..1; 1 = no ducking
+  double attack_s;
+  double release_s;
+  double hold_s;            // shortest gap worth coming back up for
+} AudioMixDuck;
+
+typedef struct {
+  const AudioMixSource *voice;   // narration, one per clip
+  size_t voice_n;
+  float voice_gain;
+  const AudioMixSource *bed;     // background music parts, back to back
+  size_t bed_n;
+  float bed_gain;                // with no narration playing
+  const AudioMixDuck *duck;      // NULL = bed_gain throughout
+  double total_s;                // length of the output; longer sources are cut
+} AudioMix;
+
+// Writes the mix as a 16-bit PCM WAV. Sums that overflow are clipped. A
+// source that cannot be read leaves silence (after a warning); false only if
+// out_wav cannot be written.
+bool audiomix_write_wav(const AudioMix *m, const char *out_wav);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,5 +1,410 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "generator.h"
+#include "jsonw.h"
+#include "metrics.h"
+#include "runctl.h"
+
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+  #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#endif
+
+/* Exit codes, for job runners. */
+enum {
+  EXIT_ALL_OK = 0,        /* every selected title reached its goal or was skipped */
+  EXIT_SOME_FAILED = 1,
+  EXIT_USAGE = 2,
+  EXIT_NO_MATCH = 3,      /* titles were named but none matched */
+  EXIT_CANCELLED = 130
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+/* First Ctrl-C stops the run cleanly (encoders are terminated, nothing
+   partial lands in output/); a second one kills the process. */
+static void on_signal(int sig) {
+  g_stop = 1;
+  runctl_cancel();
+  signal(sig, SIG_DFL);
+}
+
+/* Encoder progress, at most one line per PROGRESS_EVERY_S so logs stay readable. */
+#define PROGRESS_EVERY_S 5.0
+
+/* Called from every movie worker; the thread that moves the stamp prints. */
+static void on_progress(const GeneratorProgress *p) {
+  static atomic_llong last_ms = 0;
+  if (p->done) return;
+  long long now = (long long)(metrics_now() * 1000.0);
+  long long last = atomic_load(&last_ms);
+  if (now - last < (long long)(PROGRESS_EVERY_S * 1000.0)) return;
+  if (!atomic_compare_exchange_strong(&last_ms, &last, now)) return;
+
+  char name[32];
+  if (p->clip) snprintf(name, sizeof(name), "clip %d", p->clip);
+  else snprintf(name, sizeof(name), "%s", p->stage);
+
+  if (p->total_s > 0.0 && p->eta_s >= 0.0) {
+    fprintf(stderr, "[PROG] %s: %.1f/%.1fs  %.2fx  eta %.0fs\n",
+            name, p->out_time_s, p->total_s, p->speed, p->eta_s);
+  } else {
+    fprintf(stderr, "[PROG] %s: %.1fs  %.2fx\n", name, p->out_time_s, p->speed);
+  }
+}
+
+/* ---- per-title report (JSON lines; logs stay on stderr) ---- */
+
+static FILE *g_report = NULL;
+static atomic_int g_titles_seen = 0;
+static atomic_int g_titles_failed = 0;
+static atomic_int g_titles_cancelled = 0;
+
+static void report_line(JsonWriter *w) {
+  size_t len = 0;
+  char *line = jw_take(w, &len);
+  fprintf(g_report, "%s\n", line);
+  fflush(g_report);
+  free(line);
+}
+
+static void on_title(const GeneratorTitleResult *r) {
+  atomic_fetch_add(&g_titles_seen, 1);
+  if (r->status == GENERATOR_TITLE_FAILED) atomic_fetch_add(&g_titles_failed, 1);
+  if (r->status == GENERATOR_TITLE_CANCELLED) atomic_fetch_add(&g_titles_cancelled, 1);
+
+  JsonWriter w;
+  jw_init(&w, 256);
+  jw_object_begin(&w);
+  jw_key(&w, "type");
+  jw_string(&w, "title");
+  jw_key(&w, "title");
+  jw_string(&w, r->title);
+  jw_key(&w, "status");
+  jw_string(&w, generator_title_status_name(r->status));
+  jw_key(&w, "seconds");
+  jw_double(&w, r->seconds);
+  jw_key(&w, "clips_planned");
+  jw_int(&w, r->clips_planned);
+  jw_key(&w, "clips_built");
+  jw_int(&w, r->clips_built);
+  jw_key(&w, "detail");
+  jw_string(&w, r->detail);
+  jw_object_end(&w);
+  report_line(&w);
+}
+
+static void report_summary(int reached, int exit_code) {
+  JsonWriter w;
+  jw_init(&w, 128);
+  jw_object_begin(&w);
+  jw_key(&w, "type");
+  jw_string(&w, "summary");
+  jw_key(&w, "titles");
+  jw_int(&w, atomic_load(&g_titles_seen));
+  jw_key(&w, "reached");
+  jw_int(&w, reached);
+  jw_key(&w, "failed");
+  jw_int(&w, atomic_load(&g_titles_failed));
+  jw_key(&w, "cancelled");
+  jw_int(&w, atomic_load(&g_titles_cancelled));
+  jw_key(&w, "exit_code");
+  jw_int(&w, exit_code);
+  jw_object_end(&w);
+  report_line(&w);
+}
+
+static void sleep_seconds(int s) {
+#if defined(_WIN32)
+  Sleep((DWORD)s * 1000);
+#else
+  struct timespec ts = { s, 0 };
+  nanosleep(&ts, NULL);
+#endif
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [options] [TITLE|GLOB ...]\n"
+          "\n"
+          "Processes every .mp4 in the movies directory, or only the titles named\n"
+          "(file name without .mp4; * and ? wildcards allowed). One JSON line per\n"
+          "title goes to the report (stdout by default); logs go to stderr.\n"
+          "\n"
+          "Mode:\n"
+          "  --dry-run            list what would be processed; no network, no files written\n"
+          "  --plan-only          stop after writing the clip plan file (no TTS, no FFmpeg)\n"
+          "  --render-only        render from existing plan files (no subtitles, no LLM);\n"
+          "                       titles without a plan are skipped\n"
+          "  --shard-worker       build clip shards published in the shard directory\n"
+          "                       (with --daemon: keep picking up new ones)\n"
+          "  --force              redo titles whose outputs (or plan) already exist\n"
+          "  --keep-sources       do not move finished sources to the retired directory\n"
+          "\n"
+          "Outputs and concurrency:\n"
+          "  --outputs LIST       comma list of horizontal,vertical,preview (default horizontal,vertical)\n"
+          "  --clips N            clips to ask the planner for (default random 20..30)\n"
+          "  --workers N          movies processed at once (default 1)\n"
+          "  --encoders N         FFmpeg clip encoders per movie (default 3)\n"
+          "  --tts-jobs N         narration requests in flight per movie (default 1)\n"
+          "\n"
+          "Sharing the work with other processes or hosts:\n"
+          "  --jobs-dir DIR       claim titles through DIR on a shared filesystem\n"
+          "  --node NAME          this worker's name in claims (default host name)\n"
+          "  --lease SECONDS      claims not refreshed for this long are taken over (default 60)\n"
+          "  --max-attempts N     failed attempts before a title is given up (default 3)\n"
+          "  --shards N           split each movie's clip encodes into N shards for\n"
+          "                       --shard-worker processes to share (default 1 = off)\n"
+          "  --shard-dir DIR      published shard jobs, clips and manifests (default shards)\n"
+          "\n"
+          "Directories:\n"
+          "  --movies-dir DIR     sources (default movies)\n"
+          "  --output-dir DIR     horizontal renders (default output)\n"
+          "  --vertical-dir DIR   vertical renders (default tiktok_output)\n"
+          "  --preview-dir DIR    previews (default previews)\n"
+          "  --retired-dir DIR    finished sources (default movies_retired)\n"
+          "  --work-dir DIR       intermediate files, cleared per run (default clips)\n"
+          "  --scripts-dir DIR    subtitles, scripts and lookup cache (default scripts)\n"
+          "  --plans-dir DIR      <title>_plan.json files (default <scripts-dir>/srt_files)\n"
+          "  --music-dir DIR      background music (default backgroundmusic)\n"
+          "  --config FILE        API keys and service URLs (default config.json)\n"
+          "\n"
+          "Reporting and service mode:\n"
+          "  --report FILE        write the JSON lines to FILE instead of stdout (\"-\" = stdout)\n"
+          "  --daemon             keep running; rescan the movies directory every --interval seconds\n"
+          "  --interval SECONDS   delay between daemon passes (default 300)\n"
+          "  --metrics-port PORT  serve Prometheus metrics on GET /metrics (default 9464 in daemon mode)\n"
+          "  --metrics-bind ADDR  listen address for the metrics endpoint (default 127.0.0.1)\n"
+          "\n"
+          "Exit status: 0 all titles done or skipped, 1 some failed, 2 usage error,\n"
+          "3 no title matched, 130 cancelled.\n",
+          argv0);
+}
+
+/* "--name VALUE" or "--name=VALUE". */
+static bool arg_value(int argc, char **argv, int *i, const char *name, const char **out) {
+  const char *a = argv[*i];
+  size_t n = strlen(name);
+  if (strncmp(a, name, n) != 0) return false;
+  if (a[n] == '=') {
+    *out = a + n + 1;
+    return true;
+  }
+  if (a[n] != 0) return false;
+  if (*i + 1 >= argc) {
+    fprintf(stderr, "%s needs a value\n", name);
+    exit(EXIT_USAGE);
+  }
+  *out = argv[++*i];
+  return true;
+}
+
+static int parse_count(const char *name, const char *v, int lo, int hi) {
+  char *end = NULL;
+  long n = strtol(v, &end, 10);
+  if (!v[0] || *end || n < lo || n > hi) {
+    fprintf(stderr, "%s: expected a number in %d..%d, got \"%s\"\n", name, lo, hi, v);
+    exit(EXIT_USAGE);
+  }
+  return (int)n;
+}
+
+static unsigned parse_outputs(const char *v) {
+  unsigned out = 0;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s", v);
+  for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+    if (strcmp(tok, "horizontal") == 0) out |= GENERATOR_OUT_HORIZONTAL;
+    else if (strcmp(tok, "vertical") == 0) out |= GENERATOR_OUT_VERTICAL;
+    else if (strcmp(tok, "preview") == 0) out |= GENERATOR_OUT_PREVIEW;
+    else {
+      fprintf(stderr, "--outputs: unknown output \"%s\" (horizontal, vertical, preview)\n", tok);
+      exit(EXIT_USAGE);
+    }
+  }
+  if (!out) {
+    fprintf(stderr, "--outputs: empty list\n");
+    exit(EXIT_USAGE);
+  }
+  return out;
+}
+
+/* --dry-run, --plan-only, --render-only and --shard-worker pick one mode each. */
+static void set_mode(GeneratorOptions *opt, GeneratorMode mode, const char *flag) {
+  static const char *chosen = NULL;
+  if (chosen && opt->mode != mode) {
+    fprintf(stderr, "%s and %s do not mix\n", chosen, flag);
+    exit(EXIT_USAGE);
+  }
+  chosen = flag;
+  opt->mode = mode;
+}
+
+int main(int argc, char **argv) {
+  bool daemon = false;
+  int interval = 300;
+  int metrics_port = -1;
+  const char *metrics_bind = "127.0.0.1";
+  const char *report_path = "-";
+
+  GeneratorOptions opt;
+  generator_options_init(&opt);
+  const char **select = (const char **)calloc((size_t)argc, sizeof(char *));
+  if (!select) return EXIT_USAGE;
+  int nselect = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = NULL;
+    if (strcmp(a, "--daemon") == 0) {
+      daemon = true;
+    } else if (strcmp(a, "--dry-run") == 0) {
+      set_mode(&opt, GENERATOR_MODE_DRY_RUN, a);
+    } else if (strcmp(a, "--plan-only") == 0) {
+      set_mode(&opt, GENERATOR_MODE_PLAN_ONLY, a);
+    } else if (strcmp(a, "--render-only") == 0) {
+      set_mode(&opt, GENERATOR_MODE_RENDER_ONLY, a);
+    } else if (strcmp(a, "--shard-worker") == 0) {
+      set_mode(&opt, GENERATOR_MODE_SHARD_WORKER, a);
+    } else if (strcmp(a, "--force") == 0) {
+      opt.force = true;
+    } else if (strcmp(a, "--keep-sources") == 0) {
+      opt.keep_sources = true;
+    } else if (arg_value(argc, argv, &i, "--interval", &v)) {
+      interval = parse_count("--interval", v, 1, 7 * 24 * 3600);
+    } else if (arg_value(argc, argv, &i, "--metrics-port", &v)) {
+      metrics_port = parse_count("--metrics-port", v, 0, 65535);
+    } else if (arg_value(argc, argv, &i, "--metrics-bind", &v)) {
+      metrics_bind = v;
+    } else if (arg_value(argc, argv, &i, "--report", &v)) {
+      report_path = v;
+    } else if (arg_value(argc, argv, &i, "--outputs", &v)) {
+      opt.outputs = parse_outputs(v);
+    } else if (arg_value(argc, argv, &i, "--clips", &v)) {
+      opt.num_clips = parse_count("--clips", v, 1, 100);
+    } else if (arg_value(argc, argv, &i, "--workers", &v)) {
+      opt.workers = parse_count("--workers", v, 1, 16);
+    } else if (arg_value(argc, argv, &i, "--encoders", &v)) {
+      opt.clip_encoders = parse_count("--encoders", v, 1, 16);
+    } else if (arg_value(argc, argv, &i, "--tts-jobs", &v)) {
+      opt.tts_jobs = parse_count("--tts-jobs", v, 1, 16);
+    } else if (arg_value(argc, argv, &i, "--jobs-dir", &v)) {
+      opt.jobs_dir = v;
+    } else if (arg_value(argc, argv, &i, "--node", &v)) {
+      opt.node = v;
+    } else if (arg_value(argc, argv, &i, "--lease", &v)) {
+      opt.lease_seconds = parse_count("--lease", v, 5, 24 * 3600);
+    } else if (arg_value(argc, argv, &i, "--max-attempts", &v)) {
+      opt.max_attempts = parse_count("--max-attempts", v, 1, 100);
+    } else if (arg_value(argc, argv, &i, "--shards", &v)) {
+      opt.shards = parse_count("--shards", v, 1, 64);
+    } else if (arg_value(argc, argv, &i, "--shard-dir", &v)) {
+      opt.shard_dir = v;
+    } else if (arg_value(argc, argv, &i, "--movies-dir", &v)) {
+      opt.movies_dir = v;
+    } else if (arg_value(argc, argv, &i, "--output-dir", &v)) {
+      opt.output_dir = v;
+    } else if (arg_value(argc, argv, &i, "--vertical-dir", &v)) {
+      opt.vertical_dir = v;
+    } else if (arg_value(argc, argv, &i, "--preview-dir", &v)) {
+      opt.preview_dir = v;
+    } else if (arg_value(argc, argv, &i, "--retired-dir", &v)) {
+      opt.retired_dir = v;
+    } else if (arg_value(argc, argv, &i, "--work-dir", &v)) {
+      opt.work_dir = v;
+    } else if (arg_value(argc, argv, &i, "--scripts-dir", &v)) {
+      opt.scripts_dir = v;
+    } else if (arg_value(argc, argv, &i, "--plans-dir", &v)) {
+      opt.plans_dir = v;
+    } else if (arg_value(argc, argv, &i, "--music-dir", &v)) {
+      opt.music_dir = v;
+    } else if (arg_value(argc, argv, &i, "--config", &v)) {
+      opt.config_path = v;
+    } else if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
+      usage(argv[0]);
+      return EXIT_ALL_OK;
+    } else if (strcmp(a, "--") == 0) {
+      while (++i < argc) select[nselect++] = argv[i];
+    } else if (a[0] == '-' && a[1]) {
+      fprintf(stderr, "unknown option: %s\n\n", a);
+      usage(argv[0]);
+      return EXIT_USAGE;
+    } else {
+      select[nselect++] = a;
+    }
+  }
+  opt.select = select;
+  opt.select_count = nselect;
+
+  if (daemon && opt.mode == GENERATOR_MODE_DRY_RUN) {
+    fprintf(stderr, "--daemon and --dry-run do not mix\n");
+    return EXIT_USAGE;
+  }
+
+  g_report = stdout;
+  if (strcmp(report_path, "-") != 0) {
+    g_report = fopen(report_path, "a");
+    if (!g_report) {
+      fprintf(stderr, "cannot open report file %s\n", report_path);
+      return EXIT_USAGE;
+    }
+  }
+
+  generator_set_progress_hook(on_progress);
+  generator_set_title_hook(on_title);
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  if (metrics_port < 0 && daemon) metrics_port = 9464;
+  if (metrics_port > 0) {
+    if (metrics_server_start(metrics_bind, metrics_port)) {
+      fprintf(stderr, "[INFO] metrics: http://%s:%d/metrics\n", metrics_bind, metrics_port);
+    } else {
+      fprintf(stderr, "[WARN] metrics endpoint failed to start on %s:%d\n", metrics_bind, metrics_port);
+    }
+  }
+
+  /* One summary per pass, every field counting that pass alone; a daemon
+     pass reports titles finished on earlier passes again. The exit status
+     covers all of them. */
+  bool any_failed = false, any_seen = false;
+  do {
+    atomic_store(&g_titles_seen, 0);
+    atomic_store(&g_titles_failed, 0);
+    atomic_store(&g_titles_cancelled, 0);
+    int reached = run_generation_with(&opt);
+    int seen = atomic_load(&g_titles_seen), failed = atomic_load(&g_titles_failed);
+    any_seen = any_seen || seen > 0;
+    any_failed = any_failed || failed > 0;
+
+    int pass_rc = EXIT_ALL_OK;
+    if (runctl_cancelled()) pass_rc = EXIT_CANCELLED;
+    else if (failed > 0) pass_rc = EXIT_SOME_FAILED;
+    else if (nselect > 0 && seen == 0) pass_rc = EXIT_NO_MATCH;
+    report_summary(reached, pass_rc);
+    if (!daemon) break;
+
+    fprintf(stderr, "[INFO] daemon: next pass in %d s\n", interval);
+    for (int waited = 0; waited < interval && !g_stop; waited++) sleep_seconds(1);
+  } while (!g_stop);
+
+  int rc = EXIT_ALL_OK;
+  if (runctl_cancelled()) rc = EXIT_CANCELLED;
+  else if (any_failed) rc = EXIT_SOME_FAILED;
+  else if (nselect > 0 && !any_seen) rc = EXIT_NO_MATCH;
 
-int main(void) {
-  return run_generation();
+  metrics_server_stop();
+  if (g_report != stdout) fclose(g_report);
+  free(select);
+  return rc;
 }
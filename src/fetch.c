@@ -0,0 +1,454 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "fetch.h"
+#include "log.h"
+#include "metrics.h"
+#include "runctl.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <curl/curl.h>
+
+#define FETCH_MAX_BODY (64u * 1024u * 1024u)
+#define FETCH_MAX_HOST_CONNECTIONS 8L
+#define FETCH_MIN_BODY (16u * 1024u)
+
+/* Receive buffers kept for reuse across jobs and groups. Large ones are not
+   kept, so an occasional multi-MB response does not pin its memory. */
+#define POOL_SLOTS 16
+#define POOL_MAX_BUF (1024u * 1024u)
+
+static const char *k_user_agent =
+  "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) "
+  "AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.0 Safari/605.1.15";
+
+struct FetchGroup {
+  CURLM *multi;
+  FetchJob *pending;      /* queued, not yet attached */
+  FetchJob *active;       /* attached to the multi handle */
+  bool cancelled;
+};
+
+/* ------------------------ buffer pool ------------------------ */
+
+typedef struct {
+  char *buf;
+  size_t cap;
+} PoolSlot;
+
+static PoolSlot g_pool[POOL_SLOTS];
+static atomic_flag g_pool_lock = ATOMIC_FLAG_INIT;
+
+static void pool_lock(void) {
+  while (atomic_flag_test_and_set_explicit(&g_pool_lock, memory_order_acquire)) {}
+}
+
+static void pool_unlock(void) {
+  atomic_flag_clear_explicit(&g_pool_lock, memory_order_release);
+}
+
+/* Smallest pooled buffer that fits `need`, else the largest one (the caller
+   grows it), else NULL. */
+static char *pool_take(size_t need, size_t *cap_out) {
+  int best = -1;
+  pool_lock();
+  for (int i = 0; i < POOL_SLOTS; i++) {
+    if (!g_pool[i].buf) continue;
+    if (best < 0) { best = i; continue; }
+    bool fits = g_pool[i].cap >= need, best_fits = g_pool[best].cap >= need;
+    if (fits ? (!best_fits || g_pool[i].cap < g_pool[best].cap)
+             : (!best_fits && g_pool[i].cap > g_pool[best].cap)) {
+      best = i;
+    }
+  }
+  char *buf = NULL;
+  if (best >= 0) {
+    buf = g_pool[best].buf;
+    *cap_out = g_pool[best].cap;
+    g_pool[best].buf = NULL;
+    g_pool[best].cap = 0;
+  }
+  pool_unlock();
+  return buf;
+}
+
+static void pool_give(char *buf, size_t cap) {
+  if (!buf) return;
+  if (cap <= POOL_MAX_BUF) {
+    pool_lock();
+    for (int i = 0; i < POOL_SLOTS; i++) {
+      if (!g_pool[i].buf) {
+        g_pool[i].buf = buf;
+        g_pool[i].cap = cap;
+        buf = NULL;
+        break;
+      }
+    }
+    pool_unlock();
+  }
+  free(buf);
+}
+
+/* Makes room for `need` bytes (terminator included). Capacity doubles, so a
+   body costs O(n) copying however small its chunks arrive. */
+static bool body_reserve(FetchJob *j, size_t need) {
+  if (need <= j->cap) return true;
+  if (need > FETCH_MAX_BODY) return false;
+
+  if (!j->body) {
+    size_t cap = 0;
+    char *p = pool_take(need, &cap);
+    if (p) {
+      j->body = p;
+      j->cap = cap;
+      if (need <= cap) return true;
+    }
+  }
+
+  size_t cap = j->cap ? j->cap : FETCH_MIN_BODY;
+  while (cap < need) cap *= 2;
+  if (cap > FETCH_MAX_BODY) cap = FETCH_MAX_BODY;
+  char *p = (char *)realloc(j->body, cap);
+  if (!p) return false;
+  j->body = p;
+  j->cap = cap;
+  return true;
+}
+
+/* ------------------------ jobs ------------------------ */
+
+static void job_free(FetchJob *j) {
+  if (!j) return;
+  if (j->cleanup) j->cleanup(j->user);
+  if (j->easy) curl_easy_cleanup((CURL *)j->easy);
+  curl_slist_free_all((struct curl_slist *)j->headers);
+  free(j->post);
+  pool_give(j->body, j->cap);
+  free(j);
+}
+
+static void list_push(FetchJob **head, FetchJob *j) {
+  j->next = *head;
+  *head = j;
+}
+
+static void list_remove(FetchJob **head, FetchJob *j) {
+  for (FetchJob **pp = head; *pp; pp = &(*pp)->next) {
+    if (*pp == j) {
+      *pp = j->next;
+      j->next = NULL;
+      return;
+    }
+  }
+}
+
+static size_t fetch_write_cb(void *contents, size_t size, size_t nmemb, void *userp) {
+  size_t realsz = size * nmemb;
+  FetchJob *j = (FetchJob *)userp;
+
+  /* Error pages are never scanned, so a retried page starts from a clean scanner. */
+  if (!j->status_checked) {
+    long code = 0;
+    curl_easy_getinfo((CURL *)j->easy, CURLINFO_RESPONSE_CODE, &code);
+    j->status_checked = true;
+    j->discard = j->scan && (code < 200 || code >= 300);
+
+    /* Size the buffer once from Content-Length instead of growing into it. */
+    curl_off_t clen = -1;
+    if (!j->scan && !j->discard &&
+        curl_easy_getinfo((CURL *)j->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &clen) == CURLE_OK &&
+        clen > 0) {
+      if ((unsigned long long)clen >= FETCH_MAX_BODY) return 0;
+      if (!body_reserve(j, (size_t)clen + 1)) return 0;
+    }
+  }
+  if (j->discard) return realsz;
+
+  if (j->scan) {
+    j->scan_fed = true;
+    if (!html_scan_feed(j->scan, (const char *)contents, realsz)) {
+      j->scan_stopped = true;
+      return 0;
+    }
+    return realsz;
+  }
+
+  if (!body_reserve(j, j->len + realsz + 1)) return 0;
+  memcpy(j->body + j->len, contents, realsz);
+  j->len += realsz;
+  j->body[j->len] = 0;
+  return realsz;
+}
+
+/* Lets a cancelled run abort transfers that are already on the wire. */
+static int fetch_progress_cb(void *userp, curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow) {
+  (void)userp; (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+  return runctl_cancelled() ? 1 : 0;
+}
+
+static FetchJob *job_new(FetchGroup *g, const char *url, FetchDoneFn done, void *user, int tag) {
+  FetchJob *j = (FetchJob *)calloc(1, sizeof(*j));
+  if (!j) die("OOM");
+  snprintf(j->url, sizeof(j->url), "%s", url);
+  j->done = done;
+  j->user = user;
+  j->tag = tag;
+  j->policy = &HTTP_POLICY_PAGE;
+  list_push(&g->pending, j);
+  return j;
+}
+
+FetchJob *fetch_get(FetchGroup *g, const char *url, FetchDoneFn done, void *user, int tag) {
+  return job_new(g, url, done, user, tag);
+}
+
+FetchJob *fetch_post(FetchGroup *g, const char *url, const char *body,
+                     FetchDoneFn done, void *user, int tag) {
+  FetchJob *j = job_new(g, url, done, user, tag);
+  j->post = strdup(body ? body : "");
+  if (!j->post) die("OOM");
+  j->post_data = j->post;
+  j->post_len = strlen(j->post);
+  return j;
+}
+
+FetchJob *fetch_post_borrowed(FetchGroup *g, const char *url, const char *body, size_t len,
+                              FetchDoneFn done, void *user, int tag) {
+  FetchJob *j = job_new(g, url, done, user, tag);
+  j->post_data = body ? body : "";
+  j->post_len = body ? len : 0;
+  return j;
+}
+
+void fetch_job_header(FetchJob *job, const char *line) {
+  struct curl_slist *h = curl_slist_append((struct curl_slist *)job->headers, line);
+  if (!h) die("OOM");
+  job->headers = h;
+}
+
+void fetch_job_policy(FetchJob *job, const HttpPolicy *policy) {
+  if (policy) job->policy = policy;
+}
+
+static bool job_attach(FetchGroup *g, FetchJob *j) {
+  CURL *curl = curl_easy_init();
+  if (!curl) return false;
+  j->easy = curl;
+  j->attempt++;
+  j->status_checked = false;
+  j->discard = false;
+
+  curl_easy_setopt(curl, CURLOPT_URL, j->url);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, k_user_agent);
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  curl_easy_setopt(curl, CURLOPT_COOKIEFILE, "");
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, j->policy->timeout_s);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, j->policy->connect_timeout_s);
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, fetch_write_cb);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)j);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, (void *)j);
+  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, fetch_progress_cb);
+  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  if (j->headers) curl_easy_setopt(curl, CURLOPT_HTTPHEADER, (struct curl_slist *)j->headers);
+  if (j->post_data) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)j->post_len);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, j->post_data);
+  }
+
+  if (curl_multi_add_handle(g->multi, curl) != CURLM_OK) return false;
+  list_push(&g->active, j);
+  return true;
+}
+
+/* ------------------------ group ------------------------ */
+
+FetchGroup *fetch_group_new(void) {
+  FetchGroup *g = (FetchGroup *)calloc(1, sizeof(*g));
+  if (!g) die("OOM");
+  g->multi = curl_multi_init();
+  if (!g->multi) die("curl_multi_init failed");
+  curl_multi_setopt(g->multi, CURLMOPT_MAX_HOST_CONNECTIONS, FETCH_MAX_HOST_CONNECTIONS);
+  return g;
+}
+
+static void drop_all(FetchGroup *g) {
+  while (g->active) {
+    FetchJob *j = g->active;
+    g->active = j->next;
+    curl_multi_remove_handle(g->multi, (CURL *)j->easy);
+    job_free(j);
+  }
+  while (g->pending) {
+    FetchJob *j = g->pending;
+    g->pending = j->next;
+    job_free(j);
+  }
+}
+
+/* Completes a job that never reached the network. */
+static void fail_unsent(FetchGroup *g, FetchJob *j, HttpError err, int curl_code) {
+  j->err = err;
+  j->curl_code = curl_code;
+  j->ok = false;
+  if (j->done && !g->cancelled) j->done(g, j);
+  job_free(j);
+}
+
+/* Starts every queued job whose backoff has elapsed; returns the time until
+   the next one is due (or a negative value if none is waiting). */
+static double attach_pending(FetchGroup *g) {
+  double now = metrics_now();
+  double next_due = -1.0;
+
+  FetchJob **pp = &g->pending;
+  while (*pp && !g->cancelled) {
+    FetchJob *j = *pp;
+    if (j->not_before > now) {
+      double wait = j->not_before - now;
+      if (next_due < 0.0 || wait < next_due) next_due = wait;
+      pp = &j->next;
+      continue;
+    }
+
+    *pp = j->next;
+    j->next = NULL;
+
+    if (runctl_cancelled()) {
+      fail_unsent(g, j, HTTP_ERR_CANCELLED, CURLE_ABORTED_BY_CALLBACK);
+    } else if (!http_breaker_allow(j->url)) {
+      fail_unsent(g, j, HTTP_ERR_CIRCUIT_OPEN, CURLE_OK);
+    } else if (!job_attach(g, j)) {
+      logw("fetch: could not start %s", j->url);
+      fail_unsent(g, j, HTTP_ERR_TRANSPORT, CURLE_FAILED_INIT);
+    }
+    /* A callback may have queued more work at the head; rescan from there. */
+    pp = &g->pending;
+  }
+  return next_due;
+}
+
+/* Puts a failed attempt back in the queue if the policy allows another try. */
+static bool maybe_retry(FetchGroup *g, FetchJob *j, CURL *curl) {
+  if (g->cancelled || j->attempt >= j->policy->max_attempts) return false;
+  if (j->scan && j->scan_fed) return false;     /* scanner state cannot be rewound */
+  if (!http_should_retry(j->policy, j->curl_code, j->code)) return false;
+
+  double retry_after = 0.0;
+#if LIBCURL_VERSION_NUM >= 0x074200
+  curl_off_t ra = 0;
+  if (curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &ra) == CURLE_OK && ra > 0) retry_after = (double)ra;
+#else
+  (void)curl;
+#endif
+
+  double delay = http_backoff_delay(j->policy, j->attempt, retry_after);
+  if (j->curl_code != CURLE_OK) {
+    logw("http: %s attempt %d/%d failed (%s); retrying in %.1fs", j->policy->name, j->attempt,
+         j->policy->max_attempts, curl_easy_strerror((CURLcode)j->curl_code), delay);
+  } else {
+    logw("http: %s attempt %d/%d got HTTP %ld; retrying in %.1fs", j->policy->name, j->attempt,
+         j->policy->max_attempts, j->code, delay);
+  }
+  metrics_inc(METRIC_HTTP_RETRIES, 1);
+
+  curl_easy_cleanup((CURL *)j->easy);
+  j->easy = NULL;
+  j->len = 0;
+  if (j->body) j->body[0] = 0;
+  j->code = 0;
+  j->scan_stopped = false;
+  j->not_before = metrics_now() + delay;
+  list_push(&g->pending, j);
+  return true;
+}
+
+static void finish_job(FetchGroup *g, CURL *curl, CURLcode res) {
+  char *priv = NULL;
+  curl_easy_getinfo(curl, CURLINFO_PRIVATE, &priv);
+  FetchJob *j = (FetchJob *)priv;
+  curl_multi_remove_handle(g->multi, curl);
+  list_remove(&g->active, j);
+
+  /* A scanner that stopped early got everything it wanted. */
+  if (res == CURLE_WRITE_ERROR && j->scan_stopped) res = CURLE_OK;
+
+  metrics_inc(METRIC_HTTP_REQUESTS, 1);
+  if (res != CURLE_OK) metrics_inc(METRIC_HTTP_ERRORS, 1);
+  curl_off_t dl = 0;
+  if (curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &dl) == CURLE_OK && dl > 0) {
+    metrics_inc(METRIC_BYTES_DOWNLOADED, (unsigned long long)dl);
+  }
+
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &j->code);
+  j->curl_code = (int)res;
+  j->err = http_classify(j->curl_code, j->code);
+  j->ok = (j->err == HTTP_OK);
+
+  /* 4xx still means the host is up; only our own aborts say nothing about it. */
+  if (j->err != HTTP_ERR_ABORTED && j->err != HTTP_ERR_CANCELLED) {
+    bool healthy = j->err == HTTP_OK || (j->err == HTTP_ERR_STATUS && j->code < 500 && j->code != 429);
+    http_breaker_report(j->url, healthy);
+  }
+
+  if (!j->ok && maybe_retry(g, j, curl)) return;
+
+  if (j->done) j->done(g, j);
+  job_free(j);
+}
+
+void fetch_group_run(FetchGroup *g) {
+  while (!g->cancelled) {
+    double next_due = attach_pending(g);
+    if (g->cancelled) break;
+    if (!g->active) {
+      if (next_due < 0.0) break;
+      runctl_sleep(next_due);            /* only backoff timers left */
+      continue;
+    }
+
+    int running = 0;
+    CURLMcode mc = curl_multi_perform(g->multi, &running);
+    if (mc != CURLM_OK) {
+      logw("fetch: curl_multi_perform: %s", curl_multi_strerror(mc));
+      break;
+    }
+
+    CURLMsg *msg;
+    int left = 0;
+    while (!g->cancelled && (msg = curl_multi_info_read(g->multi, &left)) != NULL) {
+      if (msg->msg == CURLMSG_DONE) finish_job(g, msg->easy_handle, msg->data.result);
+    }
+
+    if (!g->cancelled && running > 0) {
+      int wait_ms = 1000;
+      if (next_due >= 0.0 && next_due * 1000.0 < wait_ms) wait_ms = (int)(next_due * 1000.0) + 1;
+      curl_multi_wait(g->multi, NULL, 0, wait_ms, NULL);
+    }
+  }
+
+  drop_all(g);
+}
+
+void fetch_group_cancel(FetchGroup *g) {
+  g->cancelled = true;
+  drop_all(g);
+}
+
+bool fetch_group_cancelled(const FetchGroup *g) {
+  return g->cancelled;
+}
+
+void fetch_group_free(FetchGroup *g) {
+  if (!g) return;
+  drop_all(g);
+  curl_multi_cleanup(g->multi);
+  free(g);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "htmlscan.h"
+#include "http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Concurrent HTTP fetches on one curl_multi handle, driven from the calling
+// thread. Completion callbacks run on that thread too; they may queue
+// follow-up requests or cancel the whole group, which is how first-success
+// races (e.g. subtitle providers) are built.
+//
+// Each job follows an HttpPolicy: failed attempts that are worth repeating are
+// re-queued with backoff (the callback only sees the final attempt), and
+// hosts whose circuit breaker is open fail fast without a request.
+
+typedef struct FetchGroup FetchGroup;
+typedef struct FetchJob FetchJob;
+
+typedef void (*FetchDoneFn)(FetchGroup *g, FetchJob *job);
+
+struct FetchJob {
+  // Request (set by fetch_get/fetch_post and the fetch_job_* helpers).
+  char url[1024];
+  FetchDoneFn done;
+  void *user;
+  int tag;                  // caller-defined step id
+  HtmlScan *scan;           // when set, the body is streamed into it instead of buffered
+  void (*cleanup)(void *user);  // releases user when the job is freed, finished or not
+  const HttpPolicy *policy;     // HTTP_POLICY_PAGE unless set
+
+  // Result, valid inside the done callback. The job (and body) is freed when
+  // the callback returns; set body = NULL to keep the buffer (plain malloc
+  // memory, release with free()). Bodies are pre-sized from Content-Length and
+  // their buffers are recycled across jobs when nobody keeps them.
+  bool ok;                  // transfer completed with a 2xx status
+  HttpError err;
+  long code;
+  int curl_code;
+  int attempt;              // attempts made (1 = no retries)
+  char *body;
+  size_t len;
+
+  // Internal.
+  void *easy;
+  void *headers;
+  char *post;               // owned copy (fetch_post)
+  const char *post_data;    // what is sent: post or the borrowed body
+  size_t post_len;
+  size_t cap;
+  bool scan_stopped;
+  bool scan_fed;
+  bool status_checked;
+  bool discard;             // non-2xx body of a scanned page
+  double not_before;        // retry backoff deadline (metrics_now clock)
+  FetchJob *next;
+};
+
+FetchGroup *fetch_group_new(void);
+
+// Queue requests; they start on the next turn of fetch_group_run().
+FetchJob *fetch_get(FetchGroup *g, const char *url, FetchDoneFn done, void *user, int tag);
+FetchJob *fetch_post(FetchGroup *g, const char *url, const char *body,
+                     FetchDoneFn done, void *user, int tag);
+
+// POST without copying the body: it must stay valid until the group has run.
+FetchJob *fetch_post_borrowed(FetchGroup *g, const char *url, const char *body, size_t len,
+                              FetchDoneFn done, void *user, int tag);
+
+// Extra request header ("Name: value"); call before the group runs the job.
+void fetch_job_header(FetchJob *job, const char *line);
+
+void fetch_job_policy(FetchJob *job, const HttpPolicy *policy);
+
+// Runs until every queued job has finished or the group is cancelled.
+void fetch_group_run(FetchGroup *g);
+
+// Abandons all queued and in-flight jobs; their callbacks are not called.
+void fetch_group_cancel(FetchGroup *g);
+bool fetch_group_cancelled(const FetchGroup *g);
+
+void fetch_group_free(FetchGroup *g);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "ffprogress.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void ffprogress_init(FfProgressParser *p) {
+  memset(p, 0, sizeof(*p));
+  p->cur.total_size = -1;
+  p->last.total_size = -1;
+}
+
+/* "HH:MM:SS.micro"; negative on anything else (FFmpeg prints N/A early on). */
+static double parse_clock(const char *v) {
+  char *end;
+  long h = strtol(v, &end, 10);
+  if (*end != ':') return -1.0;
+  long m = strtol(end + 1, &end, 10);
+  if (*end != ':') return -1.0;
+  double s = strtod(end + 1, &end);
+  if (h < 0 || m < 0 || s < 0.0) return -1.0;
+  return (double)h * 3600.0 + (double)m * 60.0 + s;
+}
+
+bool ffprogress_feed(FfProgressParser *p, const char *line, size_t len) {
+  const char *eq = (const char *)memchr(line, '=', len);
+  if (!eq) return false;
+
+  char key[32], val[64];
+  size_t kn = (size_t)(eq - line), vn = len - kn - 1;
+  if (kn == 0 || kn >= sizeof(key)) return false;
+  if (vn >= sizeof(val)) vn = sizeof(val) - 1;
+  memcpy(key, line, kn);
+  key[kn] = 0;
+  memcpy(val, eq + 1, vn);
+  val[vn] = 0;
+
+  FfProgress *c = &p->cur;
+  char *end;
+
+  if (strcmp(key, "progress") == 0) {
+    c->end = strcmp(val, "end") == 0;
+    p->last = *c;
+    p->blocks++;
+    /* Keep values that are only printed when they change. */
+    c->end = false;
+    return true;
+  }
+
+  if (strcmp(key, "out_time_us") == 0 || strcmp(key, "out_time_ms") == 0) {
+    /* out_time_ms is microseconds too (a long-standing FFmpeg misnomer). */
+    long long us = strtoll(val, &end, 10);
+    if (end != val && us >= 0) c->out_time_s = (double)us / 1e6;
+  } else if (strcmp(key, "out_time") == 0) {
+    double t = parse_clock(val);
+    if (t >= 0.0) c->out_time_s = t;
+  } else if (strcmp(key, "speed") == 0) {
+    double s = strtod(val, &end);
+    c->speed = (end != val && s > 0.0) ? s : 0.0;
+  } else if (strcmp(key, "fps") == 0) {
+    double f = strtod(val, &end);
+    c->fps = (end != val && f > 0.0) ? f : 0.0;
+  } else if (strcmp(key, "frame") == 0) {
+    c->frame = strtoll(val, NULL, 10);
+  } else if (strcmp(key, "total_size") == 0) {
+    long long n = strtoll(val, &end, 10);
+    c->total_size = end != val ? n : -1;
+  }
+  return false;
+}
+
+double ffprogress_eta(const FfProgress *pr, double total_s, double elapsed_s) {
+  if (total_s <= 0.0) return -1.0;
+  if (pr->end) return 0.0;
+  double left = total_s - pr->out_time_s;
+  if (left <= 0.0) return 0.0;
+  if (pr->speed > 0.0) return left / pr->speed;
+  if (pr->out_time_s > 0.0 && elapsed_s > 0.0) return left * elapsed_s / pr->out_time_s;
+  return -1.0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parser for FFmpeg's machine-readable "-progress" output: blocks of
+// key=value lines, each closed by progress=continue or progress=end.
+// Feed it stdout one line at a time; a snapshot is ready whenever
+// ffprogress_feed() returns true.
+
+typedef struct {
+  double out_time_s;        // media time written so far
+  double speed;             // encode speed as a multiple of realtime; 0 = unknown
+  double fps;               // 0 = unknown
+  long long frame;
+  long long total_size;     // bytes written; -1 = unknown
+  bool end;                 // last block (progress=end)
+} FfProgress;
+
+typedef struct {
+  FfProgress cur;           // fields seen so far in the current block
+  FfProgress last;          // most recently completed block
+  size_t blocks;
+} FfProgressParser;
+
+void ffprogress_init(FfProgressParser *p);
+
+// One line without its newline. Returns true when it completed a block;
+// the result is then in p->last.
+bool ffprogress_feed(FfProgressParser *p, const char *line, size_t len);
+
+// Remaining wall time to reach total_s of output, from the reported speed or,
+// failing that, the average rate over elapsed_s. Negative when unknown.
+double ffprogress_eta(const FfProgress *pr, double total_s, double elapsed_s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "fileview.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+/* Below this, one read into a buffer is cheaper than setting up a mapping. */
+#define FILE_VIEW_MAP_MIN (64u * 1024u)
+
+static void view_from_buf(FileView *v, char *buf, size_t len) {
+  v->buf = buf;
+  v->data = buf;
+  v->len = len;
+}
+
+/* Reads until EOF with geometric growth; the result is NUL-terminated. With
+   an exact size hint the buffer is allocated once (the spare byte lets fread
+   see EOF without growing). */
+static bool read_all(FileView *v, FILE *f, size_t hint) {
+  size_t cap = hint ? hint + 2 : 4096, len = 0;
+  char *buf = (char *)malloc(cap);
+  if (!buf) die("OOM");
+  for (;;) {
+    if (len + 1 == cap) {
+      cap *= 2;
+      char *p = (char *)realloc(buf, cap);
+      if (!p) die("OOM");
+      buf = p;
+    }
+    size_t n = fread(buf + len, 1, cap - len - 1, f);
+    len += n;
+    if (n == 0) break;
+  }
+  if (ferror(f)) {
+    free(buf);
+    return false;
+  }
+  buf[len] = 0;
+  view_from_buf(v, buf, len);
+  return true;
+}
+
+bool file_view_read_stream(FileView *v, FILE *f) {
+  memset(v, 0, sizeof(*v));
+  return f && read_all(v, f, 0);
+}
+
+#if defined(_WIN32)
+
+bool file_view_open(FileView *v, const char *path) {
+  memset(v, 0, sizeof(*v));
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  long n = -1;
+  if (fseek(f, 0, SEEK_END) == 0) n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  bool ok = read_all(v, f, n > 0 ? (size_t)n : 0);
+  fclose(f);
+  return ok;
+}
+
+#else
+
+bool file_view_open(FileView *v, const char *path) {
+  memset(v, 0, sizeof(*v));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  if (regular && (size_t)st.st_size >= FILE_VIEW_MAP_MIN) {
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m != MAP_FAILED) {
+      posix_madvise(m, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+      close(fd);
+      v->map = m;
+      v->map_len = (size_t)st.st_size;
+      v->data = (const char *)m;
+      v->len = (size_t)st.st_size;
+      v->mapped = true;
+      return true;
+    }
+  }
+
+  /* Small file, special file, or mmap refused: plain buffered read. */
+  FILE *f = fdopen(fd, "rb");
+  if (!f) {
+    int e = errno;
+    close(fd);
+    errno = e;
+    return false;
+  }
+  bool ok = read_all(v, f, regular ? (size_t)st.st_size : 0);
+  fclose(f);
+  return ok;
+}
+
+#endif
+
+void file_view_close(FileView *v) {
+  if (!v) return;
+#if !defined(_WIN32)
+  if (v->map) munmap(v->map, v->map_len);
+#endif
+  free(v->buf);
+  memset(v, 0, sizeof(*v));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Read-only (ptr, len) view of a whole input. Large regular files are mapped
+// (with a sequential-access hint) so subtitles and scripts are never copied;
+// small files and pipes are read into one buffer.
+//
+// Mapped data is NOT NUL-terminated: consumers work on data/len. Views that
+// were read into memory (small files, streams) do carry a terminator.
+
+typedef struct {
+  const char *data;         // never NULL after a successful open ("" when empty)
+  size_t len;
+  bool mapped;
+
+  // Internal.
+  void *map;
+  size_t map_len;
+  char *buf;
+} FileView;
+
+// False if the file cannot be opened or read (errno is left set).
+bool file_view_open(FileView *v, const char *path);
+
+// Drains a stream (e.g. from popen) into the view; the stream stays open.
+bool file_view_read_stream(FileView *v, FILE *f);
+
+// Safe on a zeroed or already-closed view.
+void file_view_close(FileView *v);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,8 +3,9 @@
 #include <ctype.h>
 #include <errno.h>
 #include <math.h>
-#include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,16 +16,16 @@
   #include <windows.h>
   #include <direct.h>
   #include <io.h>
+  #include <process.h>
 
   #ifndef __MINGW32__
     #define strcasecmp  _stricmp
     #define strncasecmp _strnicmp
   #endif
 
-  #define popen  _popen
-  #define pclose _pclose
   #define unlink _unlink
   #define lstat  stat
+  #define getpid _getpid
 
   #ifndef strdup
     #define strdup _strdup
@@ -33,6 +34,7 @@
   static int mkdir_portable(const char *p, int mode) { (void)mode; return _mkdir(p); }
   #define mkdir(p,m) mkdir_portable((p),(m))
 #else
+  #include <pthread.h>
   #include <strings.h>
   #include <unistd.h>
   #include <dirent.h>
@@ -42,6 +44,23 @@
 #include "cJSON.h"
 
 #include "generator.h"
+#include "arena.h"
+#include "audiomix.h"
+#include "fetch.h"
+#include "ffprogress.h"
+#include "fileview.h"
+#include "htmlscan.h"
+#include "http.h"
+#include "jobqueue.h"
+#include "jsonw.h"
+#include "log.h"
+#include "lookupcache.h"
+#include "metrics.h"
+#include "plan.h"
+#include "proc.h"
+#include "runctl.h"
+#include "subtitles.h"
+#include "textproc.h"
 
 #ifdef PATH_MAX
   #undef PATH_MAX
@@ -56,10 +75,49 @@ static const int MAX_TOTAL_DURATION = (int)(4.5 * 60);
 
 static const double MAX_VIDEO_SPEEDUP = 1.75;
 
-typedef struct {
-  char *data;
-  size_t size;
-} MemBuf;
+/* Soundtrack levels: narration over music is lifted; narration without
+   music keeps its own level. The music plays at BGM_GAIN where nobody speaks
+   and is ducked to a fifth of that (BGM_GAIN * depth) under narration, with
+   the curve computed from the clip timeline before mixing (see audiomix.h). */
+static const float NARRATION_GAIN = 1.25f;
+static const float BGM_GAIN = 0.25f;
+static const AudioMixDuck BGM_DUCK = {
+  .depth = 0.2f, .attack_s = 0.3, .release_s = 0.8, .hold_s = 1.0
+};
+
+/* Music parts skip each song's intro; songs not much longer than that are
+   left out. */
+static const double BGM_SKIP_SECONDS = 40.0;
+static const double BGM_MIN_SONG_SECONDS = 60.0;
+#define MAX_BGM_PARTS 200
+
+/* Clip encoders allowed to run at once while TTS continues for later clips
+   (GeneratorOptions.clip_encoders, capped at MAX_CLIP_ENCODERS). */
+#define DEFAULT_CLIP_ENCODERS 3
+#define MAX_CLIP_ENCODERS 16
+
+/* Narration requests in flight per movie (GeneratorOptions.tts_jobs). */
+#define MAX_TTS_JOBS 16
+
+/* Movies processed at once (GeneratorOptions.workers). */
+#define MAX_WORKERS 16
+
+/* Clip shards per movie (GeneratorOptions.shards). */
+#define MAX_SHARDS 64
+
+/* Clip length of the preview render. */
+#define PREVIEW_SECONDS 30
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #define GEN_TLS __declspec(thread)
+#else
+  #define GEN_TLS _Thread_local
+#endif
+
+/* Transient allocations of the movie being processed (tool arguments, plan,
+   cJSON trees); one per worker thread, bound for cJSON and reset after each
+   movie. */
+static GEN_TLS Arena *g_movie_arena = NULL;
 
 /* ------------------------ Windows dirent fallback (MSVC) ------------------------ */
 #if defined(_WIN32) && !defined(__MINGW32__) && !defined(__MINGW64__)
@@ -116,48 +174,6 @@ typedef struct {
   }
 #endif
 
-/* ------------------------ Log hook plumbing (for UI) ------------------------ */
-static GeneratorLogHook g_log_hook = NULL;
-
-void generator_set_log_hook(GeneratorLogHook hook) {
-  g_log_hook = hook;
-}
-
-static void logv(const char *tag, const char *fmt, va_list ap) {
-  char msg[2048];
-
-  va_list ap2;
-  va_copy(ap2, ap);
-  vsnprintf(msg, sizeof(msg), fmt, ap2);
-  va_end(ap2);
-
-  fprintf(stderr, "[%s] %s\n", tag, msg);
-
-  if (g_log_hook) {
-    char line[2200];
-    snprintf(line, sizeof(line), "[%s] %s", tag, msg);
-    g_log_hook(line);
-  }
-}
-
-static void logi(const char *fmt, ...) {
-  va_list ap; va_start(ap, fmt); logv("INFO", fmt, ap); va_end(ap);
-}
-static void logok(const char *fmt, ...) {
-  va_list ap; va_start(ap, fmt); logv("OK", fmt, ap); va_end(ap);
-}
-static void logw(const char *fmt, ...) {
-  va_list ap; va_start(ap, fmt); logv("WARN", fmt, ap); va_end(ap);
-}
-
-static void die(const char *fmt, ...) {
-  va_list ap;
-  va_start(ap, fmt);
-  logv("FATAL", fmt, ap);
-  va_end(ap);
-  exit(1);
-}
-
 static bool file_exists(const char *p) {
   struct stat st;
   return (stat(p, &st) == 0) && S_ISREG(st.st_mode);
@@ -174,31 +190,25 @@ static bool dir_exists(const char *p) {
   return (stat(p, &st) == 0) && S_ISDIR(st.st_mode);
 }
 
+/* Creates missing parents too, so alternate directories may be nested paths. */
 static void ensure_dir(const char *p) {
   if (dir_exists(p)) return;
-  if (mkdir(p, 0755) != 0 && errno != EEXIST) {
-    die("mkdir failed for %s: %s", p, strerror(errno));
-  }
-}
 
-static char *read_entire_file(const char *path) {
-  FILE *f = fopen(path, "rb");
-  if (!f) return NULL;
-  fseek(f, 0, SEEK_END);
-  long n = ftell(f);
-  fseek(f, 0, SEEK_SET);
-  if (n < 0) { fclose(f); return NULL; }
+  char parent[PATH_MAX];
+  snprintf(parent, sizeof(parent), "%s", p);
+  char *sep = strrchr(parent, '/');
+#ifdef _WIN32
+  char *bs = strrchr(parent, '\\');
+  if (bs && (!sep || bs > sep)) sep = bs;
+#endif
+  if (sep && sep != parent && sep[-1] != ':') {
+    *sep = 0;
+    ensure_dir(parent);
+  }
 
-  char *buf = (char *)malloc((size_t)n + 1);
-  if (!buf) die("OOM");
-  if (fread(buf, 1, (size_t)n, f) != (size_t)n) {
-    fclose(f);
-    free(buf);
-    return NULL;
+  if (mkdir(p, 0755) != 0 && errno != EEXIST) {
+    die("mkdir failed for %s: %s", p, strerror(errno));
   }
-  fclose(f);
-  buf[n] = '\0';
-  return buf;
 }
 
 static bool write_entire_file(const char *path, const void *data, size_t len) {
@@ -212,178 +222,355 @@ static bool write_entire_file(const char *path, const void *data, size_t len) {
   return true;
 }
 
-static size_t curl_write_cb(void *contents, size_t size, size_t nmemb, void *userp) {
-  size_t realsz = size * nmemb;
-  MemBuf *mem = (MemBuf *)userp;
-  char *p = (char *)realloc(mem->data, mem->size + realsz + 1);
-  if (!p) return 0;
-  mem->data = p;
-  memcpy(&(mem->data[mem->size]), contents, realsz);
-  mem->size += realsz;
-  mem->data[mem->size] = 0;
-  return realsz;
+/* Moves a finished file into place in one step, so readers (and
+   title_is_done / title_skip_reason) never see a partial one. */
+static bool publish_file(const char *tmp, const char *path) {
+#ifdef _WIN32
+  unlink(path);
+#endif
+  if (rename(tmp, path) != 0) {
+    unlink(tmp);
+    return false;
+  }
+  return true;
 }
 
-static MemBuf http_get_to_mem_ex(const char *url, long *http_code_out) {
-  CURL *curl = curl_easy_init();
-  if (!curl) die("curl_easy_init failed");
+/* Write to a sibling temp file, then rename over the target, so readers never
+   see a half-written file. */
+static bool write_file_atomic(const char *path, const void *data, size_t len) {
+  char tmp[PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.part", path);
+  if (!write_entire_file(tmp, data, len)) {
+    unlink(tmp);
+    return false;
+  }
+  return publish_file(tmp, path);
+}
 
-  MemBuf buf = (MemBuf){0};
+/* ------------------------ Run options ------------------------ */
+
+/* Options of the current run with every default filled in; set before the
+   workers start and read-only while they run. */
+static GeneratorOptions g_opt;
+static char g_srt_dir[1024];         /* <scripts_dir>/srt_files */
+
+static GeneratorTitleHook g_title_hook = NULL;
+
+static JobQueue *g_jobs = NULL;      /* shared queue, when jobs_dir is set */
+static char g_node_work_dir[1024];   /* <work_dir>/<node>-<pid> when processes share dirs */
+static char g_node[128];             /* this process in claim files */
+
+void generator_options_init(GeneratorOptions *o) {
+  memset(o, 0, sizeof(*o));
+  o->movies_dir = "movies";
+  o->output_dir = "output";
+  o->vertical_dir = "tiktok_output";
+  o->preview_dir = "previews";
+  o->retired_dir = "movies_retired";
+  o->work_dir = "clips";
+  o->scripts_dir = "scripts";
+  o->music_dir = "backgroundmusic";
+  o->config_path = "config.json";
+  o->shard_dir = "shards";
+  o->mode = GENERATOR_MODE_RENDER;
+  o->outputs = GENERATOR_OUT_HORIZONTAL | GENERATOR_OUT_VERTICAL;
+  o->workers = 1;
+  o->clip_encoders = DEFAULT_CLIP_ENCODERS;
+  o->tts_jobs = 1;
+}
 
-  curl_easy_setopt(curl, CURLOPT_URL, url);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+static int clamp_int(int v, int lo, int hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
 
-  curl_easy_setopt(curl, CURLOPT_USERAGENT,
-                   "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) "
-                   "AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.0 Safari/605.1.15");
-  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
-  curl_easy_setopt(curl, CURLOPT_COOKIEFILE, "");
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+static void resolve_options(const GeneratorOptions *in) {
+  GeneratorOptions d;
+  generator_options_init(&d);
+  g_opt = in ? *in : d;
+
+#define OPT_DIR(f) if (!g_opt.f || !g_opt.f[0]) g_opt.f = d.f
+  OPT_DIR(movies_dir);
+  OPT_DIR(output_dir);
+  OPT_DIR(vertical_dir);
+  OPT_DIR(preview_dir);
+  OPT_DIR(retired_dir);
+  OPT_DIR(work_dir);
+  OPT_DIR(scripts_dir);
+  OPT_DIR(music_dir);
+  OPT_DIR(config_path);
+  OPT_DIR(shard_dir);
+#undef OPT_DIR
+
+  if (g_opt.outputs == 0) g_opt.outputs = d.outputs;
+  if (g_opt.num_clips < 0) g_opt.num_clips = 0;
+  g_opt.workers = clamp_int(g_opt.workers ? g_opt.workers : 1, 1, MAX_WORKERS);
+  g_opt.clip_encoders = clamp_int(g_opt.clip_encoders ? g_opt.clip_encoders : DEFAULT_CLIP_ENCODERS,
+                                  1, MAX_CLIP_ENCODERS);
+  g_opt.tts_jobs = clamp_int(g_opt.tts_jobs ? g_opt.tts_jobs : 1, 1, MAX_TTS_JOBS);
+  g_opt.shards = clamp_int(g_opt.shards, 0, MAX_SHARDS);
+
+  snprintf(g_srt_dir, sizeof(g_srt_dir), "%s/srt_files", g_opt.scripts_dir);
+  if (!g_opt.plans_dir || !g_opt.plans_dir[0]) g_opt.plans_dir = g_srt_dir;
+}
 
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&buf);
+void generator_set_title_hook(GeneratorTitleHook hook) {
+  g_title_hook = hook;
+}
 
-  CURLcode res = curl_easy_perform(curl);
+const char *generator_title_status_name(GeneratorTitleStatus s) {
+  switch (s) {
+    case GENERATOR_TITLE_DONE:      return "done";
+    case GENERATOR_TITLE_PLANNED:   return "planned";
+    case GENERATOR_TITLE_PENDING:   return "pending";
+    case GENERATOR_TITLE_SKIPPED:   return "skipped";
+    case GENERATOR_TITLE_FAILED:    return "failed";
+    case GENERATOR_TITLE_CANCELLED: return "cancelled";
+  }
+  return "unknown";
+}
 
-  long code = 0;
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
-  if (http_code_out) *http_code_out = code;
+/* ------------------------ Run status ------------------------ */
+
+/* Read by generator_status() from any thread while the run updates them. */
+static atomic_int g_run_state = GENERATOR_IDLE;
+static atomic_int g_run_done = 0;
+static atomic_int g_run_finished = 0;
+static atomic_int g_run_queued = 0;
+static atomic_int g_run_result = 0;
+static atomic_int g_run_clips_planned = 0;
+static atomic_int g_run_encoders = 0;
+static atomic_ullong g_movie_built_base = 0;     /* clip counters when the movie started */
+static atomic_ullong g_movie_failed_base = 0;
+static _Atomic(const char *) g_run_stage = NULL;
+
+/* Title and start times change together; a tiny spinlock keeps them consistent. */
+static char g_run_movie[256];
+static double g_run_started = 0.0;
+static double g_movie_started = 0.0;
+static atomic_flag g_run_movie_lock = ATOMIC_FLAG_INIT;
+
+static void run_movie_lock(void) {
+  while (atomic_flag_test_and_set_explicit(&g_run_movie_lock, memory_order_acquire)) { }
+}
 
-  curl_easy_cleanup(curl);
+static void run_movie_unlock(void) {
+  atomic_flag_clear_explicit(&g_run_movie_lock, memory_order_release);
+}
 
-  if (res != CURLE_OK) {
-    if (buf.data) free(buf.data);
-    die("GET failed: %s (%s)", url, curl_easy_strerror(res));
-  }
+static void set_run_movie(const char *title) {
+  atomic_store(&g_movie_built_base, metrics_counter_get(METRIC_CLIPS_BUILT));
+  atomic_store(&g_movie_failed_base, metrics_counter_get(METRIC_CLIPS_FAILED));
+  atomic_store(&g_run_clips_planned, 0);
+  atomic_store(&g_run_stage, (const char *)NULL);
 
-  return buf;
+  run_movie_lock();
+  snprintf(g_run_movie, sizeof(g_run_movie), "%s", title);
+  g_movie_started = metrics_now();
+  run_movie_unlock();
 }
 
-static MemBuf http_post_json_to_mem(const char *url, const char *bearer_key, const char *json_body,
-                                   long *http_code_out, long timeout_s) {
-  CURL *curl = curl_easy_init();
-  if (!curl) die("curl init failed");
+/* Ends the status of a finished movie unless another worker has started one
+   since. */
+static void clear_run_movie(const char *title) {
+  run_movie_lock();
+  bool mine = strcmp(g_run_movie, title) == 0;
+  if (mine) g_run_movie[0] = 0;
+  run_movie_unlock();
+  if (mine) atomic_store(&g_run_stage, (const char *)NULL);
+}
 
-  MemBuf buf = (MemBuf){0};
+/* Stage of the movie on this worker thread; names the failing stage in the
+   per-title report. */
+static GEN_TLS const char *t_stage = NULL;
 
-  struct curl_slist *headers = NULL;
-  headers = curl_slist_append(headers, "Content-Type: application/json");
+/* Stage shown in the UI and tagged on log records from this thread. */
+static void enter_stage(MetricsStage st) {
+  const char *name = metrics_stage_name(st);
+  t_stage = name;
+  log_set_stage(name);
+  atomic_store(&g_run_stage, name);
+}
 
-  char auth[1024];
-  snprintf(auth, sizeof(auth), "Authorization: Bearer %s", bearer_key);
-  headers = curl_slist_append(headers, auth);
+/* Claims this thread works under, innermost first: the title in queue mode,
+   and a shard of it while building one. */
+typedef struct Lease {
+  JobQueue *jq;
+  const char *name;
+  struct Lease *outer;
+} Lease;
 
-  curl_easy_setopt(curl, CURLOPT_URL, url);
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_body);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(json_body));
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_cb);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&buf);
+static GEN_TLS Lease *t_lease = NULL;
+static GEN_TLS bool t_lost = false;   /* another worker took one of them over */
 
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_s);
-  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+static bool lease_lost(void) {
+  for (Lease *l = t_lease; l && !t_lost; l = l->outer) t_lost = jobq_lost(l->jq, l->name);
+  return t_lost;
+}
 
-  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
-  curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 60L);
-  curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 30L);
+/* The movie should stop: the run was cancelled, or the title (or shard) now
+   belongs to another worker, which redoes it from the start. */
+static bool movie_stopped(void) {
+  return runctl_cancelled() || lease_lost();
+}
 
-  CURLcode res = curl_easy_perform(curl);
+/* runctl_checkpoint() for the movie on this thread. */
+static bool movie_checkpoint(void) {
+  return runctl_checkpoint() && !lease_lost();
+}
 
-  long code = 0;
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
-  if (http_code_out) *http_code_out = code;
+/* ------------------------ External tools ------------------------ */
+
+/* "[cmd] ..." line for the console and the UI log; display only, never run
+   through a shell. */
+static void log_command(const char *const *argv) {
+  char line[8192];
+  size_t len = 0;
+  for (const char *const *a = argv; *a && len + 1 < sizeof(line); a++) {
+    bool quote = (*a)[0] == 0 || strpbrk(*a, " \"'[];") != NULL;
+    int n = snprintf(line + len, sizeof(line) - len, quote ? "%s'%s'" : "%s%s",
+                     a == argv ? "" : " ", *a);
+    if (n < 0) break;
+    len += (size_t)n;
+  }
+  if (len >= sizeof(line)) len = sizeof(line) - 1;
+  line[len] = 0;
+
+  fprintf(stderr, "[cmd] %s\n", line);
+  log_hook_line(line);
+}
 
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
+static bool proc_should_cancel(void *user) {
+  (void)user;
+  return movie_stopped();
+}
 
-  if (res != CURLE_OK) {
-    if (buf.data) free(buf.data);
-    die("POST failed: %s", curl_easy_strerror(res));
-  }
+static bool proc_should_pause(void *user) {
+  (void)user;
+  return runctl_paused();
+}
 
-  return buf;
+/* One running FFmpeg with its "-progress" parser; lives in the movie arena. */
+typedef struct {
+  Proc *proc;
+  MetricsStage stage;
+  int clip;
+  double total_s;
+  double started;
+  FfProgressParser progress;
+} Encode;
+
+static GeneratorProgressHook g_progress_hook = NULL;
+
+void generator_set_progress_hook(GeneratorProgressHook hook) {
+  g_progress_hook = hook;
 }
 
-/* Cross-platform "shell escape" for file paths in system() commands */
-static char *sh_escape(const char *s) {
-  size_t n = strlen(s);
-#ifdef _WIN32
-  /* use "..." for cmd.exe */
-  size_t cap = n * 2 + 3;
-  char *out = (char *)malloc(cap);
-  if (!out) die("OOM");
-  size_t j = 0;
-  out[j++] = '"';
-  for (size_t i = 0; i < n; i++) {
-    if (s[i] == '"') {
-      if (j + 2 >= cap) { cap *= 2; out = (char *)realloc(out, cap); if (!out) die("OOM"); }
-      out[j++] = '"';
-      out[j++] = '"';
-    } else {
-      if (j + 2 >= cap) { cap *= 2; out = (char *)realloc(out, cap); if (!out) die("OOM"); }
-      out[j++] = s[i];
-    }
+static void emit_progress(const Encode *e, const FfProgress *pr, bool done) {
+  if (!g_progress_hook) return;
+  GeneratorProgress ev = {
+    .stage = metrics_stage_name(e->stage),
+    .clip = e->clip,
+    .out_time_s = pr->out_time_s,
+    .total_s = e->total_s,
+    .speed = pr->speed,
+    .fps = pr->fps,
+    .elapsed_s = metrics_now() - e->started,
+    .done = done
+  };
+  ev.eta_s = done ? 0.0 : ffprogress_eta(pr, e->total_s, ev.elapsed_s);
+  g_progress_hook(&ev);
+}
+
+static void encode_on_line(void *user, const char *line, size_t len) {
+  Encode *e = (Encode *)user;
+  if (ffprogress_feed(&e->progress, line, len) && !e->progress.last.end) {
+    emit_progress(e, &e->progress.last, false);
   }
-  out[j++] = '"';
-  out[j] = 0;
-  return out;
-#else
-  /* POSIX single-quote escaping */
-  size_t cap = n * 4 + 3;
-  char *out = (char *)malloc(cap);
-  if (!out) die("OOM");
-  size_t j = 0;
-  out[j++] = '\'';
-  for (size_t i = 0; i < n; i++) {
-    if (s[i] == '\'') {
-      memcpy(out + j, "'\\''", 4);
-      j += 4;
+}
+
+/* Starts ffmpeg with machine-readable progress on stdout. argv has no
+   progress flags of its own; total_s is the expected output duration
+   (0 if unknown) and drives the ETA. */
+static Encode *start_ffmpeg(const char *const *argv, MetricsStage stage, int clip, double total_s) {
+  size_t argc = 0;
+  while (argv[argc]) argc++;
+
+  const char **full = (const char **)arena_alloc(g_movie_arena, (argc + 4) * sizeof(*full));
+  full[0] = argv[0];
+  full[1] = "-progress";
+  full[2] = "pipe:1";
+  full[3] = "-nostats";
+  memcpy(full + 4, argv + 1, argc * sizeof(*full));   /* includes the NULL */
+  log_command(full);
+
+  Encode *e = (Encode *)arena_alloc(g_movie_arena, sizeof(*e));
+  e->stage = stage;
+  e->clip = clip;
+  e->total_s = total_s;
+  e->started = metrics_now();
+  ffprogress_init(&e->progress);
+
+  atomic_fetch_add(&g_run_encoders, 1);
+  ProcSpec spec = {
+    .argv = full,
+    .on_stdout_line = encode_on_line,
+    .should_cancel = proc_should_cancel,
+    .should_pause = proc_should_pause,
+    .user = e
+  };
+  e->proc = proc_start(&spec);
+  return e;
+}
+
+/* Reaps an encoder started with start_ffmpeg(), accounts its time and
+   reports failures with the end of its stderr. */
+static bool finish_ffmpeg(Encode *e) {
+  ProcResult r = proc_finish(e->proc);
+  e->proc = NULL;
+  atomic_fetch_sub(&g_run_encoders, 1);
+  metrics_add_encode_seconds(r.seconds);
+  bool ok = proc_ok(&r);
+  if (!ok && r.status == PROC_CANCELLED) {
+    logi("ffmpeg stopped (run cancelled)");
+  } else if (!ok) {
+    if (r.status == PROC_EXITED) logw("ffmpeg exited with %d", r.exit_code);
+    else logw("ffmpeg %s", proc_status_name(r.status));
+    size_t n = strlen(r.err_tail);
+    while (n > 0 && isspace((unsigned char)r.err_tail[n - 1])) r.err_tail[--n] = 0;
+    if (n > 0) logw("ffmpeg: %s", r.err_tail);
+  }
+  proc_result_free(&r);
+
+  const FfProgress *pr = &e->progress.last;
+  if (ok && pr->speed > 0.0 && pr->speed < 1.0 && pr->out_time_s >= 2.0) {
+    if (e->clip) {
+      logw("clip %d encode ran below realtime: %.2fx (%.1fs of media in %.1fs)",
+           e->clip, pr->speed, pr->out_time_s, r.seconds);
     } else {
-      out[j++] = s[i];
+      logw("%s encode ran below realtime: %.2fx (%.1fs of media in %.1fs)",
+           metrics_stage_name(e->stage), pr->speed, pr->out_time_s, r.seconds);
     }
   }
-  out[j++] = '\'';
-  out[j] = 0;
-  return out;
-#endif
+  emit_progress(e, pr, true);
+  return ok;
 }
 
-static int run_cmd(const char *fmt, ...) {
-  char cmd[8192];
-  va_list ap;
-  va_start(ap, fmt);
-  vsnprintf(cmd, sizeof(cmd), fmt, ap);
-  va_end(ap);
-
-  fprintf(stderr, "[cmd] %s\n", cmd);
-  if (g_log_hook) g_log_hook(cmd);
-  return system(cmd);
-}
-
-static char *popen_read_all(const char *cmd) {
-  FILE *p = popen(cmd, "r");
-  if (!p) return NULL;
-  char *buf = NULL;
-  size_t cap = 0, len = 0;
-  char tmp[4096];
-  while (fgets(tmp, sizeof(tmp), p)) {
-    size_t tlen = strlen(tmp);
-    if (len + tlen + 1 > cap) {
-      cap = (cap == 0) ? 8192 : cap * 2;
-      buf = (char *)realloc(buf, cap);
-      if (!buf) die("OOM");
-    }
-    memcpy(buf + len, tmp, tlen);
-    len += tlen;
+static bool run_ffmpeg(const char *const *argv, MetricsStage stage, double total_s) {
+  Encode *e = start_ffmpeg(argv, stage, 0, total_s);
+  proc_wait(e->proc);
+  return finish_ffmpeg(e);
+}
+
+/* ffprobe's stdout as a NUL-terminated string, or NULL. free() the result. */
+static char *run_ffprobe(const char *const *argv) {
+  ProcResult r = proc_run(&(ProcSpec){
+    .argv = argv, .capture_stdout = true, .should_cancel = proc_should_cancel
+  });
+  if (!proc_ok(&r) || !r.out) {
+    proc_result_free(&r);
+    return NULL;
   }
-  if (buf) buf[len] = 0;
-  pclose(p);
-  return buf;
+  return r.out;
 }
 
 static bool ffprobe_video_dimensions(const char *path, int *out_w, int *out_h) {
@@ -391,24 +578,18 @@ static bool ffprobe_video_dimensions(const char *path, int *out_w, int *out_h) {
   *out_w = 0;
   *out_h = 0;
 
-  char *esc = sh_escape(path);
-  char cmd[8192];
-  snprintf(cmd, sizeof(cmd),
-           "ffprobe -v error -select_streams v:0 "
-           "-show_entries stream=width,height "
-           "-of csv=s=x:p=0 %s",
-           esc);
-  free(esc);
-
-  char *out = popen_read_all(cmd);
+  const char *argv[] = {
+    "ffprobe", "-v", "error", "-select_streams", "v:0",
+    "-show_entries", "stream=width,height",
+    "-of", "csv=s=x:p=0", path, NULL
+  };
+  char *out = run_ffprobe(argv);
   if (!out) return false;
 
   int w = 0, h = 0;
-  if (sscanf(out, "%dx%d", &w, &h) != 2) {
-    free(out);
-    return false;
-  }
+  int got = sscanf(out, "%dx%d", &w, &h);
   free(out);
+  if (got != 2) return false;
 
   if (w <= 0 || h <= 0) return false;
   *out_w = w;
@@ -417,14 +598,11 @@ static bool ffprobe_video_dimensions(const char *path, int *out_w, int *out_h) {
 }
 
 static double ffprobe_duration_seconds(const char *path) {
-  char *esc = sh_escape(path);
-  char cmd[8192];
-  snprintf(cmd, sizeof(cmd),
-           "ffprobe -v error -show_entries format=duration "
-           "-of default=noprint_wrappers=1:nokey=1 %s",
-           esc);
-  free(esc);
-  char *out = popen_read_all(cmd);
+  const char *argv[] = {
+    "ffprobe", "-v", "error", "-show_entries", "format=duration",
+    "-of", "default=noprint_wrappers=1:nokey=1", path, NULL
+  };
+  char *out = run_ffprobe(argv);
   if (!out) return -1.0;
   double d = atof(out);
   free(out);
@@ -436,15 +614,58 @@ typedef struct {
   char eleven_key[512];
   char eleven_voice_id[128];
   char eleven_model_id[128];
+
+  /* Service base URLs (scheme://host[:port], no trailing slash). Overridable so
+     the benchmark harness can point the pipeline at local stand-ins. */
+  char subf2m_base[256];
+  char imsdb_base[256];
+  char openai_base[256];
+  char eleven_base[256];
+  char opensubs_base[256];
+
+  /* Optional second subtitle provider; skipped when no key is configured. */
+  char opensubs_key[256];
 } Config;
 
-static Config load_config_json(const char *path) {
+/* Outcomes of subtitle / IMSDb lookups, shared by one run_generation() call;
+   kept in <scripts_dir>/lookup_cache.db. */
+#define LOOKUP_TTL_HIT        (90L * 24 * 3600)
+#define LOOKUP_TTL_TITLE_MISS (3L * 24 * 3600)
+#define LOOKUP_TTL_URL_MISS   (7L * 24 * 3600)
+
+static LookupCache *g_lookups = NULL;
+
+static void format_local_time(long long t, char *out, size_t outsz) {
+  time_t tt = (time_t)t;
+  struct tm tmv;
+#ifdef _WIN32
+  localtime_s(&tmv, &tt);
+#else
+  localtime_r(&tt, &tmv);
+#endif
+  strftime(out, outsz, "%Y-%m-%d %H:%M", &tmv);
+}
+
+static void config_base_url(const cJSON *root, const char *key, const char *def,
+                            char *out, size_t outsz) {
+  const cJSON *v = cJSON_GetObjectItemCaseSensitive(root, key);
+  const char *src = (cJSON_IsString(v) && v->valuestring && v->valuestring[0]) ? v->valuestring : def;
+  strncpy(out, src, outsz - 1);
+  out[outsz - 1] = 0;
+
+  size_t n = strlen(out);
+  while (n > 0 && out[n - 1] == '/') out[--n] = 0;
+}
+
+/* Planning needs the OpenAI key, rendering the ElevenLabs one; a box that
+   only does one half can leave the other key out. */
+static Config load_config_json(const char *path, bool need_openai, bool need_tts) {
   Config c = {0};
-  char *txt = read_entire_file(path);
-  if (!txt) die("Missing config.json (expected at %s)", path);
+  FileView txt;
+  if (!file_view_open(&txt, path)) die("Missing config.json (expected at %s)", path);
 
-  cJSON *root = cJSON_Parse(txt);
-  free(txt);
+  cJSON *root = cJSON_ParseWithLength(txt.data, txt.len);
+  file_view_close(&txt);
   if (!root) die("config.json parse failed");
 
   const cJSON *ok  = cJSON_GetObjectItemCaseSensitive(root, "open_api_key");
@@ -457,106 +678,25 @@ static Config load_config_json(const char *path) {
   if (cJSON_IsString(vid) && vid->valuestring) strncpy(c.eleven_voice_id, vid->valuestring, sizeof(c.eleven_voice_id)-1);
   if (cJSON_IsString(mid) && mid->valuestring) strncpy(c.eleven_model_id, mid->valuestring, sizeof(c.eleven_model_id)-1);
 
-  if (c.openai_key[0] == 0) die("config.json: open_api_key missing");
-  if (c.eleven_key[0] == 0) die("config.json: elevenlabs_api_key missing");
+  const cJSON *osk = cJSON_GetObjectItemCaseSensitive(root, "opensubtitles_api_key");
+  if (cJSON_IsString(osk) && osk->valuestring) strncpy(c.opensubs_key, osk->valuestring, sizeof(c.opensubs_key)-1);
+
+  if (need_openai && c.openai_key[0] == 0) die("config.json: open_api_key missing");
+  if (need_tts && c.eleven_key[0] == 0) die("config.json: elevenlabs_api_key missing");
   if (c.eleven_voice_id[0] == 0) strncpy(c.eleven_voice_id, "JBFqnCBsd6RMkjVDRZzb", sizeof(c.eleven_voice_id)-1);
   if (c.eleven_model_id[0] == 0) strncpy(c.eleven_model_id, "eleven_multilingual_v2", sizeof(c.eleven_model_id)-1);
 
+  config_base_url(root, "subf2m_base_url",     "https://subf2m.co",        c.subf2m_base, sizeof(c.subf2m_base));
+  config_base_url(root, "imsdb_base_url",      "https://imsdb.com",        c.imsdb_base,  sizeof(c.imsdb_base));
+  config_base_url(root, "openai_base_url",     "https://api.openai.com",   c.openai_base, sizeof(c.openai_base));
+  config_base_url(root, "elevenlabs_base_url", "https://api.elevenlabs.io", c.eleven_base, sizeof(c.eleven_base));
+  config_base_url(root, "opensubtitles_base_url", "https://api.opensubtitles.com",
+                  c.opensubs_base, sizeof(c.opensubs_base));
+
   cJSON_Delete(root);
   return c;
 }
 
-static int timestamp_to_seconds(const char *ts) {
-  int hh = 0, mm = 0, ss = 0, ms = 0;
-  if (sscanf(ts, "%d:%d:%d,%d", &hh, &mm, &ss, &ms) != 4) return -1;
-  (void)ms;
-  return hh * 3600 + mm * 60 + ss;
-}
-
-static bool convert_srt_timestamps_to_seconds(const char *input_srt, const char *output_srt) {
-  FILE *in = fopen(input_srt, "rb");
-  if (!in) return false;
-  FILE *out = fopen(output_srt, "wb");
-  if (!out) {
-    fclose(in);
-    return false;
-  }
-
-  char line[4096];
-  while (fgets(line, sizeof(line), in)) {
-    while (strstr(line, "<i>")) {
-      char *p = strstr(line, "<i>");
-      memmove(p, p + 3, strlen(p + 3) + 1);
-    }
-    while (strstr(line, "</i>")) {
-      char *p = strstr(line, "</i>");
-      memmove(p, p + 4, strlen(p + 4) + 1);
-    }
-
-    char a[64], b[64];
-    if (sscanf(line, "%63s --> %63s", a, b) == 2 && strchr(a, ':') && strchr(b, ':')) {
-      int s1 = timestamp_to_seconds(a);
-      int s2 = timestamp_to_seconds(b);
-      if (s1 >= 0 && s2 >= 0) {
-        fprintf(out, "%d --> %d\n", s1, s2);
-      } else {
-        fputs(line, out);
-      }
-    } else {
-      fputs(line, out);
-    }
-  }
-
-  fclose(in);
-  fclose(out);
-  return true;
-}
-
-static char *strcasestr_local(const char *haystack, const char *needle) {
-  if (!haystack || !needle) return NULL;
-  if (*needle == '\0') return (char *)haystack;
-
-  for (const char *h = haystack; *h; h++) {
-    const char *h2 = h;
-    const char *n2 = needle;
-    while (*h2 && *n2 &&
-           tolower((unsigned char)*h2) == tolower((unsigned char)*n2)) {
-      h2++;
-      n2++;
-    }
-    if (*n2 == '\0') return (char *)h;
-  }
-  return NULL;
-}
-
-static bool href_next(const char **p, char *out, size_t outsz) {
-  const char *s = strstr(*p, "href=");
-  if (!s) return false;
-  s += 5;
-  while (*s && isspace((unsigned char)*s)) s++;
-
-  char q = 0;
-  if (*s == '"' || *s == '\'') { q = *s; s++; }
-  else { *p = s; return false; }
-
-  const char *e = strchr(s, q);
-  if (!e) return false;
-
-  size_t n = (size_t)(e - s);
-  if (n + 1 > outsz) n = outsz - 1;
-  memcpy(out, s, n);
-  out[n] = 0;
-
-  *p = e + 1;
-  return true;
-}
-
-static bool str_ends_with(const char *s, const char *suffix) {
-  size_t ls = strlen(s), lf = strlen(suffix);
-  if (lf > ls) return false;
-  return strcmp(s + (ls - lf), suffix) == 0;
-}
-
 /* ----------------------- NEW HELPERS (IMSDb robustness) ----------------------- */
 
 static void to_lower_copy(const char *in, char *out, size_t outsz) {
@@ -588,55 +728,6 @@ static void url_encode_component(const char *in, char *out, size_t outsz) {
   out[j] = 0;
 }
 
-/* Tiny string builder */
-static void sb_append(char **buf, size_t *len, size_t *cap, const char *s, size_t n) {
-  if (*len + n + 1 > *cap) {
-    *cap = (*cap == 0) ? 8192 : (*cap * 2);
-    while (*len + n + 1 > *cap) *cap *= 2;
-    *buf = (char *)realloc(*buf, *cap);
-    if (!*buf) die("OOM");
-  }
-  memcpy(*buf + *len, s, n);
-  *len += n;
-  (*buf)[*len] = 0;
-}
-
-/* Very simple HTML->text: strips tags, preserves <br> as newline, decodes a few entities */
-static char *html_to_text_basic(const char *html, size_t n, size_t *out_n) {
-  char *out = NULL;
-  size_t len = 0, cap = 0;
-
-  for (size_t i = 0; i < n;) {
-    if (html[i] == '<') {
-      size_t j = i + 1;
-      while (j < n && isspace((unsigned char)html[j])) j++;
-      if (j + 1 < n &&
-          tolower((unsigned char)html[j]) == 'b' &&
-          tolower((unsigned char)html[j + 1]) == 'r') {
-        sb_append(&out, &len, &cap, "\n", 1);
-      }
-      while (i < n && html[i] != '>') i++;
-      if (i < n) i++;
-      continue;
-    }
-
-    if (html[i] == '&') {
-      const char *p = html + i;
-      if (i + 6 <= n && !strncmp(p, "&nbsp;", 6)) { sb_append(&out, &len, &cap, " ", 1); i += 6; continue; }
-      if (i + 5 <= n && !strncmp(p, "&amp;", 5))  { sb_append(&out, &len, &cap, "&", 1); i += 5; continue; }
-      if (i + 4 <= n && !strncmp(p, "&lt;", 4))   { sb_append(&out, &len, &cap, "<", 1); i += 4; continue; }
-      if (i + 4 <= n && !strncmp(p, "&gt;", 4))   { sb_append(&out, &len, &cap, ">", 1); i += 4; continue; }
-    }
-
-    sb_append(&out, &len, &cap, &html[i], 1);
-    i++;
-  }
-
-  if (!out) out = strdup("");
-  if (out_n) *out_n = len;
-  return out;
-}
-
 /* ----------------------- Subtitle downloader ---------------------- */
 
 static void parse_movie_title_slug(const char *movie_title, char *out, size_t outsz) {
@@ -656,157 +747,86 @@ static void parse_movie_title_slug(const char *movie_title, char *out, size_t ou
   if (n >= 2 && strcmp(out + n - 2, "iv") == 0) strncat(out, "-4", outsz - strlen(out) - 1);
 }
 
-static bool download_subtitle_srt(const char *movie_title, const char *dest_srt_path) {
-  ensure_dir("scripts");
-  ensure_dir("scripts/srt_files");
-
-  char slug[512];
-  parse_movie_title_slug(movie_title, slug, sizeof(slug));
-
-  char list_url[1024];
-  snprintf(list_url, sizeof(list_url), "https://subf2m.co/subtitles/%s/english", slug);
-
-  long code = 0;
-  MemBuf page = http_get_to_mem_ex(list_url, &code);
-  if (code < 200 || code >= 300 || !page.data || page.size == 0) {
-    if (page.data) {
-      logw("subf2m list HTTP %ld for %s (body starts: %.200s)", code, list_url, page.data);
-      free(page.data);
-    }
-    return false;
+/* A candidate only counts if it holds at least one cue. */
+static bool srt_text_looks_valid(const char *data, size_t len) {
+  for (const char *p = data, *end = data + len; (p = memchr(p, '-', (size_t)(end - p))) != NULL; p++) {
+    if (end - p >= 3 && p[1] == '-' && p[2] == '>') return true;
   }
+  return false;
+}
 
-  char want_subpage_prefix[768];
-  snprintf(want_subpage_prefix, sizeof(want_subpage_prefix), "/subtitles/%s/english/", slug);
-
-  char subpage_url[1024] = {0};
-
-  {
-    const char *p = page.data;
-    char href[2048];
-    while (href_next(&p, href, sizeof(href))) {
-      if (strncmp(href, want_subpage_prefix, strlen(want_subpage_prefix)) == 0) {
-        if (strstr(href, "english-german")) continue;
-        snprintf(subpage_url, sizeof(subpage_url), "https://subf2m.co%s", href);
-        break;
-      }
+typedef struct {
+  const char *movie_title;
+  const char *dest_srt_path;
+} SubtitleSink;
+
+static bool accept_subtitle(void *user, const char *provider, const char *data, size_t len,
+                            SubsFormat fmt) {
+  const SubtitleSink *sink = (const SubtitleSink *)user;
+
+  char *srt = NULL;
+  size_t srt_len = len;
+  char entry[256] = {0};
+  if (fmt == SUBS_FMT_ZIP) {
+    srt = subs_extract_srt(data, len, &srt_len, entry, sizeof(entry));
+    if (!srt) {
+      logw("%s: archive for %s has no readable .srt entry, trying others", provider, sink->movie_title);
+      return false;
     }
+    data = srt;
   }
 
-  if (subpage_url[0] == 0) {
-    const char *p = page.data;
-    char href[2048];
-    int tried_profiles = 0;
-
-    while (href_next(&p, href, sizeof(href))) {
-      if (strncmp(href, "/u/", 3) != 0) continue;
-
-      char profile_url[1024];
-      snprintf(profile_url, sizeof(profile_url), "https://subf2m.co%s", href);
-
-      long pcode = 0;
-      MemBuf prof = http_get_to_mem_ex(profile_url, &pcode);
-      if (pcode < 200 || pcode >= 300 || !prof.data) {
-        if (prof.data) free(prof.data);
-        continue;
-      }
-
-      const char *pp = prof.data;
-      char phref[2048];
-      while (href_next(&pp, phref, sizeof(phref))) {
-        if (strncmp(phref, want_subpage_prefix, strlen(want_subpage_prefix)) == 0) {
-          snprintf(subpage_url, sizeof(subpage_url), "https://subf2m.co%s", phref);
-          break;
-        }
-      }
-      free(prof.data);
-
-      if (subpage_url[0] != 0) break;
-      if (++tried_profiles >= 12) break;
-    }
+  bool ok = srt_text_looks_valid(data, srt_len);
+  if (!ok) {
+    logw("%s: subtitle for %s has no cues, trying others", provider, sink->movie_title);
+  } else {
+    ok = write_file_atomic(sink->dest_srt_path, data, srt_len);
+    if (ok && entry[0]) logi("%s: picked %s from archive", provider, entry);
   }
 
-  free(page.data);
-
-  if (subpage_url[0] == 0) {
-    logw("subf2m: couldn't locate subtitle detail page for %s (slug=%s)", movie_title, slug);
-    return false;
-  }
+  free(srt);
+  return ok;
+}
 
-  long scode = 0;
-  MemBuf subpage = http_get_to_mem_ex(subpage_url, &scode);
-  if (scode < 200 || scode >= 300 || !subpage.data) {
-    if (subpage.data) free(subpage.data);
-    logw("subf2m: subtitle detail HTTP %ld for %s", scode, subpage_url);
+static bool download_subtitle_srt(const Config *cfg, const char *movie_title, const char *dest_srt_path) {
+  ensure_dir(g_srt_dir);
+
+  char key[600];
+  snprintf(key, sizeof(key), "subs:%s", movie_title);
+  LookupRecord rec;
+  bool cached = lookup_get(g_lookups, key, &rec);
+  if (cached && rec.outcome == LOOKUP_MISS) {
+    char when[64];
+    format_local_time(rec.expires_at, when, sizeof(when));
+    logw("Skipping subtitle search for %s: nothing found on an earlier run (%s, HTTP %d); retry after %s",
+         movie_title, rec.value, rec.http_code, when);
     return false;
   }
 
-  char download_url[1024] = {0};
-  {
-    const char *p = subpage.data;
-    char href[2048];
-    while (href_next(&p, href, sizeof(href))) {
-      if (str_ends_with(href, "download")) {
-        snprintf(download_url, sizeof(download_url), "https://subf2m.co%s", href);
-        break;
-      }
-    }
-  }
-
-  free(subpage.data);
+  char slug[512];
+  parse_movie_title_slug(movie_title, slug, sizeof(slug));
 
-  if (download_url[0] == 0) {
-    logw("subf2m: couldn't find download link on %s", subpage_url);
-    return false;
+  SubsSources src = { cfg->subf2m_base, cfg->opensubs_base, cfg->opensubs_key, NULL, SUBS_FMT_ZIP };
+  if (cached && rec.outcome == LOOKUP_HIT) {
+    src.known_url = rec.value;
+    src.known_fmt = strcmp(rec.source, "opensubtitles") == 0 ? SUBS_FMT_SRT : SUBS_FMT_ZIP;
   }
 
-  char tmpzip[PATH_MAX];
-  snprintf(tmpzip, sizeof(tmpzip), "scripts/srt_files/%s_tmp.zip", movie_title);
-
-  CURL *curl = curl_easy_init();
-  if (!curl) die("curl init failed");
+  SubtitleSink sink = { movie_title, dest_srt_path };
+  SubsResult res;
+  bool got = subs_fetch(&src, movie_title, slug, accept_subtitle, &sink, &res);
 
-  FILE *zf = fopen(tmpzip, "wb");
-  if (!zf) { curl_easy_cleanup(curl); return false; }
-
-  curl_easy_setopt(curl, CURLOPT_URL, download_url);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_USERAGENT,
-                   "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) "
-                   "AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.0 Safari/605.1.15");
-  curl_easy_setopt(curl, CURLOPT_COOKIEFILE, "");
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, zf);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 120L);
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-
-  CURLcode res = curl_easy_perform(curl);
-  fclose(zf);
-  curl_easy_cleanup(curl);
-
-  if (res != CURLE_OK) {
-    unlink(tmpzip);
-    logw("subf2m: zip download failed: %s", curl_easy_strerror(res));
-    return false;
+  if (got) {
+    const char *provider = strcmp(res.provider, "cache") == 0 ? rec.source : res.provider;
+    lookup_put(g_lookups, key, LOOKUP_HIT, 200, provider, res.url, LOOKUP_TTL_HIT);
+  } else if (!res.transient &&
+             (res.http_code == 200 || res.http_code == 404 || res.http_code == 410)) {
+    /* Only definite answers are remembered: if any provider step hit network
+       trouble, the title is retried next run. */
+    lookup_put(g_lookups, key, LOOKUP_MISS, (int)res.http_code, "subtitles", res.reason,
+               LOOKUP_TTL_TITLE_MISS);
   }
-
-  char *esczip = sh_escape(tmpzip);
-  char *escout = sh_escape(dest_srt_path);
-
-#ifdef _WIN32
-  int rc = run_cmd("unzip -p %s \"*.srt\" > %s 2>NUL || unzip -p %s \"*.SRT\" > %s",
-                   esczip, escout, esczip, escout);
-#else
-  int rc = run_cmd("unzip -p %s \"*.srt\" > %s 2>/dev/null || unzip -p %s \"*.SRT\" > %s",
-                   esczip, escout, esczip, escout);
-#endif
-
-  free(esczip);
-  free(escout);
-  unlink(tmpzip);
-
-  return (rc == 0) && file_exists(dest_srt_path);
+  return got;
 }
 
 /* ----------------------- IMSDb scraper (UPDATED) ----------------------- */
@@ -834,87 +854,127 @@ static void imsdb_format_title_loose(const char *movie_title, char *out, size_t
   out[j] = 0;
 }
 
-/* Extract script from either <pre>...</pre> OR class="scrtext" region */
-static bool imsdb_fetch_script_to_file(const char *url, const char *dest_txt_path,
-                                       char *why, size_t whysz) {
-  if (why && whysz) { why[0] = 0; }
-
-  long code = 0;
-  MemBuf page = http_get_to_mem_ex(url, &code);
+#define IMSDB_MAX_CANDIDATES 9
 
-  if (code != 200 || !page.data || page.size == 0) {
-    if (why && whysz) snprintf(why, whysz, "HTTP %ld", code);
-    if (page.data) free(page.data);
-    return false;
-  }
+typedef struct ImsdbProbe ImsdbProbe;
 
-  const char *start = NULL;
-  const char *end   = NULL;
+/* One candidate URL; the script region is collected while the page streams. */
+typedef struct {
+  ImsdbProbe *probe;
+  const char *url;
+  HtmlScan scan;
+} ImsdbCandidate;
+
+struct ImsdbProbe {
+  const char *dest_txt_path;
+  bool won;
+  char used_url[1024];
+
+  /* Candidates that were definitely not there (404 or no script block);
+     when every candidate is, the title itself is recorded as a miss. */
+  size_t definite_misses;
+  long miss_code;
+};
+
+static void imsdb_url_key(const char *url, char *out, size_t outsz) {
+  snprintf(out, outsz, "imsdb-url:%s", url);
+}
 
-  /* 1) Prefer <pre> */
-  char *pre = strcasestr_local(page.data, "<pre");
-  if (pre) {
-    pre = strchr(pre, '>');
-    if (pre) {
-      pre++;
-      char *pend = strcasestr_local(pre, "</pre>");
-      if (pend) { start = pre; end = pend; }
-    }
-  }
+static void imsdb_note_dead_url(ImsdbProbe *probe, const char *url, long code, const char *why) {
+  char key[1100];
+  imsdb_url_key(url, key, sizeof(key));
+  lookup_put(g_lookups, key, LOOKUP_MISS, (int)code, "imsdb", why, LOOKUP_TTL_URL_MISS);
+  probe->definite_misses++;
+  if (probe->miss_code == 0 || code == 404) probe->miss_code = code;
+}
 
-  /* 2) Fallback: class="scrtext" */
-  if (!start || !end) {
-    char *scr = strcasestr_local(page.data, "class=\"scrtext\"");
-    if (!scr) scr = strcasestr_local(page.data, "class='scrtext'");
-    if (scr) {
-      char *gt = strchr(scr, '>');
-      if (gt) {
-        gt++;
-        char *tdend  = strcasestr_local(gt, "</td>");
-        char *divend = strcasestr_local(gt, "</div>");
-        char *best = NULL;
-        if (tdend && divend) best = (tdend < divend) ? tdend : divend;
-        else best = tdend ? tdend : divend;
-        if (best) { start = gt; end = best; }
-      }
-    }
-  }
+/* Extract script from either <pre>...</pre> OR class="scrtext" region */
+static void imsdb_candidate_done(FetchGroup *g, FetchJob *job) {
+  ImsdbCandidate *cand = (ImsdbCandidate *)job->user;
+  ImsdbProbe *probe = cand->probe;
 
-  if (!start || !end || end <= start) {
-    if (why && whysz) snprintf(why, whysz, "script block not found");
-    free(page.data);
-    return false;
+  if (!job->ok) {
+    if (job->code == 404 || job->code == 410) imsdb_note_dead_url(probe, cand->url, job->code, "not found");
+    logw("IMSDb attempt failed (HTTP %ld): %s", job->code, cand->url);
+    return;
   }
 
-  size_t raw_n = (size_t)(end - start);
   size_t txt_n = 0;
-  char *txt = html_to_text_basic(start, raw_n, &txt_n);
+  char *txt = html_scan_take_script(&cand->scan, &txt_n);
+  if (!txt) {
+    /* IMSDb answers unknown titles with a 200 page that has no script block. */
+    imsdb_note_dead_url(probe, cand->url, job->code, "script block not found");
+    logw("IMSDb attempt failed (script block not found): %s", cand->url);
+    return;
+  }
 
   if (txt_n < 1000) {
-    if (why && whysz) snprintf(why, whysz, "extracted text too small (%zu)", txt_n);
-    free(txt);
-    free(page.data);
-    return false;
+    logw("IMSDb attempt failed (extracted text too small (%zu)): %s", txt_n, cand->url);
+  } else if (!write_file_atomic(probe->dest_txt_path, txt, txt_n)) {
+    logw("IMSDb attempt failed (write failed): %s", cand->url);
+  } else {
+    probe->won = true;
+    snprintf(probe->used_url, sizeof(probe->used_url), "%s", cand->url);
+    fetch_group_cancel(g);
   }
-
-  bool ok = write_entire_file(dest_txt_path, txt, txt_n);
   free(txt);
-  free(page.data);
+}
 
-  if (!ok) {
-    if (why && whysz) snprintf(why, whysz, "write failed");
-    return false;
+/* Probes every candidate at once; the first page with a usable script wins and
+   the rest are cancelled. Each stream stops as soon as its </pre> closes, and
+   URLs that recently gave nothing are skipped via the lookup cache. */
+static bool imsdb_probe_candidates(const char *const *urls, const char *dest_txt_path,
+                                   ImsdbProbe *probe) {
+  probe->dest_txt_path = dest_txt_path;
+
+  ImsdbCandidate cands[IMSDB_MAX_CANDIDATES];
+  size_t ncand = 0;
+  size_t considered = 0;
+  FetchGroup *g = fetch_group_new();
+
+  for (int i = 0; urls[i] && considered < IMSDB_MAX_CANDIDATES; i++) {
+    if (!urls[i][0]) continue;
+
+    bool dup = false;
+    for (int k = 0; k < i && !dup; k++) dup = strcmp(urls[k], urls[i]) == 0;
+    if (dup) continue;
+    considered++;
+
+    char key[1100];
+    LookupRecord rec;
+    imsdb_url_key(urls[i], key, sizeof(key));
+    if (lookup_get(g_lookups, key, &rec) && rec.outcome == LOOKUP_MISS) {
+      logi("IMSDb: skipping %s (%s, HTTP %d)", urls[i], rec.value, rec.http_code);
+      probe->definite_misses++;
+      if (probe->miss_code == 0 || rec.http_code == 404) probe->miss_code = rec.http_code;
+      continue;
+    }
+
+    ImsdbCandidate *cand = &cands[ncand++];
+    cand->probe = probe;
+    cand->url = urls[i];
+    html_scan_init(&cand->scan, NULL, NULL, true);
+
+    FetchJob *j = fetch_get(g, urls[i], imsdb_candidate_done, cand, 0);
+    j->scan = &cand->scan;
   }
 
-  return true;
+  if (ncand > 0) fetch_group_run(g);
+  fetch_group_free(g);
+
+  for (size_t k = 0; k < ncand; k++) html_scan_free(&cands[k].scan);
+
+  /* Only a clean sweep of definite misses says the title is not on IMSDb;
+     timeouts and server errors leave it to be retried next run. */
+  if (!probe->won && considered > 0 && probe->definite_misses < considered) probe->miss_code = 0;
+  return probe->won;
 }
 
 /* Try multiple URL families, including Movie%20Scripts/<Title>%20Script.html */
-static bool download_imsdb_script_ex(const char *movie_title,
+static bool download_imsdb_script_ex(const Config *cfg, const char *movie_title,
                                      const char *dest_txt_path,
                                      char *used_url, size_t used_url_sz) {
-  ensure_dir("scripts");
-  ensure_dir("scripts/srt_files");
+  ensure_dir(g_srt_dir);
 
   if (used_url && used_url_sz) used_url[0] = 0;
 
@@ -944,33 +1004,44 @@ static bool download_imsdb_script_ex(const char *movie_title,
 
   char url0[1024], url1[1024], url2[1024], url3[1024], url4[1024], url5[1024], url6[1024];
 
-  snprintf(url0, sizeof(url0), "https://imsdb.com/scripts/%s.html", a);
-  snprintf(url1, sizeof(url1), "https://imsdb.com/scripts/%s.html", b);
-  snprintf(url2, sizeof(url2), "https://imsdb.com/scripts/%s.html", c);
-
-  snprintf(url3, sizeof(url3), "https://imsdb.com/scripts/%s.html", a_lo);
-  snprintf(url4, sizeof(url4), "https://imsdb.com/scripts/%s.html", b_lo);
-  snprintf(url5, sizeof(url5), "https://imsdb.com/scripts/%s.html", c_lo);
-
-  snprintf(url6, sizeof(url6), "https://imsdb.com/Movie%%20Scripts/%s%%20Script.html", enc_title);
+  snprintf(url0, sizeof(url0), "%s/scripts/%s.html", cfg->imsdb_base, a);
+  snprintf(url1, sizeof(url1), "%s/scripts/%s.html", cfg->imsdb_base, b);
+  snprintf(url2, sizeof(url2), "%s/scripts/%s.html", cfg->imsdb_base, c);
+
+  snprintf(url3, sizeof(url3), "%s/scripts/%s.html", cfg->imsdb_base, a_lo);
+  snprintf(url4, sizeof(url4), "%s/scripts/%s.html", cfg->imsdb_base, b_lo);
+  snprintf(url5, sizeof(url5), "%s/scripts/%s.html", cfg->imsdb_base, c_lo);
+
+  snprintf(url6, sizeof(url6), "%s/Movie%%20Scripts/%s%%20Script.html", cfg->imsdb_base, enc_title);
+
+  char key[600];
+  snprintf(key, sizeof(key), "imsdb:%s", movie_title);
+  LookupRecord rec;
+  bool cached = lookup_get(g_lookups, key, &rec);
+  if (cached && rec.outcome == LOOKUP_MISS) {
+    char when[64];
+    format_local_time(rec.expires_at, when, sizeof(when));
+    logi("IMSDb: skipping %s, no script found on an earlier run (%s, HTTP %d); retry after %s",
+         movie_title, rec.value, rec.http_code, when);
+    return false;
+  }
 
-  const char *attempts[] = { url0, url1, url2, url3, url4, url5, url6, NULL };
+  /* A URL that worked before goes first; it is probed alongside the rest. */
+  const char *hint = (cached && rec.outcome == LOOKUP_HIT) ? rec.value : "";
+  const char *attempts[] = { hint, url0, url1, url2, url3, url4, url5, url6, NULL };
 
-  for (int i = 0; attempts[i]; i++) {
-    if (!attempts[i][0]) continue;
+  ImsdbProbe probe;
+  memset(&probe, 0, sizeof(probe));
+  bool got = imsdb_probe_candidates(attempts, dest_txt_path, &probe);
 
-    char why[256];
-    if (imsdb_fetch_script_to_file(attempts[i], dest_txt_path, why, sizeof(why))) {
-      if (used_url && used_url_sz) {
-        strncpy(used_url, attempts[i], used_url_sz - 1);
-        used_url[used_url_sz - 1] = 0;
-      }
-      return true;
-    }
-    logw("IMSDb attempt failed (%s): %s", why, attempts[i]);
+  if (got) {
+    lookup_put(g_lookups, key, LOOKUP_HIT, 200, "imsdb", probe.used_url, LOOKUP_TTL_HIT);
+    if (used_url && used_url_sz) snprintf(used_url, used_url_sz, "%s", probe.used_url);
+  } else if (probe.miss_code != 0) {
+    lookup_put(g_lookups, key, LOOKUP_MISS, (int)probe.miss_code, "imsdb",
+               "no script at any URL variant", LOOKUP_TTL_TITLE_MISS);
   }
-
-  return false;
+  return got;
 }
 
 /* ----------------------- OpenAI response parsing ----------------------- */
@@ -1013,7 +1084,7 @@ static char *openai_extract_output_text(const char *resp_json) {
       if (cJSON_IsString(type) && type->valuestring &&
           strcmp(type->valuestring, "output_text") == 0 &&
           cJSON_IsString(text) && text->valuestring) {
-        char *out = strdup(text->valuestring);
+        char *out = arena_strdup(g_movie_arena, text->valuestring);
         cJSON_Delete(root);
         return out;
       }
@@ -1068,354 +1139,260 @@ static bool openai_resp_should_retry_without_script(const char *resp_json) {
   return yes;
 }
 
-typedef struct {
-  int start;
-  int end;
-  char *narration;
-} ClipPlan;
-
-typedef struct {
-  ClipPlan *items;
-  size_t count;
-} ClipPlanList;
+/* Subtitles and script are length-delimited views (not NUL-terminated). */
+static ClipPlanList openai_make_plan(const Config *cfg,
+                                     const char *movie_title,
+                                     const char *subs, size_t subs_n,
+                                     const char *script, size_t script_n,
+                                     int num_clips,
+                                     bool *out_retry_without_script) {
+  if (out_retry_without_script) *out_retry_without_script = false;
 
-static void free_clip_plan_list(ClipPlanList *lst) {
-  if (!lst) return;
-  for (size_t i = 0; i < lst->count; i++) {
-    free(lst->items[i].narration);
-  }
-  free(lst->items);
-  lst->items = NULL;
-  lst->count = 0;
-}
+  const size_t MAX_SUB_CHARS    = 320000;
+  const size_t MAX_SCRIPT_CHARS = 80000;
 
-static ClipPlanList parse_clip_plan_json(const char *json_text) {
-  ClipPlanList out = {0};
-  cJSON *root = cJSON_Parse(json_text);
-  if (!root) return out;
+  const char *title = movie_title ? movie_title : "";
+  size_t title_n = strlen(title);
+
+  /* The request body is written in one pass: the source texts are sanitized,
+     trimmed and JSON-escaped straight into the outgoing buffer. */
+  size_t est = 4096 + 2 * title_n + (subs_n < MAX_SUB_CHARS ? subs_n : MAX_SUB_CHARS) +
+               (script_n < MAX_SCRIPT_CHARS ? script_n : MAX_SCRIPT_CHARS);
+  JsonWriter w;
+  jw_init(&w, est + est / 8);
+
+  jw_object_begin(&w);
+  jw_key(&w, "model");
+  jw_string(&w, "gpt-5.2");
+
+  jw_key(&w, "reasoning");
+  jw_object_begin(&w);
+  jw_key(&w, "effort");
+  jw_string(&w, "high");
+  jw_object_end(&w);
+
+  jw_key(&w, "input");
+  jw_array_begin(&w);
+  jw_object_begin(&w);
+  jw_key(&w, "role");
+  jw_string(&w, "system");
+  jw_key(&w, "content");
+  jw_string(&w, "You are a helpful assistant designed to output JSON.");
+  jw_object_end(&w);
+
+  jw_object_begin(&w);
+  jw_key(&w, "role");
+  jw_string(&w, "user");
+  jw_key(&w, "content");
+  jw_string_begin(&w);
+#define PROMPT_LIT(s) jw_string_append(&w, s, sizeof(s) - 1)
+  PROMPT_LIT("You are given TWO inputs.\n"
+             "Movie: ");
+  jw_string_append_lossy(&w, title, title_n, (size_t)-1);
+  PROMPT_LIT("\n"
+             "\n"
+             "INPUT A (Subtitles with timestamps in SECONDS):\n");
+  jw_string_append_lossy(&w, subs, subs_n, MAX_SUB_CHARS);
+  PROMPT_LIT("\n"
+             "\n"
+             "INPUT B (Optional script text WITHOUT timestamps; may be empty):\n");
+  jw_string_append_lossy(&w, script, script_n, MAX_SCRIPT_CHARS);
+  char clips_line[128];
+  int clips_n = snprintf(clips_line, sizeof(clips_line),
+                         "- Choose %d non-overlapping time ranges that best cover the full plot arc.\n",
+                         num_clips);
+  PROMPT_LIT("\n"
+             "\n"
+             "TASK:\n");
+  jw_string_append(&w, clips_line, (size_t)clips_n);
+  PROMPT_LIT("- ONLY use INPUT A for selecting start/end times (seconds). INPUT B is for story context.\n"
+             "- Each time range should usually be 8-16 seconds long (end-start). Avoid >20 seconds.\n"
+             "- Keep narrations punchy but not tiny: about 20-35 words total, in 3-5 short sentences.\n"
+             "- Prefer ranges with clear visual action (reveals, confrontations, entrances, big moments).\n"
+             "- Skip any range that starts at 0.\n"
+             "- Return STRICT JSON with this shape ONLY:\n"
+             "  {\"clips\":[{\"start\":120,\"end\":145,\"narration\":\"...\"}, ...]}\n"
+             "- Clips must be increasing by start time.\n"
+             "- Each narration must be at least 3 full sentences, casual commentator vibe.\n"
+             "- The first narration must start with: \"Here we go, let's go over the movie ");
+  jw_string_append_lossy(&w, title, title_n, (size_t)-1);
+  PROMPT_LIT(".\".\n");
+#undef PROMPT_LIT
+  jw_string_end(&w);
+  jw_object_end(&w);
+  jw_array_end(&w);
+
+  jw_key(&w, "text");
+  jw_object_begin(&w);
+  jw_key(&w, "format");
+  jw_object_begin(&w);
+  jw_key(&w, "type");
+  jw_string(&w, "json_object");
+  jw_object_end(&w);
+  jw_object_end(&w);
+  jw_object_end(&w);
+
+  size_t body_len = 0;
+  char *body = jw_take(&w, &body_len);
 
-  cJSON *clips = cJSON_GetObjectItemCaseSensitive(root, "clips");
-  if (!cJSON_IsArray(clips)) {
-    cJSON_Delete(root);
-    return out;
-  }
+  long http_code = 0;
+  bool has_script = script_n > 0;
+  long timeout_s = has_script ? 14400L : 3600L;
 
-  size_t n = (size_t)cJSON_GetArraySize(clips);
-  out.items = (ClipPlan *)calloc(n, sizeof(ClipPlan));
-  if (!out.items) die("OOM");
-  out.count = 0;
+  char url[512];
+  snprintf(url, sizeof(url), "%s/v1/responses", cfg->openai_base);
 
-  for (size_t i = 0; i < n; i++) {
-    cJSON *obj = cJSON_GetArrayItem(clips, (int)i);
-    if (!cJSON_IsObject(obj)) continue;
+  char auth[1024];
+  snprintf(auth, sizeof(auth), "Authorization: Bearer %s", cfg->openai_key);
+  const char *headers[] = { "Content-Type: application/json", auth, NULL };
 
-    cJSON *s = cJSON_GetObjectItemCaseSensitive(obj, "start");
-    cJSON *e = cJSON_GetObjectItemCaseSensitive(obj, "end");
-    cJSON *nar = cJSON_GetObjectItemCaseSensitive(obj, "narration");
+  HttpPolicy policy = HTTP_POLICY_LLM;
+  policy.timeout_s = timeout_s;
 
-    if (!cJSON_IsNumber(s) || !cJSON_IsNumber(e) || !cJSON_IsString(nar) || !nar->valuestring) continue;
+  HttpResult hr;
+  http_post_n(url, headers, body, body_len, &policy, &hr);
+  free(body);
+  http_code = hr.status;
 
-    out.items[out.count].start = s->valueint;
-    out.items[out.count].end = e->valueint;
-    out.items[out.count].narration = strdup(nar->valuestring);
-    out.count++;
-  }
+  if (hr.err != HTTP_OK) {
+    if (hr.err == HTTP_ERR_STATUS) logw("OpenAI HTTP %ld", http_code);
+    else logw("OpenAI request failed after %d attempt(s): %s", hr.attempts, hr.message);
+    if (hr.body && hr.len) logw("OpenAI raw body: %.800s", hr.body);
 
-  cJSON_Delete(root);
-  return out;
-}
-
-static void *xrealloc(void *p, size_t n) {
-  void *q = realloc(p, n);
-  if (!q) die("OOM");
-  return q;
-}
-
-static char *sanitize_utf8_lossy(const char *in) {
-  if (!in) return strdup("");
-  size_t n = strlen(in);
-  size_t cap = n * 4 + 1;
-  char *out = (char *)malloc(cap);
-  if (!out) die("OOM");
-
-  size_t i = 0, j = 0;
-  while (i < n) {
-    unsigned char c = (unsigned char)in[i];
-
-    if (c < 0x80) {
-      if (j + 2 >= cap) { cap *= 2; out = (char *)xrealloc(out, cap); }
-      out[j++] = (char)c;
-      i++;
-      continue;
-    }
-
-    if (c >= 0xC2 && c <= 0xDF) {
-      if (i + 1 < n) {
-        unsigned char c1 = (unsigned char)in[i + 1];
-        if ((c1 & 0xC0) == 0x80) {
-          if (j + 3 >= cap) { cap *= 2; out = (char *)xrealloc(out, cap); }
-          out[j++] = (char)c;
-          out[j++] = (char)c1;
-          i += 2;
-          continue;
-        }
-      }
-    } else if (c >= 0xE0 && c <= 0xEF) {
-      if (i + 2 < n) {
-        unsigned char c1 = (unsigned char)in[i + 1];
-        unsigned char c2 = (unsigned char)in[i + 2];
-        if (((c1 & 0xC0) == 0x80) && ((c2 & 0xC0) == 0x80)) {
-          if (c == 0xE0 && c1 < 0xA0) goto invalid;
-          if (c == 0xED && c1 >= 0xA0) goto invalid;
-          if (j + 4 >= cap) { cap *= 2; out = (char *)xrealloc(out, cap); }
-          out[j++] = (char)c;
-          out[j++] = (char)c1;
-          out[j++] = (char)c2;
-          i += 3;
-          continue;
-        }
-      }
-    } else if (c >= 0xF0 && c <= 0xF4) {
-      if (i + 3 < n) {
-        unsigned char c1 = (unsigned char)in[i + 1];
-        unsigned char c2 = (unsigned char)in[i + 2];
-        unsigned char c3 = (unsigned char)in[i + 3];
-        if (((c1 & 0xC0) == 0x80) && ((c2 & 0xC0) == 0x80) && ((c3 & 0xC0) == 0x80)) {
-          if (c == 0xF0 && c1 < 0x90) goto invalid;
-          if (c == 0xF4 && c1 > 0x8F) goto invalid;
-          if (j + 5 >= cap) { cap *= 2; out = (char *)xrealloc(out, cap); }
-          out[j++] = (char)c;
-          out[j++] = (char)c1;
-          out[j++] = (char)c2;
-          out[j++] = (char)c3;
-          i += 4;
-          continue;
-        }
-      }
-    }
-
-  invalid:
-    if (j + 3 >= cap) { cap *= 2; out = (char *)xrealloc(out, cap); }
-    if (c < 0xC0) {
-      out[j++] = (char)0xC2;
-      out[j++] = (char)c;
-    } else {
-      out[j++] = (char)0xC3;
-      out[j++] = (char)(c - 0x40);
-    }
-    i++;
-  }
-
-  out[j] = 0;
-  return out;
-}
-
-static char *trim_copy_utf8_safe(const char *s, size_t max_bytes) {
-  if (!s) return strdup("");
-  size_t n = strlen(s);
-  if (n <= max_bytes) return strdup(s);
-
-  size_t cut = max_bytes;
-  if (cut >= n) cut = n;
-
-  while (cut > 0 && cut < n && (((unsigned char)s[cut] & 0xC0) == 0x80)) cut--;
-
-  char *out = (char *)malloc(cut + 1);
-  if (!out) die("OOM");
-  memcpy(out, s, cut);
-  out[cut] = 0;
-  return out;
-}
-
-static ClipPlanList openai_make_plan(const Config *cfg,
-                                     const char *movie_title,
-                                     const char *subs_seconds_text,
-                                     const char *optional_script_text,
-                                     int num_clips,
-                                     bool *out_retry_without_script) {
-  if (out_retry_without_script) *out_retry_without_script = false;
-
-  const size_t MAX_SUB_CHARS    = 320000;
-  const size_t MAX_SCRIPT_CHARS = 80000;
-
-  char *title_utf8 = sanitize_utf8_lossy(movie_title ? movie_title : "");
-  char *subs_utf8  = sanitize_utf8_lossy(subs_seconds_text ? subs_seconds_text : "");
-  char *scr_utf8   = sanitize_utf8_lossy(optional_script_text ? optional_script_text : "");
-
-  char *subs_trim = trim_copy_utf8_safe(subs_utf8, MAX_SUB_CHARS);
-  char *scr_trim  = trim_copy_utf8_safe(scr_utf8,  MAX_SCRIPT_CHARS);
-
-  free(subs_utf8);
-  free(scr_utf8);
-
-  const char *prompt_fmt =
-    "You are given TWO inputs.\n"
-    "Movie: %s\n"
-    "\n"
-    "INPUT A (Subtitles with timestamps in SECONDS):\n"
-    "%s\n"
-    "\n"
-    "INPUT B (Optional script text WITHOUT timestamps; may be empty):\n"
-    "%s\n"
-    "\n"
-    "TASK:\n"
-    "- Choose %d non-overlapping time ranges that best cover the full plot arc.\n"
-    "- ONLY use INPUT A for selecting start/end times (seconds). INPUT B is for story context.\n"
-    "- Each time range should usually be 8-16 seconds long (end-start). Avoid >20 seconds.\n"
-    "- Keep narrations punchy but not tiny: about 20-35 words total, in 3-5 short sentences.\n"
-    "- Prefer ranges with clear visual action (reveals, confrontations, entrances, big moments).\n"
-    "- Skip any range that starts at 0.\n"
-    "- Return STRICT JSON with this shape ONLY:\n"
-    "  {\"clips\":[{\"start\":120,\"end\":145,\"narration\":\"...\"}, ...]}\n"
-    "- Clips must be increasing by start time.\n"
-    "- Each narration must be at least 3 full sentences, casual commentator vibe.\n"
-    "- The first narration must start with: \"Here we go, let's go over the movie %s.\".\n";
-
-  int plen = snprintf(NULL, 0, prompt_fmt, title_utf8, subs_trim, scr_trim, num_clips, title_utf8);
-  if (plen < 0) die("snprintf failed building prompt");
-  char *prompt = (char *)malloc((size_t)plen + 1);
-  if (!prompt) die("OOM");
-  snprintf(prompt, (size_t)plen + 1, prompt_fmt, title_utf8, subs_trim, scr_trim, num_clips, title_utf8);
-
-  free(title_utf8);
-  free(subs_trim);
-  free(scr_trim);
-
-  cJSON *req = cJSON_CreateObject();
-  cJSON_AddStringToObject(req, "model", "gpt-5.2");
-
-  cJSON *reasoning = cJSON_CreateObject();
-  cJSON_AddStringToObject(reasoning, "effort", "high");
-  cJSON_AddItemToObject(req, "reasoning", reasoning);
-
-  cJSON *input = cJSON_CreateArray();
-  cJSON *sys = cJSON_CreateObject();
-  cJSON_AddStringToObject(sys, "role", "system");
-  cJSON_AddStringToObject(sys, "content", "You are a helpful assistant designed to output JSON.");
-  cJSON_AddItemToArray(input, sys);
-
-  cJSON *usr = cJSON_CreateObject();
-  cJSON_AddStringToObject(usr, "role", "user");
-  cJSON_AddStringToObject(usr, "content", prompt);
-  cJSON_AddItemToArray(input, usr);
-  cJSON_AddItemToObject(req, "input", input);
-
-  cJSON *text = cJSON_CreateObject();
-  cJSON *format = cJSON_CreateObject();
-  cJSON_AddStringToObject(format, "type", "json_object");
-  cJSON_AddItemToObject(text, "format", format);
-  cJSON_AddItemToObject(req, "text", text);
-
-  char *body = cJSON_PrintUnformatted(req);
-  cJSON_Delete(req);
-  free(prompt);
-
-  if (!body) {
-    ClipPlanList empty = {0};
-    return empty;
-  }
-
-  long http_code = 0;
-  bool has_script = (optional_script_text && optional_script_text[0] != 0);
-  long timeout_s = has_script ? 14400L : 3600L;
-
-  MemBuf resp = http_post_json_to_mem("https://api.openai.com/v1/responses",
-                                      cfg->openai_key, body, &http_code, timeout_s);
-  free(body);
-
-  if (http_code < 200 || http_code >= 300) {
-    logw("OpenAI HTTP %ld", http_code);
-    if (resp.data && resp.size) logw("OpenAI raw body: %.800s", resp.data);
-
-    if (has_script && resp.data && openai_resp_should_retry_without_script(resp.data)) {
+    if (has_script && hr.body && openai_resp_should_retry_without_script(hr.body)) {
       if (out_retry_without_script) *out_retry_without_script = true;
     }
 
-    if (resp.data) free(resp.data);
+    if (hr.body) free(hr.body);
     ClipPlanList empty = {0};
     return empty;
   }
 
-  char *out_text = openai_extract_output_text(resp.data ? resp.data : "");
+  char *out_text = openai_extract_output_text(hr.body ? hr.body : "");
   if (!out_text) {
     logw("OpenAI response parse failed.");
-    if (resp.data && resp.size) logw("OpenAI raw body: %.800s", resp.data);
+    if (hr.body && hr.len) logw("OpenAI raw body: %.800s", hr.body);
 
-    if (has_script && resp.data && openai_resp_should_retry_without_script(resp.data)) {
+    if (has_script && hr.body && openai_resp_should_retry_without_script(hr.body)) {
       if (out_retry_without_script) *out_retry_without_script = true;
     }
 
-    if (resp.data) free(resp.data);
+    if (hr.body) free(hr.body);
     ClipPlanList empty = {0};
     return empty;
   }
 
-  ClipPlanList plan = parse_clip_plan_json(out_text);
-  free(out_text);
-  if (resp.data) free(resp.data);
+  ClipPlanList plan = parse_clip_plan_json_in(g_movie_arena, out_text);
+  if (hr.body) free(hr.body);
   return plan;
 }
 
-static bool elevenlabs_tts_to_mp3(const Config *cfg, const char *text, const char *out_mp3_path) {
-  char url[1024];
-  snprintf(url, sizeof(url),
-           "https://api.elevenlabs.io/v1/text-to-speech/%s?output_format=mp3_44100_128",
-           cfg->eleven_voice_id);
-
-  cJSON *root = cJSON_CreateObject();
-  cJSON_AddStringToObject(root, "text", text);
-  cJSON_AddStringToObject(root, "model_id", cfg->eleven_model_id);
-  char *body = cJSON_PrintUnformatted(root);
-  cJSON_Delete(root);
+static char *elevenlabs_body(const Config *cfg, const char *text, size_t *len) {
+  metrics_inc(METRIC_TTS_CHARS, (unsigned long long)strlen(text));
+
+  JsonWriter w;
+  jw_init(&w, strlen(text) + 256);
+  jw_object_begin(&w);
+  jw_key(&w, "text");
+  jw_string(&w, text);
+  jw_key(&w, "model_id");
+  jw_string(&w, cfg->eleven_model_id);
+  jw_object_end(&w);
+  return jw_take(&w, len);
+}
 
-  CURL *curl = curl_easy_init();
-  if (!curl) die("curl init failed");
+static void elevenlabs_url(const Config *cfg, char *out, size_t outsz) {
+  snprintf(out, outsz, "%s/v1/text-to-speech/%s?output_format=mp3_44100_128",
+           cfg->eleven_base, cfg->eleven_voice_id);
+}
 
-  FILE *f = fopen(out_mp3_path, "wb");
-  if (!f) {
-    curl_easy_cleanup(curl);
-    free(body);
-    return false;
-  }
+static bool elevenlabs_tts_to_mp3(const Config *cfg, const char *text, const char *out_mp3_path) {
+  char url[1024];
+  elevenlabs_url(cfg, url, sizeof(url));
 
-  struct curl_slist *headers = NULL;
-  headers = curl_slist_append(headers, "Content-Type: application/json");
+  size_t body_len = 0;
+  char *body = elevenlabs_body(cfg, text, &body_len);
 
   char keyhdr[1024];
   snprintf(keyhdr, sizeof(keyhdr), "xi-api-key: %s", cfg->eleven_key);
-  headers = curl_slist_append(headers, keyhdr);
-
-  curl_easy_setopt(curl, CURLOPT_URL, url);
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(body));
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, f);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 300L);
-  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  const char *headers[] = { "Content-Type: application/json", keyhdr, NULL };
 
-  CURLcode res = curl_easy_perform(curl);
-
-  fclose(f);
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
+  HttpResult hr;
+  bool ok = http_post_n(url, headers, body, body_len, &HTTP_POLICY_TTS, &hr);
   free(body);
 
-  if (res != CURLE_OK) {
-    unlink(out_mp3_path);
-    logw("ElevenLabs TTS failed: %s", curl_easy_strerror(res));
+  if (!ok) {
+    logw("ElevenLabs TTS failed after %d attempt(s): %s", hr.attempts, hr.message);
+    if (hr.err == HTTP_ERR_STATUS && hr.body) logw("ElevenLabs body: %.300s", hr.body);
+    http_result_free(&hr);
     return false;
   }
-  return file_exists(out_mp3_path);
+
+  ok = hr.len > 0 && write_file_atomic(out_mp3_path, hr.body, hr.len);
+  http_result_free(&hr);
+  if (!ok) logw("ElevenLabs TTS: could not write %s", out_mp3_path);
+  return ok;
+}
+
+/* One narration of a batch; ok is set by the completion callback. */
+typedef struct {
+  const char *text;
+  const char *path;
+  size_t clip;          /* 1-based, for log lines */
+  bool ok;
+} TtsJob;
+
+static void tts_job_done(FetchGroup *g, FetchJob *job) {
+  (void)g;
+  TtsJob *t = (TtsJob *)job->user;
+  if (!job->ok) {
+    if (job->err != HTTP_ERR_CANCELLED) {
+      logw("ElevenLabs TTS failed for clip %zu after %d attempt(s): %s (HTTP %ld)",
+           t->clip, job->attempt, http_error_name(job->err), job->code);
+      if (job->err == HTTP_ERR_STATUS && job->body) logw("ElevenLabs body: %.300s", job->body);
+    }
+    return;
+  }
+  t->ok = job->len > 0 && write_file_atomic(t->path, job->body, job->len);
+  if (!t->ok) logw("ElevenLabs TTS: could not write %s", t->path);
+}
+
+/* Narrations for several clips at once on one multi handle, so the per-request
+   latency of the TTS service overlaps instead of adding up. */
+static void elevenlabs_tts_batch(const Config *cfg, TtsJob *jobs, size_t n) {
+  if (n == 1) {
+    jobs[0].ok = elevenlabs_tts_to_mp3(cfg, jobs[0].text, jobs[0].path);
+    return;
+  }
+
+  char url[1024];
+  elevenlabs_url(cfg, url, sizeof(url));
+  char keyhdr[1024];
+  snprintf(keyhdr, sizeof(keyhdr), "xi-api-key: %s", cfg->eleven_key);
+
+  char *bodies[MAX_TTS_JOBS];
+  FetchGroup *g = fetch_group_new();
+  for (size_t i = 0; i < n; i++) {
+    size_t len = 0;
+    bodies[i] = elevenlabs_body(cfg, jobs[i].text, &len);
+    FetchJob *j = fetch_post_borrowed(g, url, bodies[i], len, tts_job_done, &jobs[i], (int)i);
+    fetch_job_header(j, "Content-Type: application/json");
+    fetch_job_header(j, keyhdr);
+    fetch_job_policy(j, &HTTP_POLICY_TTS);
+  }
+  fetch_group_run(g);
+  fetch_group_free(g);
+  for (size_t i = 0; i < n; i++) free(bodies[i]);
 }
 
-static bool ffmpeg_make_adjusted_clip(const char *input_mp4, int start_s, int end_s,
-                                      const char *narration_mp3, double narration_dur,
-                                      const char *out_mp4) {
+/* Starts the encoder for one clip and returns without waiting, so several
+   clips can encode while narration for the next ones is fetched. The clip is
+   video only, timed to its narration; the soundtrack is assembled once for
+   the whole movie. NULL when the segment is unusable. */
+static Encode *ffmpeg_start_adjusted_clip(const char *input_mp4, int start_s, int end_s,
+                                          double narration_dur, const char *out_mp4, int clip_no) {
   double orig_seg_dur = (double)(end_s - start_s);
-  if (orig_seg_dur <= 0.1 || narration_dur <= 0.1) return false;
+  if (orig_seg_dur <= 0.1 || narration_dur <= 0.1) return NULL;
 
   int use_start = start_s;
   int use_end   = end_s;
@@ -1458,93 +1435,84 @@ static bool ffmpeg_make_adjusted_clip(const char *input_mp4, int start_s, int en
   if (speed < 0.05) speed = 0.05;
   if (speed > 20.0) speed = 20.0;
 
-  char *in_esc  = sh_escape(input_mp4);
-  char *nar_esc = sh_escape(narration_mp3);
-  char *out_esc = sh_escape(out_mp4);
-
-  int rc = run_cmd(
-    "ffmpeg -y -hide_banner -loglevel error "
-    "-ss %d -to %d -i %s "
-    "-i %s "
-    "-filter_complex \"[0:v]setpts=PTS/%.10f[v]\" "
-    "-map \"[v]\" -map 1:a "
-    "-c:v libx264 -pix_fmt yuv420p -preset veryfast -crf 22 "
-    "-c:a aac -b:a 192k "
-    "-shortest %s",
-    use_start, use_end, in_esc, nar_esc, speed, out_esc
-  );
-
-  free(in_esc);
-  free(nar_esc);
-  free(out_esc);
-
-  return rc == 0 && file_exists(out_mp4);
-}
-
-static bool ffmpeg_concat_videos(const char *list_txt, const char *out_mp4) {
-  char *list_esc = sh_escape(list_txt);
-  char *out_esc  = sh_escape(out_mp4);
-
-  int rc = run_cmd(
-    "ffmpeg -y -hide_banner -loglevel error "
-    "-f concat -safe 0 -i %s "
-    "-c:v libx264 -pix_fmt yuv420p -preset veryfast -crf 22 "
-    "-c:a aac -b:a 192k "
-    "-movflags +faststart %s",
-    list_esc, out_esc
-  );
-
-  free(list_esc);
-  free(out_esc);
-  return rc == 0 && file_exists(out_mp4);
-}
-
-static bool ffmpeg_trim_audio(const char *in_audio, double start_s, double dur_s, const char *out_m4a) {
-  char *in_esc  = sh_escape(in_audio);
-  char *out_esc = sh_escape(out_m4a);
-  int rc = run_cmd(
-    "ffmpeg -y -hide_banner -loglevel error "
-    "-ss %.3f -i %s -t %.3f "
-    "-c:a aac -b:a 192k %s",
-    start_s, in_esc, dur_s, out_esc
-  );
-  free(in_esc);
-  free(out_esc);
-  return rc == 0 && file_exists(out_m4a);
-}
-
-static bool ffmpeg_concat_audio(const char *list_txt, const char *out_m4a) {
-  char *list_esc = sh_escape(list_txt);
-  char *out_esc  = sh_escape(out_m4a);
-  int rc = run_cmd(
-    "ffmpeg -y -hide_banner -loglevel error "
-    "-f concat -safe 0 -i %s -c copy %s",
-    list_esc, out_esc
-  );
-  free(list_esc);
-  free(out_esc);
-  return rc == 0 && file_exists(out_m4a);
-}
-
-static bool ffmpeg_mix_bgm(const char *video_in, const char *bgm_in, const char *video_out) {
-  char *v_esc = sh_escape(video_in);
-  char *b_esc = sh_escape(bgm_in);
-  char *o_esc = sh_escape(video_out);
-
-  int rc = run_cmd(
-    "ffmpeg -y -hide_banner -loglevel error "
-    "-i %s -i %s "
-    "-filter_complex \"[0:a]volume=2.5[a0];[1:a]volume=0.1[a1];"
-    "[a0][a1]amix=inputs=2:duration=first:dropout_transition=2[a]\" "
-    "-map 0:v -map \"[a]\" "
-    "-c:v copy -c:a aac -b:a 192k -movflags +faststart %s",
-    v_esc, b_esc, o_esc
-  );
-
-  free(v_esc);
-  free(b_esc);
-  free(o_esc);
-  return rc == 0 && file_exists(video_out);
+  const char *argv[] = {
+    "ffmpeg", "-y", "-hide_banner", "-loglevel", "error",
+    "-ss", arena_sprintf(g_movie_arena, "%d", use_start),
+    "-to", arena_sprintf(g_movie_arena, "%d", use_end),
+    "-i", input_mp4,
+    "-filter_complex", arena_sprintf(g_movie_arena, "[0:v]setpts=PTS/%.10f[v]", speed),
+    "-map", "[v]", "-an",
+    "-c:v", "libx264", "-pix_fmt", "yuv420p", "-preset", "veryfast", "-crf", "22",
+    "-t", arena_sprintf(g_movie_arena, "%.3f", narration_dur), out_mp4, NULL
+  };
+  return start_ffmpeg(argv, STAGE_CLIP, clip_no, narration_dur);
+}
+
+/* Concatenates the (silent) clips and muxes in the assembled soundtrack:
+   the one place the audio is encoded. */
+static bool ffmpeg_concat_mux(const char *list_txt, const char *soundtrack_wav, double total_s,
+                              const char *out_mp4) {
+  const char *argv[] = {
+    "ffmpeg", "-y", "-hide_banner", "-loglevel", "error",
+    "-f", "concat", "-safe", "0", "-i", list_txt,
+    "-i", soundtrack_wav,
+    "-map", "0:v", "-map", "1:a",
+    "-c:v", "libx264", "-pix_fmt", "yuv420p", "-preset", "veryfast", "-crf", "22",
+    "-c:a", "aac", "-b:a", "192k",
+    "-shortest", "-movflags", "+faststart", out_mp4, NULL
+  };
+  return run_ffmpeg(argv, STAGE_CONCAT, total_s) && file_exists(out_mp4);
+}
+
+/* One audio input for ffmpeg_decode_pcm(): in from start_s for dur_s
+   (0 = to the end), decoded to raw samples in out. */
+typedef struct {
+  const char *in;
+  double start_s;
+  double dur_s;
+  const char *out;
+} PcmJob;
+
+/* Decodes every job in one FFmpeg process to s16le at AUDIOMIX_RATE with the
+   given channel count, ready for audiomix. */
+static bool ffmpeg_decode_pcm(const PcmJob *jobs, size_t n, int channels, MetricsStage stage,
+                              double total_s) {
+  const char **argv = (const char **)arena_alloc(g_movie_arena, (6 + n * 16) * sizeof(*argv));
+  size_t k = 0;
+  argv[k++] = "ffmpeg";
+  argv[k++] = "-y";
+  argv[k++] = "-hide_banner";
+  argv[k++] = "-loglevel";
+  argv[k++] = "error";
+  for (size_t i = 0; i < n; i++) {
+    if (jobs[i].start_s > 0.0) {
+      argv[k++] = "-ss";
+      argv[k++] = arena_sprintf(g_movie_arena, "%.3f", jobs[i].start_s);
+    }
+    if (jobs[i].dur_s > 0.0) {
+      argv[k++] = "-t";
+      argv[k++] = arena_sprintf(g_movie_arena, "%.3f", jobs[i].dur_s);
+    }
+    argv[k++] = "-i";
+    argv[k++] = jobs[i].in;
+  }
+  for (size_t i = 0; i < n; i++) {
+    argv[k++] = "-map";
+    argv[k++] = arena_sprintf(g_movie_arena, "%zu:a:0", i);
+    argv[k++] = "-ac";
+    argv[k++] = channels == 1 ? "1" : "2";
+    argv[k++] = "-ar";
+    argv[k++] = arena_sprintf(g_movie_arena, "%d", AUDIOMIX_RATE);
+    argv[k++] = "-f";
+    argv[k++] = "s16le";
+    argv[k++] = jobs[i].out;
+  }
+  argv[k] = NULL;
+  if (!run_ffmpeg(argv, stage, total_s)) return false;
+  for (size_t i = 0; i < n; i++) {
+    if (!file_exists(jobs[i].out)) return false;
+  }
+  return true;
 }
 
 static bool ffmpeg_make_vertical(const char *in_mp4, const char *out_mp4) {
@@ -1560,37 +1528,49 @@ static bool ffmpeg_make_vertical(const char *in_mp4, const char *out_mp4) {
   out_w &= ~1;
   out_h &= ~1;
 
-  char *in_esc  = sh_escape(in_mp4);
-  char *out_esc = sh_escape(out_mp4);
-
-  int rc = run_cmd(
-    "ffmpeg -y -hide_banner -loglevel error "
-    "-i %s -t %.3f "
-    "-filter_complex "
-    "\"[0:v]"
-      "crop=iw*0.6:ih:iw*0.2:0,"
-      "scale=%d:%d:force_original_aspect_ratio=decrease,"
-      "pad=%d:%d:(ow-iw)/2:(oh-ih)/2:black"
-    "[v]\" "
-    "-map \"[v]\" -map 0:a? "
-    "-c:v libx264 -pix_fmt yuv420p -preset veryfast -crf 22 "
-    "-c:a aac -b:a 192k "
-    "-movflags +faststart "
-    "%s",
-    in_esc, dur,
-    out_w, out_h,
-    out_w, out_h,
-    out_esc
-  );
-
-  free(in_esc);
-  free(out_esc);
-
-  if (rc != 0) { unlink(out_mp4); return false; }
+  const char *argv[] = {
+    "ffmpeg", "-y", "-hide_banner", "-loglevel", "error",
+    "-i", in_mp4, "-t", arena_sprintf(g_movie_arena, "%.3f", dur),
+    "-filter_complex", arena_sprintf(g_movie_arena,
+      "[0:v]"
+        "crop=iw*0.6:ih:iw*0.2:0,"
+        "scale=%d:%d:force_original_aspect_ratio=decrease,"
+        "pad=%d:%d:(ow-iw)/2:(oh-ih)/2:black"
+      "[v]",
+      out_w, out_h, out_w, out_h),
+    "-map", "[v]", "-map", "0:a?",
+    "-c:v", "libx264", "-pix_fmt", "yuv420p", "-preset", "veryfast", "-crf", "22",
+    "-c:a", "copy",
+    "-movflags", "+faststart",
+    out_mp4, NULL
+  };
+
+  if (!run_ffmpeg(argv, STAGE_VERTICAL, dur)) { unlink(out_mp4); return false; }
   return file_exists(out_mp4);
 }
 
-static char **list_files_with_ext(const char *dir, const char *ext1, const char *ext2, size_t *out_n) {
+/* Small cut for reviewing a render: the first PREVIEW_SECONDS at 480p. */
+static bool ffmpeg_make_preview(const char *in_mp4, const char *out_mp4) {
+  double dur = ffprobe_duration_seconds(in_mp4);
+  if (dur <= 0.1) return false;
+  if (dur > PREVIEW_SECONDS) dur = PREVIEW_SECONDS;
+
+  const char *argv[] = {
+    "ffmpeg", "-y", "-hide_banner", "-loglevel", "error",
+    "-i", in_mp4, "-t", arena_sprintf(g_movie_arena, "%.3f", dur),
+    "-vf", "scale=-2:480",
+    "-c:v", "libx264", "-pix_fmt", "yuv420p", "-preset", "veryfast", "-crf", "28",
+    "-c:a", "aac", "-b:a", "96k",
+    "-movflags", "+faststart",
+    out_mp4, NULL
+  };
+
+  if (!run_ffmpeg(argv, STAGE_PREVIEW, dur)) { unlink(out_mp4); return false; }
+  return file_exists(out_mp4);
+}
+
+/* The list and its strings live in arena a. */
+static char **list_files_with_ext(Arena *a, const char *dir, const char *ext1, const char *ext2, size_t *out_n) {
   *out_n = 0;
   DIR *d = opendir(dir);
   if (!d) return NULL;
@@ -1599,7 +1579,7 @@ static char **list_files_with_ext(const char *dir, const char *ext1, const char
   size_t cap = 0;
 
   struct dirent *ent;
-  while ((ent = readdir(d))) {
+  while (runctl_checkpoint() && (ent = readdir(d))) {
     if (ent->d_name[0] == '.') continue;
     const char *name = ent->d_name;
     size_t ln = strlen(name);
@@ -1615,9 +1595,10 @@ static char **list_files_with_ext(const char *dir, const char *ext1, const char
     if (!ok) continue;
 
     if (*out_n + 1 > cap) {
+      char **grown = (char **)arena_alloc(a, (cap ? cap * 2 : 16) * sizeof(char *));
+      if (arr) memcpy(grown, arr, *out_n * sizeof(char *));
+      arr = grown;
       cap = cap ? cap * 2 : 16;
-      arr = (char **)realloc(arr, cap * sizeof(char *));
-      if (!arr) die("OOM");
     }
     char path[PATH_MAX];
 #ifdef _WIN32
@@ -1625,19 +1606,13 @@ static char **list_files_with_ext(const char *dir, const char *ext1, const char
 #else
     snprintf(path, sizeof(path), "%s/%s", dir, name);
 #endif
-    arr[*out_n] = strdup(path);
+    arr[*out_n] = arena_strdup(a, path);
     (*out_n)++;
   }
   closedir(d);
   return arr;
 }
 
-static void free_str_list(char **lst, size_t n) {
-  if (!lst) return;
-  for (size_t i = 0; i < n; i++) free(lst[i]);
-  free(lst);
-}
-
 static bool rm_rf_path(const char *path) {
   struct stat st;
   if (lstat(path, &st) != 0) return false;
@@ -1705,26 +1680,152 @@ static bool clear_directory_contents(const char *dir_path) {
 
 /* ----------------------- Movie pipeline ----------------------- */
 
-static bool process_movie(const Config *cfg, const char *movie_path, const char *movie_title,
-                          int num_clips) {
-  ensure_dir("clips");
-  ensure_dir("clips/audio");
-  ensure_dir("output");
-  ensure_dir("tiktok_output");
-  ensure_dir("scripts");
-  ensure_dir("scripts/srt_files");
-  ensure_dir("movies_retired");
+/* Clip encoders in flight for one movie. */
+typedef struct {
+  Proc *enc[MAX_CLIP_ENCODERS];
+  Encode *job[MAX_CLIP_ENCODERS];
+  size_t n;
+  bool *ok;             /* per plan item: encoder started and (later) succeeded */
+  double *secs;         /* per plan item: length of the clip built */
+  size_t made;
+  const char *title;
+  const char *dir;      /* where the clips are written */
+} ClipBatch;
+
+/* Collects finished encoders. Blocks while every slot is busy, while the run
+   is paused (so the encoders can be suspended), or when all is set. */
+static void clips_reap(ClipBatch *b, bool all) {
+  while (b->n > 0) {
+    bool hold = runctl_paused() && !runctl_cancelled();
+    bool block = all || hold || b->n == (size_t)g_opt.clip_encoders;
+    int k = proc_wait_any(b->enc, b->n, hold ? 100 : (block ? -1 : 0));
+    if (k < 0) {
+      if (hold) continue;
+      break;
+    }
+
+    Encode *e = b->job[k];
+    size_t c = (size_t)e->clip - 1;
+    char out_clip[PATH_MAX];
+    snprintf(out_clip, sizeof(out_clip), "%s/%s_clip_%zu.mp4", b->dir, b->title, c + 1);
+    metrics_observe_stage(STAGE_CLIP, proc_result(e->proc)->seconds);
+
+    if (finish_ffmpeg(e) && file_exists(out_clip)) {
+      b->made++;
+      b->secs[c] = e->total_s;
+      metrics_inc(METRIC_CLIPS_BUILT, 1);
+      logok("Built clip %zu OK: %s", c + 1, out_clip);
+    } else {
+      b->ok[c] = false;
+      if (!movie_stopped()) {
+        logw("Failed to build adjusted clip %zu", c + 1);
+        metrics_inc(METRIC_CLIPS_FAILED, 1);
+      }
+    }
+
+    b->n--;
+    b->enc[k] = b->enc[b->n];
+    b->job[k] = b->job[b->n];
+    b->enc[b->n] = NULL;
+  }
+}
+
+/* Copies through a temp file next to dst, for moves across filesystems. */
+static bool copy_file(const char *src, const char *dst) {
+  char tmp[PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.part", dst);
+  FILE *in = fopen(src, "rb");
+  if (!in) return false;
+  FILE *out = fopen(tmp, "wb");
+  if (!out) {
+    fclose(in);
+    return false;
+  }
+
+  char *buf = (char *)malloc(1u << 20);
+  if (!buf) die("OOM");
+  bool ok = true;
+  size_t n;
+  while ((n = fread(buf, 1, 1u << 20, in)) > 0) {
+    if (fwrite(buf, 1, n, out) != n) {
+      ok = false;
+      break;
+    }
+  }
+  if (ferror(in)) ok = false;
+  free(buf);
+  fclose(in);
+  if (fclose(out) != 0) ok = false;
+  if (!ok) {
+    unlink(tmp);
+    return false;
+  }
+  return publish_file(tmp, dst);
+}
+
+/* Moves the finished source to retired_dir. The directories may sit on
+   different filesystems (a shared movies/ with a local retired dir), where
+   rename() fails with EXDEV; the source is then copied and removed. A source
+   that is already gone (retired by another worker) is not an error. */
+static void retire_source(const char *movie_path, const char *movie_title) {
+  char retired[PATH_MAX];
+  snprintf(retired, sizeof(retired), "%s/%s.mp4", g_opt.retired_dir, movie_title);
+  if (rename(movie_path, retired) == 0) {
+    logok("Retired source movie -> %s", retired);
+    return;
+  }
+
+  int err = errno;
+  if (err == ENOENT && !file_exists(movie_path)) {
+    logi("Source %s is already gone; nothing to retire", movie_path);
+  } else if (err == EXDEV && copy_file(movie_path, retired)) {
+    if (unlink(movie_path) == 0) logok("Retired source movie (copied) -> %s", retired);
+    else logw("Copied %s to %s but could not remove it: %s", movie_path, retired, strerror(errno));
+  } else {
+    logw("Could not retire %s: %s", movie_path, strerror(err));
+  }
+}
+
+/* What process_movie() got through, for the per-title report. */
+typedef struct {
+  int clips_planned;
+  int clips_built;
+  bool planned_only;    /* plan-only run: the plan file was written */
+  bool skipped;         /* shard worker: nothing left for this process */
+  char detail[PATH_MAX];
+} MovieReport;
+
+/* Published renders; each buffer is PATH_MAX bytes. */
+static void output_paths(const char *movie_title, char *horizontal, char *vertical, char *preview) {
+  snprintf(horizontal, PATH_MAX, "%s/%s.mp4", g_opt.output_dir, movie_title);
+  snprintf(vertical, PATH_MAX, "%s/%s_vertical.mp4", g_opt.vertical_dir, movie_title);
+  snprintf(preview, PATH_MAX, "%s/%s_preview.mp4", g_opt.preview_dir, movie_title);
+}
+
+static void plan_file_path(const char *movie_title, char *out, size_t outsz) {
+  snprintf(out, outsz, "%s/%s_plan.json", g_opt.plans_dir, movie_title);
+}
+
+/* Planning half: subtitles, the optional IMSDb script and the OpenAI request.
+   An empty list means the title failed (or the run was cancelled). */
+static ClipPlanList plan_movie(const Config *cfg, const char *movie_title, int num_clips) {
+  ClipPlanList none = { .arena = g_movie_arena };
+  ensure_dir(g_srt_dir);
 
   char srt_in[PATH_MAX], srt_mod[PATH_MAX], script_txt[PATH_MAX];
-  snprintf(srt_in, sizeof(srt_in), "scripts/srt_files/%s.srt", movie_title);
-  snprintf(srt_mod, sizeof(srt_mod), "scripts/srt_files/%s_modified.srt", movie_title);
-  snprintf(script_txt, sizeof(script_txt), "scripts/srt_files/%s_summary.txt", movie_title);
+  snprintf(srt_in, sizeof(srt_in), "%s/%s.srt", g_srt_dir, movie_title);
+  snprintf(srt_mod, sizeof(srt_mod), "%s/%s_modified.srt", g_srt_dir, movie_title);
+  snprintf(script_txt, sizeof(script_txt), "%s/%s_summary.txt", g_srt_dir, movie_title);
 
+  enter_stage(STAGE_SUBTITLES);
+  double t_stage = metrics_now();
   if (!file_exists(srt_in)) {
     logi("No SRT found for %s; attempting download...", movie_title);
-    if (!download_subtitle_srt(movie_title, srt_in)) {
+    bool got = download_subtitle_srt(cfg, movie_title, srt_in);
+    metrics_observe_stage(STAGE_SUBTITLES, metrics_now() - t_stage);
+    if (!got) {
       logw("Subtitle download failed for %s. Place your SRT at: %s", movie_title, srt_in);
-      return false;
+      return none;
     }
     logok("Downloaded SRT: %s", srt_in);
   } else {
@@ -1735,13 +1836,15 @@ static bool process_movie(const Config *cfg, const char *movie_path, const char
     logi("Converting SRT timestamps -> seconds: %s -> %s", srt_in, srt_mod);
     if (!convert_srt_timestamps_to_seconds(srt_in, srt_mod)) {
       logw("Failed to convert SRT for %s", movie_title);
-      return false;
+      return none;
     }
     logok("Converted subtitles (seconds): %s", srt_mod);
   } else {
     logok("Using cached converted subtitles: %s", srt_mod);
   }
 
+  if (!movie_checkpoint()) return none;
+
   long sz = file_size_bytes(script_txt);
   if (sz >= 0 && sz < 200) {
     logw("IMSDb script file looks too small (%ld bytes). Deleting to retry: %s", sz, script_txt);
@@ -1753,27 +1856,32 @@ static bool process_movie(const Config *cfg, const char *movie_path, const char
     logok("Found cached IMSDb script: %s (%ld bytes)", script_txt, file_size_bytes(script_txt));
   } else {
     logi("Attempting IMSDb script scrape for %s (optional context)...", movie_title);
-    if (download_imsdb_script_ex(movie_title, script_txt, imsdb_url, sizeof(imsdb_url))) {
+    enter_stage(STAGE_SCRIPT);
+    t_stage = metrics_now();
+    bool got = download_imsdb_script_ex(cfg, movie_title, script_txt, imsdb_url, sizeof(imsdb_url));
+    metrics_observe_stage(STAGE_SCRIPT, metrics_now() - t_stage);
+    if (got) {
       logok("IMSDb script saved: %s (source: %s)", script_txt, imsdb_url[0] ? imsdb_url : "unknown");
     } else {
       logw("IMSDb scrape failed for %s (this is OK; continuing with subtitles-only).", movie_title);
     }
   }
 
-  char *subs_seconds = read_entire_file(srt_mod);
-  if (!subs_seconds) {
+  if (!movie_checkpoint()) return none;
+
+  /* Both inputs are mapped, not copied; the request writer reads them in place. */
+  FileView subs_view, script_view = {0};
+  if (!file_view_open(&subs_view, srt_mod)) {
     logw("Failed to read converted subtitles for %s: %s", movie_title, srt_mod);
-    return false;
+    return none;
   }
-  logok("Loaded subtitles for planning: %s (%zu bytes)", srt_mod, strlen(subs_seconds));
+  logok("Loaded subtitles for planning: %s (%zu bytes)", srt_mod, subs_view.len);
 
-  char *imsdb_script = NULL;
   if (file_exists(script_txt)) {
-    imsdb_script = read_entire_file(script_txt);
-    if (imsdb_script && strlen(imsdb_script) > 0) {
-      logok("Loaded IMSDb script for extra context: %s (%zu bytes)", script_txt, strlen(imsdb_script));
+    if (file_view_open(&script_view, script_txt) && script_view.len > 0) {
+      logok("Loaded IMSDb script for extra context: %s (%zu bytes)", script_txt, script_view.len);
     } else {
-      if (imsdb_script) { free(imsdb_script); imsdb_script = NULL; }
+      file_view_close(&script_view);
       logw("IMSDb script file existed but was empty/unreadable: %s", script_txt);
     }
   } else {
@@ -1781,202 +1889,820 @@ static bool process_movie(const Config *cfg, const char *movie_path, const char
   }
 
   logi("Requesting OpenAI clip plan (%d clips target)...", num_clips);
+  enter_stage(STAGE_PLAN);
+  t_stage = metrics_now();
   bool retry_no_script = false;
-  ClipPlanList plan = openai_make_plan(cfg, movie_title, subs_seconds,
-                                       imsdb_script ? imsdb_script : "",
+  ClipPlanList plan = openai_make_plan(cfg, movie_title, subs_view.data, subs_view.len,
+                                       script_view.data, script_view.len,
                                        num_clips, &retry_no_script);
 
-  if (plan.count == 0 && retry_no_script && imsdb_script && imsdb_script[0]) {
+  if (plan.count == 0 && retry_no_script && script_view.len > 0) {
     logw("OpenAI request failed with IMSDb context; retrying without IMSDb script for %s", movie_title);
-    plan = openai_make_plan(cfg, movie_title, subs_seconds, "", num_clips, NULL);
+    plan = openai_make_plan(cfg, movie_title, subs_view.data, subs_view.len, NULL, 0, num_clips, NULL);
   }
+  metrics_observe_stage(STAGE_PLAN, metrics_now() - t_stage);
 
-  free(subs_seconds);
-  if (imsdb_script) free(imsdb_script);
+  file_view_close(&subs_view);
+  file_view_close(&script_view);
 
-  if (plan.count == 0) {
-    logw("No plan returned for %s", movie_title);
+  if (plan.count == 0 || !movie_checkpoint()) {
+    if (!movie_stopped()) logw("No plan returned for %s", movie_title);
     free_clip_plan_list(&plan);
-    return false;
+    return none;
   }
   logok("OpenAI plan received: %zu clips", plan.count);
+  return plan;
+}
 
-  char concat_list_path[PATH_MAX];
-  snprintf(concat_list_path, sizeof(concat_list_path), "clips/%s_concat_list.txt", movie_title);
+/* Plan files record the source they were made from so a render elsewhere can
+   tell when its copy of the movie is a different cut. */
+static bool write_plan_file(const ClipPlanList *plan, const char *movie_path, const char *movie_title,
+                            char *out_path, size_t outsz) {
+  ClipPlanInfo info = {0};
+  snprintf(info.title, sizeof(info.title), "%s", movie_title);
+  const char *base = strrchr(movie_path, '/');
+  snprintf(info.source, sizeof(info.source), "%s", base ? base + 1 : movie_path);
+  info.source_seconds = ffprobe_duration_seconds(movie_path);
+
+  ensure_dir(g_opt.plans_dir);
+  plan_file_path(movie_title, out_path, outsz);
+  size_t len = 0;
+  char *json = clip_plan_to_json(plan, &info, &len);
+  bool wrote = write_file_atomic(out_path, json, len);
+  free(json);
+  if (!wrote) {
+    logw("Could not write plan file: %s", out_path);
+    return false;
+  }
+  logok("Wrote plan: %s", out_path);
+  return true;
+}
 
-  FILE *listf = fopen(concat_list_path, "wb");
-  if (!listf) {
-    logw("Failed to create concat list: %s", concat_list_path);
-    free_clip_plan_list(&plan);
+/* Render-only runs: the plan comes from <plans_dir>, never from the LLM. */
+static bool load_plan_file(const char *movie_path, const char *movie_title, ClipPlanList *plan,
+                           MovieReport *rep) {
+  char plan_path[PATH_MAX];
+  plan_file_path(movie_title, plan_path, sizeof(plan_path));
+
+  enter_stage(STAGE_PLAN);
+  FileView view;
+  if (!file_view_open(&view, plan_path)) {
+    logw("No plan file for %s: %s", movie_title, plan_path);
+    snprintf(rep->detail, sizeof(rep->detail), "plan missing");
     return false;
   }
 
-  size_t made = 0;
-  for (size_t i = 0; i < plan.count; i++) {
-    int start_s = plan.items[i].start;
-    int end_s   = plan.items[i].end;
+  ClipPlanInfo info;
+  char err[160];
+  bool ok = clip_plan_from_json(g_movie_arena, view.data, view.len, &info, plan, err, sizeof(err));
+  file_view_close(&view);
+  if (!ok) {
+    logw("Unusable plan file %s: %s", plan_path, err);
+    snprintf(rep->detail, sizeof(rep->detail), "plan: %s", err);
+    return false;
+  }
+  logok("Loaded plan: %s (%zu clips, version %d)", plan_path, plan->count, info.version);
+
+  if (info.source_seconds > 0) {
+    double have = ffprobe_duration_seconds(movie_path);
+    if (have > 0 && fabs(have - info.source_seconds) > 2.0) {
+      logw("%s runs %.1fs but its plan was made from a %.1fs source (%s); clip times may be off",
+           movie_path, have, info.source_seconds, info.source[0] ? info.source : "unknown");
+    }
+  }
+  return true;
+}
+
+/* Clips to build from a plan: every index i with i % shards == shard,
+   written to <dir>/<title>_clip_<i+1>.mp4 (silent) with its narration in
+   <dir>/<title>_clip_<i+1>.mp3. A whole movie is shard 0 of 1. */
+typedef struct {
+  const char *dir;
+  size_t shard;
+  size_t shards;
+} ClipSet;
+
+/* Narration and clip encodes for the clips in set. ok[] and secs[] (one per
+   plan item) receive which clips were built and how long they are. Returns
+   the number built. */
+static size_t build_clips(const Config *cfg, const char *movie_path, const char *movie_title,
+                          const ClipPlanList *plan, const ClipSet *set, bool *ok, double *secs) {
+  ensure_dir(set->dir);
+
+  /* Encoders run in the background; ok[] records which ones succeeded so the
+     concat list keeps plan order no matter which finishes first. */
+  enter_stage(STAGE_CLIP);
+  memset(ok, 0, plan->count * sizeof(bool));
+  memset(secs, 0, plan->count * sizeof(double));
+  ClipBatch batch = { .ok = ok, .secs = secs, .title = movie_title, .dir = set->dir };
+
+  /* Narration is requested tts_jobs clips at a time; tts_ok[] holds the
+     outcome for every clip up to tts_next. Each narration stays next to its
+     clip (<title>_clip_<n>.mp3) for the soundtrack. */
+  bool *tts_ok = (bool *)arena_alloc(g_movie_arena, plan->count * sizeof(bool));
+  memset(tts_ok, 0, plan->count * sizeof(bool));
+  char **nar_paths = (char **)arena_alloc(g_movie_arena, plan->count * sizeof(char *));
+  for (size_t i = 0; i < plan->count; i++) {
+    nar_paths[i] = arena_sprintf(g_movie_arena, "%s/%s_clip_%zu.mp3", set->dir, movie_title, i + 1);
+  }
+  size_t tts_next = 0;
+
+  for (size_t i = set->shard; i < plan->count; i += set->shards) {
+    clips_reap(&batch, false);
+    if (!movie_checkpoint()) break;
+
+    int start_s = plan->items[i].start;
+    int end_s   = plan->items[i].end;
     if (start_s <= 0) { logw("Skipping clip %zu (start<=0)", i + 1); continue; }
     if (end_s <= start_s) { logw("Skipping clip %zu (end<=start)", i + 1); continue; }
 
-    char nar_mp3[PATH_MAX];
-    snprintf(nar_mp3, sizeof(nar_mp3), "clips/audio/%s_audio_%zu.mp3", movie_title, i + 1);
+    const char *nar_mp3 = nar_paths[i];
+
+    metrics_gauge_set(METRIC_QUEUE_CLIPS, (long long)(plan->count - i));
+
+    if (i >= tts_next) {
+      TtsJob jobs[MAX_TTS_JOBS];
+      size_t idx[MAX_TTS_JOBS], n = 0;
+      for (size_t k = i; k < plan->count && n < (size_t)g_opt.tts_jobs; k += set->shards) {
+        tts_next = k + 1;
+        if (plan->items[k].start <= 0 || plan->items[k].end <= plan->items[k].start) continue;
+        jobs[n] = (TtsJob){ plan->items[k].narration, nar_paths[k], k + 1, false };
+        idx[n++] = k;
+      }
+
+      if (n == 1) logi("TTS clip %zu/%zu -> %s", i + 1, plan->count, nar_mp3);
+      else logi("TTS clips %zu..%zu/%zu (%zu requests)", i + 1, idx[n - 1] + 1, plan->count, n);
+      double t_tts = metrics_now();
+      elevenlabs_tts_batch(cfg, jobs, n);
+      metrics_observe_stage(STAGE_TTS, metrics_now() - t_tts);
+      for (size_t k = 0; k < n; k++) tts_ok[idx[k]] = jobs[k].ok;
+      if (movie_stopped()) break;
+    }
 
-    logi("TTS clip %zu/%zu -> %s", i + 1, plan.count, nar_mp3);
-    if (!elevenlabs_tts_to_mp3(cfg, plan.items[i].narration, nar_mp3)) {
+    if (!tts_ok[i]) {
       logw("TTS failed clip %zu for %s", i + 1, movie_title);
+      metrics_inc(METRIC_CLIPS_FAILED, 1);
       continue;
     }
 
     double nar_dur = ffprobe_duration_seconds(nar_mp3);
     if (nar_dur <= 0.1) {
       logw("Bad narration duration for clip %zu", i + 1);
+      metrics_inc(METRIC_CLIPS_FAILED, 1);
       continue;
     }
 
-    char out_clip_name[PATH_MAX];
-    snprintf(out_clip_name, sizeof(out_clip_name), "%s_clip_%zu.mp4", movie_title, i + 1);
-
     char out_clip[PATH_MAX];
-    snprintf(out_clip, sizeof(out_clip), "clips/%s", out_clip_name);
+    snprintf(out_clip, sizeof(out_clip), "%s/%s_clip_%zu.mp4", set->dir, movie_title, i + 1);
 
     logi("Building clip %zu: %d -> %d sec (narr=%.2fs) => %s", i + 1, start_s, end_s, nar_dur, out_clip);
-    if (!ffmpeg_make_adjusted_clip(movie_path, start_s, end_s, nar_mp3, nar_dur, out_clip)) {
+    Encode *e = ffmpeg_start_adjusted_clip(movie_path, start_s, end_s, nar_dur, out_clip, (int)(i + 1));
+    if (!e) {
       logw("Failed to build adjusted clip %zu", i + 1);
+      metrics_inc(METRIC_CLIPS_FAILED, 1);
       continue;
     }
+    batch.ok[i] = true;
+    batch.enc[batch.n] = e->proc;
+    batch.job[batch.n] = e;
+    batch.n++;
+  }
+  clips_reap(&batch, true);
+  metrics_gauge_set(METRIC_QUEUE_CLIPS, 0);
+  return batch.made;
+}
 
-    fprintf(listf, "file '%s'\n", out_clip_name);
-    made++;
-    logok("Built clip %zu OK: %s", i + 1, out_clip);
-  }
+static void ensure_output_dirs(void) {
+  ensure_dir(g_opt.work_dir);
+  if (g_opt.outputs & GENERATOR_OUT_HORIZONTAL) ensure_dir(g_opt.output_dir);
+  if (g_opt.outputs & GENERATOR_OUT_VERTICAL) ensure_dir(g_opt.vertical_dir);
+  if (g_opt.outputs & GENERATOR_OUT_PREVIEW) ensure_dir(g_opt.preview_dir);
+  if (!g_opt.keep_sources) ensure_dir(g_opt.retired_dir);
+}
 
-  fclose(listf);
-  free_clip_plan_list(&plan);
+/* Random index below n for the movie on this thread. rand() need not be
+   thread-safe, and workers seeded in the same second would pick the same
+   music; each thread gets its own xorshift state, seeded apart. */
+static GEN_TLS uint64_t t_rand = 0;
+
+static size_t movie_rand(size_t n) {
+  static atomic_uint seq = 0;
+  if (t_rand == 0) {
+    t_rand = ((uint64_t)time(NULL) << 16) ^ ((uint64_t)(atomic_fetch_add(&seq, 1) + 1) * 0x9e3779b97f4a7c15ull);
+    if (t_rand == 0) t_rand = 1;
+  }
+  t_rand ^= t_rand << 13;
+  t_rand ^= t_rand >> 7;
+  t_rand ^= t_rand << 17;
+  return (size_t)(t_rand % n);
+}
+
+/* Second half of a render, once the clips exist in clip_dir: concat, BGM,
+   mix, the published renders and retiring the source. */
+static bool finish_movie(const char *movie_path, const char *movie_title, const char *clip_dir,
+                         const bool *ok, const double *secs, size_t n, size_t made, MovieReport *rep) {
+  if (movie_stopped()) return false;
+  metrics_observe_clips_per_movie(made);
+  rep->clips_built = (int)made;
 
   if (made == 0) {
     logw("No clips produced for %s", movie_title);
     return false;
   }
-  logok("Clips produced: %zu (concat list: %s)", made, concat_list_path);
 
-  char tmp_concat[PATH_MAX];
-  snprintf(tmp_concat, sizeof(tmp_concat), "clips/%s_concat_tmp.mp4", movie_title);
-
-  logi("Concatenating clips -> %s", tmp_concat);
-  if (!ffmpeg_concat_videos(concat_list_path, tmp_concat)) {
-    logw("Concat failed for %s", movie_title);
+  /* Plan order; ffmpeg resolves the entries relative to the list file. */
+  char concat_list_path[PATH_MAX];
+  snprintf(concat_list_path, sizeof(concat_list_path), "%s/%s_concat_list.txt", clip_dir, movie_title);
+  FILE *listf = fopen(concat_list_path, "wb");
+  if (!listf) {
+    logw("Failed to create concat list: %s", concat_list_path);
     return false;
   }
-  logok("Concat OK: %s", tmp_concat);
+  for (size_t i = 0; i < n; i++) {
+    if (ok[i]) fprintf(listf, "file '%s_clip_%zu.mp4'\n", movie_title, i + 1);
+  }
+  fclose(listf);
+  logok("Clips produced: %zu (concat list: %s)", made, concat_list_path);
 
-  double final_dur = ffprobe_duration_seconds(tmp_concat);
+  /* Timeline: each narration starts with its clip and is cut where the
+     clip's video ends (a speed-capped clip can be shorter). */
+  AudioMixSource *voice = (AudioMixSource *)arena_alloc(g_movie_arena, made * sizeof(AudioMixSource));
+  PcmJob *voice_pcm = (PcmJob *)arena_alloc(g_movie_arena, made * sizeof(PcmJob));
+  size_t nv = 0;
+  double final_dur = 0.0;
+  for (size_t i = 0; i < n && nv < made; i++) {
+    if (!ok[i]) continue;
+    double len = ffprobe_duration_seconds(arena_sprintf(g_movie_arena, "%s/%s_clip_%zu.mp4",
+                                                        clip_dir, movie_title, i + 1));
+    if (len <= 0.1) len = secs[i];
+    voice_pcm[nv] = (PcmJob){
+      arena_sprintf(g_movie_arena, "%s/%s_clip_%zu.mp3", clip_dir, movie_title, i + 1), 0.0, 0.0,
+      arena_sprintf(g_movie_arena, "%s/%s_voice_%zu.pcm", g_opt.work_dir, movie_title, i + 1)
+    };
+    voice[nv] = (AudioMixSource){ voice_pcm[nv].out, 1, final_dur, len };
+    final_dur += len;
+    nv++;
+  }
   if (final_dur <= 0.1) {
     logw("Bad final duration for %s", movie_title);
     return false;
   }
   logok("Final duration: %.2f seconds", final_dur);
+  if (!movie_checkpoint()) return false;
 
-  size_t song_n = 0;
-  char **songs = list_files_with_ext("backgroundmusic", ".mp3", ".m4a", &song_n);
+  double t_stage;
+  size_t song_n = 0, nb = 0;
+  AudioMixSource bed[MAX_BGM_PARTS];
+  PcmJob bed_pcm[MAX_BGM_PARTS];
+  char **songs = list_files_with_ext(g_movie_arena, g_opt.music_dir, ".mp3", ".m4a", &song_n);
   if (!songs || song_n == 0) {
     logw("No backgroundmusic files found; output will be narration-only.");
-    char out_final_only[PATH_MAX];
-    snprintf(out_final_only, sizeof(out_final_only), "output/%s.mp4", movie_title);
-    rename(tmp_concat, out_final_only);
-    logok("Wrote output (no BGM): %s", out_final_only);
   } else {
-    srand((unsigned)time(NULL));
+    logi("Choosing BGM parts (%zu songs available)...", song_n);
+    enter_stage(STAGE_BGM);
+    t_stage = metrics_now();
+
+    /* Each song is probed once; too short ones are dropped. */
+    double *song_s = (double *)arena_alloc(g_movie_arena, song_n * sizeof(double));
+    size_t usable = 0;
+    for (size_t i = 0; i < song_n && movie_checkpoint(); i++) {
+      double sd = ffprobe_duration_seconds(songs[i]);
+      if (sd <= BGM_MIN_SONG_SECONDS) continue;
+      songs[usable] = songs[i];
+      song_s[usable++] = sd;
+    }
+    if (usable == 0 && !movie_stopped()) {
+      logw("No background music longer than %.0fs; output will be narration-only.", BGM_MIN_SONG_SECONDS);
+    }
 
-    char bgm_list[PATH_MAX];
-    snprintf(bgm_list, sizeof(bgm_list), "clips/%s_bgm_list.txt", movie_title);
-    FILE *bgml = fopen(bgm_list, "wb");
-    if (!bgml) die("Failed bgm list create");
+    double covered = 0.0;
+    while (usable > 0 && covered + 0.01 < final_dur && nb < MAX_BGM_PARTS && movie_checkpoint()) {
+      size_t pick = movie_rand(usable);
+      double avail = song_s[pick] - BGM_SKIP_SECONDS;
+      double need = final_dur - covered;
+      double take = (avail < need) ? avail : need;
 
-    logi("Building BGM track list (%zu songs available)...", song_n);
+      bed_pcm[nb] = (PcmJob){
+        songs[pick], BGM_SKIP_SECONDS, take,
+        arena_sprintf(g_movie_arena, "%s/%s_bgm_%zu.pcm", g_opt.work_dir, movie_title, nb + 1)
+      };
+      bed[nb] = (AudioMixSource){ bed_pcm[nb].out, 2, covered, take };
+      covered += take;
+      nb++;
+    }
+    if (movie_stopped()) return false;
+    logok("BGM parts: %zu (covered %.2fs / %.2fs)", nb, covered, final_dur);
 
-    double covered = 0.0;
-    int part = 0;
-    while (covered + 0.01 < final_dur) {
-      const char *song = songs[rand() % song_n];
-      double sd = ffprobe_duration_seconds(song);
-      if (sd <= 60.0) continue;
+    if (nb > 0 && !ffmpeg_decode_pcm(bed_pcm, nb, 2, STAGE_BGM, covered)) {
+      if (movie_stopped()) return false;
+      logw("BGM decode failed; output narration-only.");
+      nb = 0;
+    }
+    metrics_observe_stage(STAGE_BGM, metrics_now() - t_stage);
+  }
+
+  /* Narration and music meet once, as PCM; AAC is encoded only by the
+     final mux below. */
+  char soundtrack[PATH_MAX];
+  snprintf(soundtrack, sizeof(soundtrack), "%s/%s_soundtrack.wav", g_opt.work_dir, movie_title);
+  logi("Mixing narration%s -> %s", nb ? " + BGM" : "", soundtrack);
+  enter_stage(STAGE_MIX);
+  t_stage = metrics_now();
+  bool mix_ok = ffmpeg_decode_pcm(voice_pcm, nv, 1, STAGE_MIX, final_dur);
+  if (mix_ok) {
+    AudioMix mix = {
+      .voice = voice, .voice_n = nv, .voice_gain = nb ? NARRATION_GAIN : 1.0f,
+      .bed = bed, .bed_n = nb, .bed_gain = BGM_GAIN, .duck = &BGM_DUCK,
+      .total_s = final_dur,
+    };
+    mix_ok = audiomix_write_wav(&mix, soundtrack);
+  }
+  for (size_t i = 0; i < nv; i++) unlink(voice[i].path);
+  for (size_t i = 0; i < nb; i++) unlink(bed[i].path);
+  metrics_observe_stage(STAGE_MIX, metrics_now() - t_stage);
+  if (!mix_ok) {
+    logw("Soundtrack failed for %s", movie_title);
+    return false;
+  }
+  if (!movie_checkpoint()) return false;
 
-      double start = 40.0;
-      double avail = sd - start;
-      if (avail <= 1.0) continue;
+  /* The final renders stay in the work directory until everything is done
+     and are then renamed into the output directories. */
+  char final_src[PATH_MAX];
+  snprintf(final_src, sizeof(final_src), "%s/%s_final.mp4", g_opt.work_dir, movie_title);
 
-      double need = final_dur - covered;
-      double take = (avail < need) ? avail : need;
+  logi("Concatenating clips with the soundtrack -> %s", final_src);
+  enter_stage(STAGE_CONCAT);
+  t_stage = metrics_now();
+  bool concat_ok = ffmpeg_concat_mux(concat_list_path, soundtrack, final_dur, final_src);
+  metrics_observe_stage(STAGE_CONCAT, metrics_now() - t_stage);
+  unlink(soundtrack);
+  if (!concat_ok) {
+    logw("Concat failed for %s", movie_title);
+    return false;
+  }
+  logok("Concat OK: %s", final_src);
+  if (!movie_checkpoint()) return false;
+
+  bool want_h = (g_opt.outputs & GENERATOR_OUT_HORIZONTAL) != 0;
+  char out_final[PATH_MAX], out_vert[PATH_MAX], out_prev[PATH_MAX];
+  output_paths(movie_title, out_final, out_vert, out_prev);
+
+  /* Without the horizontal render there is no single "done" file, so every
+     selected render has to succeed. */
+  if (g_opt.outputs & GENERATOR_OUT_VERTICAL) {
+    char tmp_vert[PATH_MAX];
+    snprintf(tmp_vert, sizeof(tmp_vert), "%s/%s_vertical.mp4", g_opt.work_dir, movie_title);
+
+    logi("Rendering vertical -> %s", out_vert);
+    enter_stage(STAGE_VERTICAL);
+    t_stage = metrics_now();
+    bool vert_ok = ffmpeg_make_vertical(final_src, tmp_vert);
+    metrics_observe_stage(STAGE_VERTICAL, metrics_now() - t_stage);
+    if (movie_stopped()) return false;
+    if (!vert_ok) {
+      logw("Vertical render failed for %s", movie_title);
+    } else if (!publish_file(tmp_vert, out_vert)) {
+      logw("Could not move vertical render into place: %s", out_vert);
+      vert_ok = false;
+    } else {
+      logok("Vertical render OK: %s", out_vert);
+    }
+    if (!vert_ok && !want_h) return false;
+  }
+
+  if (g_opt.outputs & GENERATOR_OUT_PREVIEW) {
+    char tmp_prev[PATH_MAX];
+    snprintf(tmp_prev, sizeof(tmp_prev), "%s/%s_preview.mp4", g_opt.work_dir, movie_title);
+
+    logi("Rendering preview -> %s", out_prev);
+    enter_stage(STAGE_PREVIEW);
+    t_stage = metrics_now();
+    bool prev_ok = ffmpeg_make_preview(final_src, tmp_prev);
+    metrics_observe_stage(STAGE_PREVIEW, metrics_now() - t_stage);
+    if (movie_stopped()) return false;
+    if (!prev_ok) {
+      logw("Preview render failed for %s", movie_title);
+    } else if (!publish_file(tmp_prev, out_prev)) {
+      logw("Could not move preview into place: %s", out_prev);
+      prev_ok = false;
+    } else {
+      logok("Preview OK: %s", out_prev);
+    }
+    if (!prev_ok && !want_h) return false;
+  }
 
-      char part_name[PATH_MAX];
-      snprintf(part_name, sizeof(part_name), "%s_bgm_part_%d.m4a", movie_title, ++part);
+  /* Last, because the horizontal render is what marks the movie as done. */
+  if (want_h) {
+    if (!publish_file(final_src, out_final)) {
+      logw("Could not move final render into place: %s", out_final);
+      return false;
+    }
+    logok("Wrote output%s: %s", nb ? "" : " (no BGM)", out_final);
+  }
 
-      char part_path[PATH_MAX];
-      snprintf(part_path, sizeof(part_path), "clips/%s", part_name);
+  if (!g_opt.keep_sources) retire_source(movie_path, movie_title);
 
-      if (!ffmpeg_trim_audio(song, start, take, part_path)) continue;
+  return true;
+}
 
-      fprintf(bgml, "file '%s'\n", part_name);
-      covered += take;
+/* Rendering half on this process alone. Consumes the plan. */
+static bool render_movie(const Config *cfg, const char *movie_path, const char *movie_title,
+                         ClipPlanList plan, MovieReport *rep) {
+  ensure_output_dirs();
+  size_t n = plan.count;
+  bool *ok = (bool *)arena_alloc(g_movie_arena, n * sizeof(bool));
+  double *secs = (double *)arena_alloc(g_movie_arena, n * sizeof(double));
+  atomic_store(&g_run_clips_planned, (int)n);
+
+  ClipSet all = { g_opt.work_dir, 0, 1 };
+  size_t made = build_clips(cfg, movie_path, movie_title, &plan, &all, ok, secs);
+  free_clip_plan_list(&plan);
+  return finish_movie(movie_path, movie_title, g_opt.work_dir, ok, secs, n, made, rep);
+}
+
+/* ------------------------ Clip shards ------------------------ */
 
-      if (part > 200) break;
+/* One movie's clips split across processes. The coordinator (a rendering run
+   with shards > 1) publishes the job, then works on it like any shard worker:
+
+     <shard_dir>/<title>/plan.json        the plan, in plan file format
+     <shard_dir>/<title>/job.json         {"title","source","shards"}; written last
+     <shard_dir>/<title>/queue/           claims for "shard-<k>" (see jobqueue.h)
+     <shard_dir>/<title>/clips/           clip files of every shard
+     <shard_dir>/<title>/shard-<k>.json   manifest: the clips shard k built
+
+   Shard k holds the clips i with i % shards == k, so every shard gets a
+   spread of the movie. Once every shard is done (or given up) the
+   coordinator concatenates the clips the manifests list, in plan order, and
+   removes the job. */
+
+static cJSON *read_json_file(const char *path) {
+  FileView view;
+  if (!file_view_open(&view, path)) return NULL;
+  cJSON *root = cJSON_ParseWithLength(view.data, view.len);
+  file_view_close(&view);
+  return root;
+}
+
+static bool write_shard_manifest(const char *root, size_t shard, const bool *ok, const double *secs,
+                                 size_t n, size_t shards) {
+  JsonWriter w;
+  jw_init(&w, 256);
+  jw_object_begin(&w);
+  jw_key(&w, "shard");
+  jw_int(&w, (long long)shard);
+  jw_key(&w, "node");
+  jw_string(&w, g_node);
+  jw_key(&w, "clips");
+  jw_array_begin(&w);
+  for (size_t i = shard; i < n; i += shards) {
+    if (!ok[i]) continue;
+    jw_object_begin(&w);
+    jw_key(&w, "clip");
+    jw_int(&w, (long long)(i + 1));
+    jw_key(&w, "seconds");
+    jw_double(&w, secs[i]);
+    jw_object_end(&w);
+  }
+  jw_array_end(&w);
+  jw_object_end(&w);
+  size_t len = 0;
+  char *json = jw_take(&w, &len);
+  bool wrote = write_file_atomic(arena_sprintf(g_movie_arena, "%s/shard-%zu.json", root, shard), json, len);
+  free(json);
+  return wrote;
+}
+
+/* Merges every manifest into ok[]/secs[]; a listed clip counts only if its
+   file is there. Returns the clips found. */
+static size_t read_shard_manifests(const char *root, const char *movie_title, size_t shards,
+                                   bool *ok, double *secs, size_t n) {
+  memset(ok, 0, n * sizeof(bool));
+  memset(secs, 0, n * sizeof(double));
+  size_t made = 0;
+  for (size_t k = 0; k < shards; k++) {
+    cJSON *m = read_json_file(arena_sprintf(g_movie_arena, "%s/shard-%zu.json", root, k));
+    if (!m) {
+      logw("No manifest for shard %zu of %s; its clips are left out", k + 1, movie_title);
+      continue;
+    }
+    cJSON *clips = cJSON_GetObjectItemCaseSensitive(m, "clips");
+    int count = cJSON_IsArray(clips) ? cJSON_GetArraySize(clips) : 0;
+    for (int j = 0; j < count; j++) {
+      cJSON *c = cJSON_GetArrayItem(clips, j);
+      cJSON *idx = cJSON_GetObjectItemCaseSensitive(c, "clip");
+      cJSON *s = cJSON_GetObjectItemCaseSensitive(c, "seconds");
+      if (!cJSON_IsNumber(idx) || idx->valueint < 1 || (size_t)idx->valueint > n) continue;
+      size_t i = (size_t)idx->valueint - 1;
+      if (ok[i]) continue;
+      const char *clip = arena_sprintf(g_movie_arena, "%s/clips/%s_clip_%zu", root, movie_title, i + 1);
+      if (!file_exists(arena_sprintf(g_movie_arena, "%s.mp4", clip)) ||
+          !file_exists(arena_sprintf(g_movie_arena, "%s.mp3", clip))) {
+        logw("Shard %zu lists clip %zu of %s but the file is missing", k + 1, i + 1, movie_title);
+        continue;
+      }
+      ok[i] = true;
+      secs[i] = cJSON_IsNumber(s) ? s->valuedouble : 0.0;
+      made++;
     }
-    fclose(bgml);
+    cJSON_Delete(m);
+  }
+  return made;
+}
 
-    logok("BGM parts created: %d (covered %.2fs / %.2fs)", part, covered, final_dur);
+/* Moves the clips built into clips/, unbuilt where a move fails. Returns
+   the clips moved. */
+static size_t publish_shard_clips(const char *from, const char *to, const char *movie_title,
+                                  const ClipPlanList *plan, bool *ok) {
+  size_t moved = 0;
+  for (size_t i = 0; i < plan->count; i++) {
+    if (!ok[i]) continue;
+    const char *src = arena_sprintf(g_movie_arena, "%s/%s_clip_%zu", from, movie_title, i + 1);
+    const char *dst = arena_sprintf(g_movie_arena, "%s/%s_clip_%zu", to, movie_title, i + 1);
+    ok[i] = publish_file(arena_sprintf(g_movie_arena, "%s.mp3", src), arena_sprintf(g_movie_arena, "%s.mp3", dst)) &&
+            publish_file(arena_sprintf(g_movie_arena, "%s.mp4", src), arena_sprintf(g_movie_arena, "%s.mp4", dst));
+    if (ok[i]) moved++;
+    else logw("Could not move clip %zu of %s into %s/", i + 1, movie_title, to);
+  }
+  return moved;
+}
 
-    char bgm_out[PATH_MAX];
-    snprintf(bgm_out, sizeof(bgm_out), "clips/%s_bgm.m4a", movie_title);
+/* Builds a claimed shard and settles its claim. Clips that fail are simply
+   missing from the manifest, as they would be from a single-process render;
+   a cancelled run, or a shard another worker has taken over, is handed back.
+   The clips are encoded under a name of this process and moved into clips/
+   only while the shard is still ours, so a worker that lost it never writes
+   over the clips of the one that took over. True if the shard was completed;
+   *made receives its clips. */
+static bool build_shard(const Config *cfg, JobQueue *jq, const char *root, const char *movie_path,
+                        const char *movie_title, const ClipPlanList *plan, size_t shard,
+                        size_t shards, size_t *made) {
+  char name[32];
+  snprintf(name, sizeof(name), "shard-%zu", shard);
+  bool *ok = (bool *)arena_alloc(g_movie_arena, plan->count * sizeof(bool));
+  double *secs = (double *)arena_alloc(g_movie_arena, plan->count * sizeof(double));
+  const char *parts = arena_sprintf(g_movie_arena, "%s/parts/%s.%s-%d", root, name, g_node, (int)getpid());
+  ClipSet set = { parts, shard, shards };
+  Lease lease = { jq, name, t_lease };
+  t_lease = &lease;
+
+  logi("Building shard %zu/%zu of %s", shard + 1, shards, movie_title);
+  rm_rf_path(parts);
+  *made = build_clips(cfg, movie_path, movie_title, plan, &set, ok, secs);
+  if (!movie_stopped()) *made = publish_shard_clips(parts, arena_sprintf(g_movie_arena, "%s/clips", root),
+                                                    movie_title, plan, ok);
+  rm_rf_path(parts);
+
+  bool done = false;
+  if (movie_stopped()) {
+    if (!runctl_cancelled()) logw("Shard %zu/%zu of %s was taken over by another worker", shard + 1, shards, movie_title);
+    jobq_release(jq, name);
+  } else if (!write_shard_manifest(root, shard, ok, secs, plan->count, shards)) {
+    logw("Could not write the manifest of shard %zu of %s", shard + 1, movie_title);
+    jobq_fail(jq, name, "manifest");
+  } else {
+    logok("Shard %zu/%zu of %s: %zu clip(s)", shard + 1, shards, movie_title, *made);
+    jobq_complete(jq, name, "");
+    done = true;
+  }
+  if (!done) *made = 0;
 
-    logi("Concatenating BGM -> %s", bgm_out);
-    if (!ffmpeg_concat_audio(bgm_list, bgm_out)) {
-      logw("BGM concat failed; output narration-only.");
-      char out_final_only[PATH_MAX];
-      snprintf(out_final_only, sizeof(out_final_only), "output/%s.mp4", movie_title);
-      rename(tmp_concat, out_final_only);
-      logok("Wrote output (no BGM): %s", out_final_only);
-    } else {
-      logok("BGM concat OK: %s", bgm_out);
+  /* Losing the shard is not losing the title. */
+  t_lease = lease.outer;
+  t_lost = false;
+  lease_lost();
+  return done;
+}
 
-      char out_final_only[PATH_MAX];
-      snprintf(out_final_only, sizeof(out_final_only), "output/%s.mp4", movie_title);
+static bool write_shard_job(const char *root, const char *movie_path, const char *movie_title,
+                            const ClipPlanList *plan, size_t shards) {
+  ClipPlanInfo info = {0};
+  snprintf(info.title, sizeof(info.title), "%s", movie_title);
+  const char *base = strrchr(movie_path, '/');
+  snprintf(info.source, sizeof(info.source), "%s", base ? base + 1 : movie_path);
+  info.source_seconds = ffprobe_duration_seconds(movie_path);
+
+  size_t len = 0;
+  char *json = clip_plan_to_json(plan, &info, &len);
+  bool ok = write_file_atomic(arena_sprintf(g_movie_arena, "%s/plan.json", root), json, len);
+  free(json);
+  if (!ok) return false;
+
+  JsonWriter w;
+  jw_init(&w, 256);
+  jw_object_begin(&w);
+  jw_key(&w, "title");
+  jw_string(&w, movie_title);
+  jw_key(&w, "source");
+  jw_string(&w, info.source);
+  jw_key(&w, "shards");
+  jw_int(&w, (long long)shards);
+  jw_object_end(&w);
+  json = jw_take(&w, &len);
+  ok = write_file_atomic(arena_sprintf(g_movie_arena, "%s/job.json", root), json, len);
+  free(json);
+  return ok;
+}
 
-      logi("Mixing narration + BGM -> %s", out_final_only);
-      if (!ffmpeg_mix_bgm(tmp_concat, bgm_out, out_final_only)) {
-        logw("Mix failed; output narration-only.");
-        rename(tmp_concat, out_final_only);
-      } else {
-        unlink(tmp_concat);
+/* Coordinator: rendering half with the clip encodes spread over every
+   process that runs --shard-worker on shard_dir. Consumes the plan. */
+static bool render_sharded(const Config *cfg, const char *movie_path, const char *movie_title,
+                           ClipPlanList plan, MovieReport *rep) {
+  ensure_output_dirs();
+  size_t n = plan.count;
+  size_t shards = (size_t)g_opt.shards < n ? (size_t)g_opt.shards : n;
+  atomic_store(&g_run_clips_planned, (int)n);
+
+  /* Leftovers of an interrupted attempt belong to a plan that is gone. */
+  const char *root = arena_sprintf(g_movie_arena, "%s/%s", g_opt.shard_dir, movie_title);
+  rm_rf_path(root);
+  ensure_dir(g_opt.shard_dir);
+  ensure_dir(root);
+  ensure_dir(arena_sprintf(g_movie_arena, "%s/clips", root));
+  JobQueue *jq = jobq_open(arena_sprintf(g_movie_arena, "%s/queue", root), g_node,
+                           g_opt.lease_seconds, g_opt.max_attempts);
+  if (!jq || !write_shard_job(root, movie_path, movie_title, &plan, shards)) {
+    logw("Could not publish the shard job for %s in %s/", movie_title, g_opt.shard_dir);
+    snprintf(rep->detail, sizeof(rep->detail), "shard job");
+    if (jq) jobq_close(jq);
+    free_clip_plan_list(&plan);
+    rm_rf_path(root);
+    return false;
+  }
+  logi("Sharding %s: %zu clips in %zu shards under %s/", movie_title, n, shards, root);
+
+  /* Take whatever shard is open; wait while others hold the rest. */
+  bool waiting = false;
+  for (;;) {
+    size_t settled = 0, built = 0;
+    for (size_t k = 0; k < shards && movie_checkpoint(); k++) {
+      char name[32];
+      snprintf(name, sizeof(name), "shard-%zu", k);
+      JobClaim c = jobq_claim(jq, name, NULL, 0);
+      if (c == JOB_CLAIMED) {
+        size_t made;
+        build_shard(cfg, jq, root, movie_path, movie_title, &plan, k, shards, &made);
+        built++;
+      } else if (c != JOB_HELD) {
+        settled++;
       }
-      logok("Wrote output: %s", out_final_only);
     }
+    if (settled == shards || movie_stopped()) break;
+    if (built) continue;
+    if (!waiting) logi("Waiting for %zu shard(s) of %s on other workers", shards - settled, movie_title);
+    waiting = true;
+    if (!runctl_sleep(1.0)) break;
+  }
+  jobq_close(jq);
+  free_clip_plan_list(&plan);
 
-    free_str_list(songs, song_n);
+  bool ok = false;
+  if (!movie_stopped()) {
+    bool *have = (bool *)arena_alloc(g_movie_arena, n * sizeof(bool));
+    double *secs = (double *)arena_alloc(g_movie_arena, n * sizeof(double));
+    size_t made = read_shard_manifests(root, movie_title, shards, have, secs, n);
+    ok = finish_movie(movie_path, movie_title, arena_sprintf(g_movie_arena, "%s/clips", root),
+                      have, secs, n, made, rep);
   }
+  rm_rf_path(root);
+  return ok;
+}
 
-  char out_final[PATH_MAX], out_vert[PATH_MAX];
-  snprintf(out_final, sizeof(out_final), "output/%s.mp4", movie_title);
-  snprintf(out_vert,  sizeof(out_vert),  "tiktok_output/%s_vertical.mp4", movie_title);
+/* Shard worker: builds whatever shards of the job are open. The source is
+   this process's own copy in movies_dir. */
+static bool shard_worker_movie(const Config *cfg, const char *movie_title, MovieReport *rep) {
+  const char *root = arena_sprintf(g_movie_arena, "%s/%s", g_opt.shard_dir, movie_title);
+  cJSON *job = read_json_file(arena_sprintf(g_movie_arena, "%s/job.json", root));
+  cJSON *src = job ? cJSON_GetObjectItemCaseSensitive(job, "source") : NULL;
+  cJSON *sh = job ? cJSON_GetObjectItemCaseSensitive(job, "shards") : NULL;
+  if (!cJSON_IsString(src) || !cJSON_IsNumber(sh) || sh->valueint < 1) {
+    cJSON_Delete(job);
+    snprintf(rep->detail, sizeof(rep->detail), "job gone");
+    rep->skipped = true;
+    return false;
+  }
+  const char *movie_path = arena_sprintf(g_movie_arena, "%s/%s", g_opt.movies_dir, src->valuestring);
+  size_t shards = (size_t)sh->valueint;
+  cJSON_Delete(job);
+  if (!file_exists(movie_path)) {
+    logw("Shard job %s needs %s, which this worker does not have", movie_title, movie_path);
+    snprintf(rep->detail, sizeof(rep->detail), "source missing");
+    return false;
+  }
 
-  logi("Rendering vertical -> %s", out_vert);
-  if (!ffmpeg_make_vertical(out_final, out_vert)) {
-    logw("Vertical render failed for %s", movie_title);
-  } else {
-    logok("Vertical render OK: %s", out_vert);
+  enter_stage(STAGE_PLAN);
+  FileView view;
+  ClipPlanInfo info;
+  ClipPlanList plan = {0};
+  char err[160] = "unreadable";
+  bool loaded = file_view_open(&view, arena_sprintf(g_movie_arena, "%s/plan.json", root));
+  if (loaded) {
+    loaded = clip_plan_from_json(g_movie_arena, view.data, view.len, &info, &plan, err, sizeof(err));
+    file_view_close(&view);
+  }
+  if (!loaded) {
+    snprintf(rep->detail, sizeof(rep->detail), "plan: %s", err);
+    return false;
   }
+  rep->clips_planned = (int)plan.count;
+  atomic_store(&g_run_clips_planned, (int)plan.count);
 
-  char retired[PATH_MAX];
-  snprintf(retired, sizeof(retired), "movies_retired/%s.mp4", movie_title);
-  rename(movie_path, retired);
-  logok("Retired source movie -> %s", retired);
+  JobQueue *jq = jobq_open(arena_sprintf(g_movie_arena, "%s/queue", root), g_node,
+                           g_opt.lease_seconds, g_opt.max_attempts);
+  if (!jq) {
+    free_clip_plan_list(&plan);
+    snprintf(rep->detail, sizeof(rep->detail), "job gone");
+    rep->skipped = true;
+    return false;
+  }
+  size_t taken = 0, made = 0;
+  for (size_t k = 0; k < shards && movie_checkpoint(); k++) {
+    char name[32];
+    snprintf(name, sizeof(name), "shard-%zu", k);
+    if (jobq_claim(jq, name, NULL, 0) != JOB_CLAIMED) continue;
+    size_t n;
+    if (build_shard(cfg, jq, root, movie_path, movie_title, &plan, k, shards, &n)) taken++;
+    made += n;
+  }
+  jobq_close(jq);
+  free_clip_plan_list(&plan);
+
+  rep->clips_built = (int)made;
+  if (taken == 0) {
+    snprintf(rep->detail, sizeof(rep->detail), "no open shards");
+    rep->skipped = true;
+    return false;
+  }
+  snprintf(rep->detail, sizeof(rep->detail), "%zu of %zu shards", taken, shards);
+  return !movie_stopped();
+}
+
+static bool render_plan(const Config *cfg, const char *movie_path, const char *movie_title,
+                        ClipPlanList plan, MovieReport *rep) {
+  if (g_opt.shards > 1 && plan.count > 1) return render_sharded(cfg, movie_path, movie_title, plan, rep);
+  return render_movie(cfg, movie_path, movie_title, plan, rep);
+}
+
+static bool process_movie(const Config *cfg, const char *movie_path, const char *movie_title,
+                          int num_clips, MovieReport *rep) {
+  ClipPlanList plan;
+  if (g_opt.mode == GENERATOR_MODE_RENDER_ONLY) {
+    if (!load_plan_file(movie_path, movie_title, &plan, rep)) return false;
+    rep->clips_planned = (int)plan.count;
+    return render_plan(cfg, movie_path, movie_title, plan, rep);
+  }
+
+  plan = plan_movie(cfg, movie_title, num_clips);
+  if (plan.count == 0) return false;
+  rep->clips_planned = (int)plan.count;
+
+  /* Rendering runs keep the plan too, so an edited copy can be re-rendered
+     with --render-only without asking the LLM again. */
+  char plan_path[PATH_MAX];
+  bool wrote = write_plan_file(&plan, movie_path, movie_title, plan_path, sizeof(plan_path));
+  if (g_opt.mode == GENERATOR_MODE_PLAN_ONLY) {
+    free_clip_plan_list(&plan);
+    if (!wrote) return false;
+    snprintf(rep->detail, sizeof(rep->detail), "%s", plan_path);
+    rep->planned_only = true;
+    return true;
+  }
+  if (!movie_checkpoint()) {
+    free_clip_plan_list(&plan);
+    return false;
+  }
+  return render_plan(cfg, movie_path, movie_title, plan, rep);
+}
 
+/* Skipped unless forced: rendering runs skip titles whose outputs exist
+   (the horizontal one alone when it is selected), plan-only runs skip titles
+   that already have a plan file. */
+static bool title_is_done(const char *movie_title) {
+  char a[PATH_MAX], b[PATH_MAX], c[PATH_MAX];
+  if (g_opt.mode == GENERATOR_MODE_PLAN_ONLY) {
+    plan_file_path(movie_title, a, sizeof(a));
+    return file_exists(a);
+  }
+
+  output_paths(movie_title, a, b, c);
+  if (g_opt.outputs & GENERATOR_OUT_HORIZONTAL) return file_exists(a);
+  if ((g_opt.outputs & GENERATOR_OUT_VERTICAL) && !file_exists(b)) return false;
+  if ((g_opt.outputs & GENERATOR_OUT_PREVIEW) && !file_exists(c)) return false;
   return true;
 }
 
-static bool output_already_exists(const char *movie_title) {
-  char out[PATH_MAX];
-  snprintf(out, sizeof(out), "output/%s.mp4", movie_title);
-  return file_exists(out);
+/* Why the title is not worked on in this run, or NULL. Render-only runs
+   leave titles without a plan for a later pass (the plan may still be on its
+   way from the planning machine). */
+static const char *title_skip_reason(const char *movie_title) {
+  if (g_opt.mode == GENERATOR_MODE_RENDER_ONLY) {
+    char plan[PATH_MAX];
+    plan_file_path(movie_title, plan, sizeof(plan));
+    if (!file_exists(plan)) return "no plan";
+  }
+  if (g_opt.force || !title_is_done(movie_title)) return NULL;
+  return g_opt.mode == GENERATOR_MODE_PLAN_ONLY ? "plan exists" : "outputs exist";
 }
 
 static void strip_ext(const char *filename, char *out, size_t outsz) {
@@ -1986,39 +2712,64 @@ static void strip_ext(const char *filename, char *out, size_t outsz) {
   if (dot) *dot = 0;
 }
 
-/* -------------------------- PUBLIC ENTRYPOINT -------------------------- */
-int run_generation(void) {
-  curl_global_init(CURL_GLOBAL_DEFAULT);
-
-  Config cfg = load_config_json("config.json");
-
-  ensure_dir("movies");
-  ensure_dir("output");
-  ensure_dir("backgroundmusic");
-  ensure_dir("clips");
-  ensure_dir("scripts");
-  ensure_dir("scripts/srt_files");
-  ensure_dir("tiktok_output");
-  ensure_dir("movies_retired");
+/* ------------------------ Title selection ------------------------ */
+
+/* '*' matches any run of characters, '?' any single one. */
+static bool glob_match(const char *pat, const char *s) {
+  const char *star = NULL, *resume = NULL;
+  while (*s) {
+    if (*pat == '*') {
+      star = pat++;
+      resume = s;
+    } else if (*pat == '?' || *pat == *s) {
+      pat++;
+      s++;
+    } else if (star) {
+      pat = star + 1;
+      s = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (*pat == '*') pat++;
+  return *pat == 0;
+}
 
-  logi("Clearing clips/ folder...");
-  if (!clear_directory_contents("clips")) {
-    logw("Failed to fully clear clips/ (continuing anyway).");
-  } else {
-    logok("Cleared clips/ folder.");
+/* A pattern may name the title or the file (with its extension). */
+static bool title_selected(const char *title, const char *file, bool *matched) {
+  if (g_opt.select_count <= 0) return true;
+  bool any = false;
+  for (int i = 0; i < g_opt.select_count; i++) {
+    const char *pat = g_opt.select[i];
+    if (pat && (glob_match(pat, title) || glob_match(pat, file))) {
+      matched[i] = true;
+      any = true;
+    }
   }
+  return any;
+}
 
-  ensure_dir("clips");
-  ensure_dir("clips/audio");
+typedef struct {
+  char *title;
+  char *file;           /* name in movies_dir, extension as found */
+} MovieEntry;
 
-  srand((unsigned)time(NULL));
-  int num_clips = MIN_NUM_CLIPS + (rand() % (MAX_NUM_CLIPS - MIN_NUM_CLIPS + 1));
+static int movie_entry_cmp(const void *a, const void *b) {
+  return strcmp(((const MovieEntry *)a)->title, ((const MovieEntry *)b)->title);
+}
+
+/* Selected .mp4 files of movies_dir in title order; the list lives in a. */
+static MovieEntry *list_selected_movies(Arena *a, size_t *out_n) {
+  *out_n = 0;
+  DIR *d = opendir(g_opt.movies_dir);
+  if (!d) die("Failed to open %s/", g_opt.movies_dir);
 
-  DIR *d = opendir("movies");
-  if (!d) die("Failed to open movies/");
+  bool *matched = (bool *)arena_alloc(a, (size_t)(g_opt.select_count > 0 ? g_opt.select_count : 1));
+  memset(matched, 0, (size_t)(g_opt.select_count > 0 ? g_opt.select_count : 1));
 
+  MovieEntry *arr = NULL;
+  size_t cap = 0;
   struct dirent *ent;
-  int processed = 0;
   while ((ent = readdir(d))) {
     if (ent->d_name[0] == '.') continue;
     size_t ln = strlen(ent->d_name);
@@ -2027,27 +2778,509 @@ int run_generation(void) {
 
     char title[PATH_MAX];
     strip_ext(ent->d_name, title, sizeof(title));
+    if (!title_selected(title, ent->d_name, matched)) continue;
 
-    if (output_already_exists(title)) {
-      logi("Skipping %s (already in output/)", title);
-      continue;
+    if (*out_n + 1 > cap) {
+      size_t ncap = cap ? cap * 2 : 16;
+      MovieEntry *grown = (MovieEntry *)arena_alloc(a, ncap * sizeof(MovieEntry));
+      if (arr) memcpy(grown, arr, *out_n * sizeof(MovieEntry));
+      arr = grown;
+      cap = ncap;
     }
+    arr[*out_n].title = arena_strdup(a, title);
+    arr[*out_n].file = arena_strdup(a, ent->d_name);
+    (*out_n)++;
+  }
+  closedir(d);
 
-    char path[PATH_MAX];
-    snprintf(path, sizeof(path), "movies/%s", ent->d_name);
+  for (int i = 0; i < g_opt.select_count; i++) {
+    if (!matched[i]) logw("No movie in %s/ matches \"%s\"", g_opt.movies_dir, g_opt.select[i]);
+  }
+  if (*out_n > 1) qsort(arr, *out_n, sizeof(MovieEntry), movie_entry_cmp);
+  return arr;
+}
 
-    fprintf(stderr, "\n=== Processing: %s ===\n", title);
-    if (process_movie(&cfg, path, title, num_clips)) {
-      processed++;
-      fprintf(stderr, "DONE: %s\n", title);
-    } else {
-      fprintf(stderr, "FAILED: %s\n", title);
+/* Shard worker runs: the published jobs of shard_dir (subdirectories with a
+   job.json), selected by title like movies. */
+static MovieEntry *list_shard_jobs(Arena *a, size_t *out_n) {
+  *out_n = 0;
+  ensure_dir(g_opt.shard_dir);
+  DIR *d = opendir(g_opt.shard_dir);
+  if (!d) die("Failed to open %s/", g_opt.shard_dir);
+
+  bool *matched = (bool *)arena_alloc(a, (size_t)(g_opt.select_count > 0 ? g_opt.select_count : 1));
+  memset(matched, 0, (size_t)(g_opt.select_count > 0 ? g_opt.select_count : 1));
+
+  MovieEntry *arr = NULL;
+  size_t cap = 0;
+  struct dirent *ent;
+  while ((ent = readdir(d))) {
+    if (ent->d_name[0] == '.') continue;
+    char job[PATH_MAX];
+    snprintf(job, sizeof(job), "%s/%s/job.json", g_opt.shard_dir, ent->d_name);
+    if (!file_exists(job)) continue;
+    if (!title_selected(ent->d_name, ent->d_name, matched)) continue;
+
+    if (*out_n + 1 > cap) {
+      size_t ncap = cap ? cap * 2 : 16;
+      MovieEntry *grown = (MovieEntry *)arena_alloc(a, ncap * sizeof(MovieEntry));
+      if (arr) memcpy(grown, arr, *out_n * sizeof(MovieEntry));
+      arr = grown;
+      cap = ncap;
     }
+    arr[*out_n].title = arena_strdup(a, ent->d_name);
+    arr[*out_n].file = arena_strdup(a, ent->d_name);
+    (*out_n)++;
   }
-
   closedir(d);
-  fprintf(stderr, "\nAll done. Processed: %d\n", processed);
 
+  for (int i = 0; i < g_opt.select_count; i++) {
+    if (!matched[i]) logw("No shard job in %s/ matches \"%s\"", g_opt.shard_dir, g_opt.select[i]);
+  }
+  if (*out_n > 1) qsort(arr, *out_n, sizeof(MovieEntry), movie_entry_cmp);
+  return arr;
+}
+
+/* ------------------------ Workers ------------------------ */
+
+/* Selected titles of one run; workers claim them in order. */
+typedef struct {
+  const Config *cfg;
+  MovieEntry *movies;
+  size_t count;
+  atomic_size_t next;
+  int num_clips;
+  atomic_int reached;   /* titles that reached the goal of the run */
+} MovieQueue;
+
+static void report_title(const char *title, GeneratorTitleStatus st, double seconds,
+                         const MovieReport *rep) {
+  GeneratorTitleHook hook = g_title_hook;
+  if (!hook) return;
+  GeneratorTitleResult r = {
+    .title = title,
+    .status = st,
+    .seconds = seconds,
+    .clips_planned = rep ? rep->clips_planned : 0,
+    .clips_built = rep ? rep->clips_built : 0,
+    .detail = rep ? rep->detail : "",
+  };
+  hook(&r);
+}
+
+/* Dry run: what a rendering (or plan-only) run would do with the title. */
+static void dry_run_title(MovieQueue *q, const MovieEntry *m) {
+  MovieReport rep = {0};
+  char srt[PATH_MAX];
+  snprintf(srt, sizeof(srt), "%s/%s.srt", g_srt_dir, m->title);
+
+  const char *skip = title_skip_reason(m->title);
+  if (skip) {
+    snprintf(rep.detail, sizeof(rep.detail), "%s", skip);
+    logi("Would skip %s (%s)", m->title, rep.detail);
+    report_title(m->title, GENERATOR_TITLE_SKIPPED, 0.0, &rep);
+  } else {
+    char plan[PATH_MAX];
+    plan_file_path(m->title, plan, sizeof(plan));
+    snprintf(rep.detail, sizeof(rep.detail), "%s",
+             file_exists(plan) ? "plan ready" : file_exists(srt) ? "subtitles cached" : "subtitles to download");
+    logi("Would process %s (%s)", m->title, rep.detail);
+    report_title(m->title, GENERATOR_TITLE_PENDING, 0.0, &rep);
+    atomic_fetch_add(&q->reached, 1);
+  }
+  atomic_fetch_add(&g_run_finished, 1);
+}
+
+/* Queue mode: true if this process now owns the title; otherwise the title
+   has been reported and counted. */
+static bool claim_title(const char *title) {
+  char info[256];
+  JobClaim c = jobq_claim(g_jobs, title, info, sizeof(info));
+  if (c == JOB_CLAIMED) return true;
+
+  MovieReport rep = {0};
+  GeneratorTitleStatus st = GENERATOR_TITLE_SKIPPED;
+  switch (c) {
+    case JOB_DONE:    snprintf(rep.detail, sizeof(rep.detail), "done by another worker"); break;
+    case JOB_HELD:    snprintf(rep.detail, sizeof(rep.detail), "claimed by %s", info); break;
+    case JOB_GAVE_UP: snprintf(rep.detail, sizeof(rep.detail), "gave up after %s attempts", info); break;
+    default:
+      st = GENERATOR_TITLE_FAILED;
+      snprintf(rep.detail, sizeof(rep.detail), "job queue");
+  }
+  logi("Skipping %s (%s)", title, rep.detail);
+  if (st == GENERATOR_TITLE_FAILED) metrics_inc(METRIC_MOVIES_FAILED, 1);
+  report_title(title, st, 0.0, &rep);
+  atomic_fetch_add(&g_run_finished, 1);
+  return false;
+}
+
+static void process_title(MovieQueue *q, const MovieEntry *m) {
+  metrics_gauge_add(METRIC_QUEUE_MOVIES, -1);
+
+  if (g_opt.mode == GENERATOR_MODE_DRY_RUN) {
+    dry_run_title(q, m);
+    return;
+  }
+
+  const char *skip = g_opt.mode == GENERATOR_MODE_SHARD_WORKER ? NULL : title_skip_reason(m->title);
+  if (skip) {
+    MovieReport rep = {0};
+    snprintf(rep.detail, sizeof(rep.detail), "%s", skip);
+    logi("Skipping %s (%s)", m->title, rep.detail);
+    report_title(m->title, GENERATOR_TITLE_SKIPPED, 0.0, &rep);
+    atomic_fetch_add(&g_run_finished, 1);
+    return;
+  }
+
+  if (g_jobs && !claim_title(m->title)) return;
+
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s", g_opt.movies_dir, m->file);
+
+  fprintf(stderr, "\n=== Processing: %s ===\n", m->title);
+  set_run_movie(m->title);
+  metrics_gauge_add(METRIC_ACTIVE_WORKERS, 1);
+  double t_movie = metrics_now();
+  MovieReport rep = {0};
+  t_stage = NULL;
+  Lease title_lease = { g_jobs, m->title, NULL };
+  t_lease = g_jobs ? &title_lease : NULL;
+  t_lost = false;
+  Arena *prev_arena = arena_bind(g_movie_arena);
+  bool ok = g_opt.mode == GENERATOR_MODE_SHARD_WORKER
+          ? shard_worker_movie(q->cfg, m->title, &rep)
+          : process_movie(q->cfg, path, m->title, q->num_clips, &rep);
+  log_set_stage(NULL);
+  arena_bind(prev_arena);
+  arena_reset(g_movie_arena);
+  double seconds = metrics_now() - t_movie;
+  metrics_observe_stage(STAGE_MOVIE, seconds);
+  metrics_gauge_add(METRIC_ACTIVE_WORKERS, -1);
+  clear_run_movie(m->title);
+  atomic_fetch_add(&g_run_finished, 1);
+
+  /* A title taken over is the new owner's to finish or fail; we only let go. */
+  bool lost = lease_lost();
+  t_lease = NULL;
+  t_lost = false;
+  if (g_jobs) {
+    if (lost) jobq_release(g_jobs, m->title);
+    else if (ok) jobq_complete(g_jobs, m->title, rep.detail);
+    else if (runctl_cancelled()) jobq_release(g_jobs, m->title);
+    else jobq_fail(g_jobs, m->title, rep.detail[0] ? rep.detail : (t_stage ? t_stage : "subtitles"));
+  }
+
+  if (lost) logw("%s was taken over by another worker while we ran; leaving it to them", m->title);
+  if (ok) {
+    atomic_fetch_add(&q->reached, 1);
+    atomic_fetch_add(&g_run_done, 1);
+    metrics_inc(METRIC_MOVIES_PROCESSED, 1);
+    fprintf(stderr, "DONE: %s\n", m->title);
+    report_title(m->title, rep.planned_only ? GENERATOR_TITLE_PLANNED : GENERATOR_TITLE_DONE,
+                 seconds, &rep);
+  } else if (lost) {
+    snprintf(rep.detail, sizeof(rep.detail), "taken over by another worker");
+    report_title(m->title, GENERATOR_TITLE_SKIPPED, seconds, &rep);
+  } else if (rep.skipped) {
+    logi("Skipping %s (%s)", m->title, rep.detail);
+    report_title(m->title, GENERATOR_TITLE_SKIPPED, seconds, &rep);
+  } else if (runctl_cancelled()) {
+    logw("Cancelled: %s (nothing was written to %s/)", m->title, g_opt.output_dir);
+    report_title(m->title, GENERATOR_TITLE_CANCELLED, seconds, &rep);
+  } else {
+    metrics_inc(METRIC_MOVIES_FAILED, 1);
+    fprintf(stderr, "FAILED: %s\n", m->title);
+    if (!rep.detail[0]) snprintf(rep.detail, sizeof(rep.detail), "%s", t_stage ? t_stage : "subtitles");
+    report_title(m->title, GENERATOR_TITLE_FAILED, seconds, &rep);
+  }
+}
+
+static void movie_worker(MovieQueue *q) {
+  g_movie_arena = arena_new(1u << 20);
+  while (runctl_checkpoint()) {
+    size_t i = atomic_fetch_add(&q->next, 1);
+    if (i >= q->count) break;
+    process_title(q, &q->movies[i]);
+  }
+  arena_free(g_movie_arena);
+  g_movie_arena = NULL;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI movie_worker_thread(LPVOID p) {
+  movie_worker((MovieQueue *)p);
+  return 0;
+}
+#else
+static void *movie_worker_thread(void *p) {
+  movie_worker((MovieQueue *)p);
+  return NULL;
+}
+#endif
+
+/* The calling thread is worker 0; the others get threads of their own. */
+static void run_workers(MovieQueue *q, int workers) {
+#if defined(_WIN32)
+  HANDLE th[MAX_WORKERS];
+#else
+  pthread_t th[MAX_WORKERS];
+#endif
+  int started = 0;
+  if ((size_t)workers > q->count) workers = q->count > 0 ? (int)q->count : 1;
+  for (int i = 1; i < workers; i++) {
+#if defined(_WIN32)
+    th[started] = CreateThread(NULL, 0, movie_worker_thread, q, 0, NULL);
+    if (th[started] == NULL) break;
+#else
+    if (pthread_create(&th[started], NULL, movie_worker_thread, q) != 0) break;
+#endif
+    started++;
+  }
+  if (started + 1 < workers) logw("Started %d of %d workers", started + 1, workers);
+
+  movie_worker(q);
+
+  for (int i = 0; i < started; i++) {
+#if defined(_WIN32)
+    WaitForSingleObject(th[i], INFINITE);
+    CloseHandle(th[i]);
+#else
+    pthread_join(th[i], NULL);
+#endif
+  }
+}
+
+/* -------------------------- PUBLIC ENTRYPOINT -------------------------- */
+int run_generation(void) {
+  return run_generation_with(NULL);
+}
+
+int run_generation_with(const GeneratorOptions *opts) {
+  atomic_store(&g_run_state, GENERATOR_RUNNING);
+  atomic_store(&g_run_done, 0);
+  atomic_store(&g_run_finished, 0);
+  atomic_store(&g_run_queued, 0);
+  set_run_movie("");
+  run_movie_lock();
+  g_run_started = metrics_now();
+  run_movie_unlock();
+
+  resolve_options(opts);
+  bool dry = g_opt.mode == GENERATOR_MODE_DRY_RUN;
+  bool plans = g_opt.mode == GENERATOR_MODE_RENDER || g_opt.mode == GENERATOR_MODE_PLAN_ONLY;
+  bool render = g_opt.mode == GENERATOR_MODE_RENDER || g_opt.mode == GENERATOR_MODE_RENDER_ONLY ||
+                g_opt.mode == GENERATOR_MODE_SHARD_WORKER;
+  bool shared = (g_opt.jobs_dir && g_opt.jobs_dir[0]) || g_opt.mode == GENERATOR_MODE_SHARD_WORKER ||
+                (g_opt.shards > 1 && render);
+
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  arena_install_cjson_hooks();
+
+  Config cfg = {0};
+  if (!dry) cfg = load_config_json(g_opt.config_path, plans, render);
+
+  Arena *run_arena = arena_new(1u << 16);
+  if (!dry) {
+    ensure_dir(g_opt.movies_dir);
+    ensure_dir(g_opt.music_dir);
+    ensure_dir(g_srt_dir);
+  }
+
+  /* Sharing the queue (or a movie's shards) means sharing movies/, scripts/
+     and the output directories, so what a process writes for itself alone
+     gets its own name: the work directory per process, the mmap'd lookup
+     cache per node (a second process of the same node finds it locked). */
+  jobq_node_name(g_opt.node, g_node, sizeof(g_node));
+  /* A shard worker claims shards, never titles: the coordinator holds the
+     title, and finishing it is the coordinator's call. */
+  if (!dry && g_opt.jobs_dir && g_opt.jobs_dir[0] && g_opt.mode != GENERATOR_MODE_SHARD_WORKER) {
+    g_jobs = jobq_open(g_opt.jobs_dir, g_node, g_opt.lease_seconds, g_opt.max_attempts);
+    if (!g_jobs) die("Cannot use the job directory %s", g_opt.jobs_dir);
+  }
+  if (!dry && shared) {
+    snprintf(g_node_work_dir, sizeof(g_node_work_dir), "%s/%s-%d", g_opt.work_dir, g_node, (int)getpid());
+    g_opt.work_dir = g_node_work_dir;
+    g_lookups = lookup_open(arena_sprintf(run_arena, "%s/lookup_cache.%s.db", g_opt.scripts_dir, g_node));
+  } else if (!dry) {
+    g_lookups = lookup_open(arena_sprintf(run_arena, "%s/lookup_cache.db", g_opt.scripts_dir));
+  }
+
+  /* Plan-only runs leave the work directory alone; a rendering run elsewhere
+     may be using it. */
+  if (render) {
+    logi("Clearing %s/ folder...", g_opt.work_dir);
+    if (!clear_directory_contents(g_opt.work_dir)) {
+      logw("Failed to fully clear %s/ (continuing anyway).", g_opt.work_dir);
+    } else {
+      logok("Cleared %s/ folder.", g_opt.work_dir);
+    }
+    ensure_dir(g_opt.work_dir);
+  }
+
+  srand((unsigned)time(NULL));
+  MovieQueue q = { .cfg = &cfg };
+  q.num_clips = g_opt.num_clips > 0
+              ? g_opt.num_clips
+              : MIN_NUM_CLIPS + (rand() % (MAX_NUM_CLIPS - MIN_NUM_CLIPS + 1));
+  q.movies = g_opt.mode == GENERATOR_MODE_SHARD_WORKER ? list_shard_jobs(run_arena, &q.count)
+                                                      : list_selected_movies(run_arena, &q.count);
+  atomic_init(&q.next, 0);
+  atomic_init(&q.reached, 0);
+  metrics_gauge_set(METRIC_QUEUE_MOVIES, (long long)q.count);
+  atomic_store(&g_run_queued, (int)q.count);
+
+  if (g_opt.workers > 1 && !dry) logi("Processing %zu movie(s) with %d workers", q.count, g_opt.workers);
+  run_workers(&q, dry ? 1 : g_opt.workers);
+
+  /* Titles nobody got to still get a status line. */
+  for (size_t i = atomic_load(&q.next); i < q.count; i++) {
+    MovieReport rep = {0};
+    snprintf(rep.detail, sizeof(rep.detail), "not started");
+    report_title(q.movies[i].title, GENERATOR_TITLE_CANCELLED, 0.0, &rep);
+  }
+
+  int reached = atomic_load(&q.reached);
+  metrics_gauge_set(METRIC_QUEUE_MOVIES, 0);
+  metrics_inc(METRIC_RUNS, 1);
+  if (runctl_cancelled()) fprintf(stderr, "\nCancelled. Processed: %d\n", reached);
+  else fprintf(stderr, "\nAll done. Processed: %d\n", reached);
+
+  if (g_jobs) {
+    jobq_close(g_jobs);
+    g_jobs = NULL;
+  }
+  if (!dry && shared) rm_rf_path(g_node_work_dir);
+  lookup_close(g_lookups);
+  g_lookups = NULL;
+  arena_free(run_arena);
   curl_global_cleanup();
-  return processed; /* 0 is also a valid “nothing to do” result */
+
+  atomic_store(&g_run_result, reached);
+  atomic_store(&g_run_state, runctl_cancelled() ? GENERATOR_CANCELLED : GENERATOR_FINISHED);
+  return reached; /* 0 is also a valid “nothing to do” result */
+}
+
+/* ------------------------ Background runs ------------------------ */
+
+struct Generator {
+#if defined(_WIN32)
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+  bool joined;
+  int result;
+};
+
+static atomic_bool g_run_active = false;
+
+#if defined(_WIN32)
+static DWORD WINAPI generator_thread(LPVOID p) {
+  ((Generator *)p)->result = run_generation();
+  atomic_store(&g_run_active, false);
+  return 0;
+}
+#else
+static void *generator_thread(void *p) {
+  ((Generator *)p)->result = run_generation();
+  atomic_store(&g_run_active, false);
+  return NULL;
+}
+#endif
+
+Generator *generator_start(void) {
+  if (atomic_exchange(&g_run_active, true)) return NULL;
+
+  Generator *g = (Generator *)calloc(1, sizeof(*g));
+  if (!g) die("OOM");
+  runctl_reset();
+  atomic_store(&g_run_state, GENERATOR_RUNNING);
+
+#if defined(_WIN32)
+  g->thread = CreateThread(NULL, 0, generator_thread, g, 0, NULL);
+  bool started = g->thread != NULL;
+#else
+  bool started = pthread_create(&g->thread, NULL, generator_thread, g) == 0;
+#endif
+  if (!started) {
+    atomic_store(&g_run_state, GENERATOR_IDLE);
+    atomic_store(&g_run_active, false);
+    free(g);
+    return NULL;
+  }
+  return g;
+}
+
+void generator_cancel(Generator *g) {
+  (void)g;
+  runctl_cancel();
+}
+
+void generator_pause(Generator *g) {
+  (void)g;
+  runctl_pause(true);
+}
+
+void generator_resume(Generator *g) {
+  (void)g;
+  runctl_pause(false);
+}
+
+GeneratorStatus generator_status(const Generator *g) {
+  (void)g;
+  GeneratorStatus st;
+  memset(&st, 0, sizeof(st));
+  st.state = (GeneratorState)atomic_load(&g_run_state);
+  if (st.state == GENERATOR_RUNNING) {
+    if (runctl_cancelled()) st.state = GENERATOR_CANCELLING;
+    else if (runctl_paused()) st.state = GENERATOR_PAUSED;
+  }
+  st.movies_done = atomic_load(&g_run_done);
+  st.movies_queued = atomic_load(&g_run_queued);
+  st.result = atomic_load(&g_run_result);
+
+  st.movies_finished = atomic_load(&g_run_finished);
+
+  const char *stage = atomic_load(&g_run_stage);
+  st.stage = stage ? stage : "";
+  st.clips_planned = atomic_load(&g_run_clips_planned);
+  st.clips_built = (int)(metrics_counter_get(METRIC_CLIPS_BUILT) - atomic_load(&g_movie_built_base));
+  st.clips_failed = (int)(metrics_counter_get(METRIC_CLIPS_FAILED) - atomic_load(&g_movie_failed_base));
+  st.encoders_active = atomic_load(&g_run_encoders);
+
+  double now = metrics_now();
+  run_movie_lock();
+  snprintf(st.movie, sizeof(st.movie), "%s", g_run_movie);
+  bool running = st.state == GENERATOR_RUNNING || st.state == GENERATOR_PAUSED ||
+                 st.state == GENERATOR_CANCELLING;
+  st.run_elapsed_s = running && g_run_started > 0.0 ? now - g_run_started : 0.0;
+  st.movie_elapsed_s = running && st.movie[0] ? now - g_movie_started : 0.0;
+  run_movie_unlock();
+  return st;
+}
+
+int generator_wait(Generator *g) {
+  if (!g->joined) {
+#if defined(_WIN32)
+    WaitForSingleObject(g->thread, INFINITE);
+    CloseHandle(g->thread);
+#else
+    pthread_join(g->thread, NULL);
+#endif
+    g->joined = true;
+  }
+  return g->result;
+}
+
+void generator_free(Generator *g) {
+  if (!g) return;
+  if (!g->joined) {
+    if (atomic_load(&g_run_active)) {
+      generator_cancel(g);
+      runctl_pause(false);
+    }
+    generator_wait(g);
+  }
+  free(g);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,9 +15,185 @@ typedef GeneratorLogHook generator_log_hook_fn;
 // Install/uninstall log hook (pass NULL to disable)
 void generator_set_log_hook(GeneratorLogHook hook);
 
-// Core generation entrypoint
+// Live FFmpeg progress, one event per "-progress" block (about twice a
+// second) and a final one with done set. Delivered on the worker thread that
+// runs the encoder.
+typedef struct {
+  const char *stage;    // metrics stage name: "clip", "concat", "bgm", "mix", "vertical", "preview"
+  int clip;             // 1-based clip number for "clip", else 0
+  double out_time_s;    // output media time encoded so far
+  double total_s;       // expected output duration; 0 = unknown
+  double speed;         // multiple of realtime; 0 = unknown
+  double fps;
+  double elapsed_s;     // wall time since the encoder started
+  double eta_s;         // remaining wall time; negative = unknown
+  bool done;
+} GeneratorProgress;
+
+typedef void (*GeneratorProgressHook)(const GeneratorProgress *p);
+
+// Install/uninstall progress hook (pass NULL to disable)
+void generator_set_progress_hook(GeneratorProgressHook hook);
+
+// ---- Run options ----
+
+// Renders a run produces. When the horizontal render is selected it marks the
+// title as done: it is published last, and a failed vertical or preview only
+// warns. Otherwise every selected render has to be written.
+enum {
+  GENERATOR_OUT_HORIZONTAL = 1u << 0,   // <output_dir>/<title>.mp4
+  GENERATOR_OUT_VERTICAL   = 1u << 1,   // <vertical_dir>/<title>_vertical.mp4
+  GENERATOR_OUT_PREVIEW    = 1u << 2    // <preview_dir>/<title>_preview.mp4 (short, 480p)
+};
+
+// Planning needs the OpenAI key and little else; rendering needs ElevenLabs
+// and FFmpeg. Every planning run writes <plans_dir>/<title>_plan.json (a
+// versioned plan file, see plan.h), so the two halves can run on different
+// machines and an edited plan can be rendered again without the LLM.
+typedef enum {
+  GENERATOR_MODE_RENDER = 0,  // plan and render
+  GENERATOR_MODE_PLAN_ONLY,   // stop after writing the plan file
+  GENERATOR_MODE_RENDER_ONLY, // render from an existing plan file; no subtitles, no LLM
+  GENERATOR_MODE_SHARD_WORKER,// build clip shards that coordinators publish in shard_dir
+  GENERATOR_MODE_DRY_RUN      // report what would run; no network, no files
+} GeneratorMode;
+
+typedef struct {
+  // Directories; NULL keeps the default shown.
+  const char *movies_dir;     // "movies"
+  const char *output_dir;     // "output"
+  const char *vertical_dir;   // "tiktok_output"
+  const char *preview_dir;    // "previews"
+  const char *retired_dir;    // "movies_retired"
+  const char *work_dir;       // "clips"; cleared when a rendering run starts
+  const char *scripts_dir;    // "scripts"
+  const char *plans_dir;      // "<scripts_dir>/srt_files"
+  const char *music_dir;      // "backgroundmusic"
+  const char *config_path;    // "config.json"
+
+  // Titles (file name without .mp4) or glob patterns with * and ?; none = all.
+  const char *const *select;
+  int select_count;
+
+  GeneratorMode mode;
+  unsigned outputs;           // GENERATOR_OUT_* bits; 0 = horizontal | vertical
+  int num_clips;              // clips requested from the planner; 0 = random 20..30
+  int workers;                // movies processed at once; 0 = 1
+  int clip_encoders;          // FFmpeg clip encoders per movie; 0 = 3
+  int tts_jobs;               // narration requests in flight per movie; 0 = 1
+  bool force;                 // re-render titles whose outputs already exist
+  bool keep_sources;          // leave sources in movies_dir instead of retiring them
+
+  // Several processes (on one host or many) sharing movies_dir and the output
+  // directories coordinate through this directory: each title goes to the
+  // process that claims it first (see jobqueue.h). Each process then works in
+  // <work_dir>/<node>-<pid> and uses <scripts_dir>/lookup_cache.<node>.db. The
+  // cache is locked by the first process that opens it; others with the same
+  // node name run without one, so give each process on a host its own node.
+  const char *jobs_dir;       // NULL = this process owns movies_dir
+  const char *node;           // name in claims and cache files; NULL = host name
+  int lease_seconds;          // claim lease; 0 = 60
+  int max_attempts;           // failed attempts before a title is given up; 0 = 3
+
+  // One movie's clip encodes spread over several processes. A rendering run
+  // with shards > 1 publishes each plan under <shard_dir>/<title>/, builds
+  // shards itself alongside any GENERATOR_MODE_SHARD_WORKER processes, then
+  // concatenates and mixes alone. Workers need the same movie in their own
+  // movies_dir; clips and manifests go through shard_dir. lease_seconds and
+  // max_attempts apply to shard claims too.
+  const char *shard_dir;      // "shards"
+  int shards;                 // clip shards per movie; 0 or 1 = no sharding
+} GeneratorOptions;
+
+// Fills in the defaults (what run_generation() uses).
+void generator_options_init(GeneratorOptions *o);
+
+typedef enum {
+  GENERATOR_TITLE_DONE = 0,   // outputs written
+  GENERATOR_TITLE_PLANNED,    // plan-only: plan file written
+  GENERATOR_TITLE_PENDING,    // dry run: would be processed
+  GENERATOR_TITLE_SKIPPED,    // outputs (or the plan) already exist; render-only: no plan yet;
+                              // shared queue: done, claimed or given up elsewhere;
+                              // shard worker: no open shards
+  GENERATOR_TITLE_FAILED,
+  GENERATOR_TITLE_CANCELLED
+} GeneratorTitleStatus;
+
+// One per selected title, on the worker thread that handled it.
+typedef struct {
+  const char *title;
+  GeneratorTitleStatus status;
+  double seconds;             // wall time spent on the title
+  int clips_planned;
+  int clips_built;
+  const char *detail;         // stage that failed, skip reason, plan path; may be ""
+} GeneratorTitleResult;
+
+typedef void (*GeneratorTitleHook)(const GeneratorTitleResult *r);
+
+// Install/uninstall the per-title hook (pass NULL to disable)
+void generator_set_title_hook(GeneratorTitleHook hook);
+
+const char *generator_title_status_name(GeneratorTitleStatus s);
+
+// Core generation entrypoint (blocking). Returns the number of movies
+// processed. Honors generator_cancel()/generator_pause() and the runctl flags.
 int run_generation(void);
 
+// Same with explicit options; o may be NULL for the defaults. Returns the
+// number of titles that reached their goal (DONE or PLANNED; PENDING in a
+// dry run).
+int run_generation_with(const GeneratorOptions *o);
+
+// ---- Background runs ----
+//
+// One run at a time, on its own thread. Cancel and pause are cooperative:
+// HTTP transfers abort from curl's progress callback, encoders are stopped
+// (cancel) or suspended (pause), and the pipeline checks in between stages.
+// A cancelled movie leaves nothing in output/ or tiktok_output/: final files
+// are rendered elsewhere and renamed into place.
+
+typedef enum {
+  GENERATOR_IDLE = 0,
+  GENERATOR_RUNNING,
+  GENERATOR_PAUSED,
+  GENERATOR_CANCELLING,
+  GENERATOR_FINISHED,
+  GENERATOR_CANCELLED
+} GeneratorState;
+
+typedef struct {
+  GeneratorState state;
+  int movies_done;      // processed successfully so far
+  int movies_finished;  // done + failed + skipped
+  int movies_queued;    // titles selected when the run started
+  int result;           // run_generation() result once FINISHED/CANCELLED
+  char movie[256];      // title in progress, "" between movies
+  const char *stage;    // metrics stage name of the current movie, "" if none
+
+  // Current movie: the one started last when several workers run; the clip
+  // counts then cover every movie in flight.
+  int clips_planned;
+  int clips_built;
+  int clips_failed;
+  int encoders_active;  // FFmpeg processes running right now
+  double movie_elapsed_s;
+  double run_elapsed_s;
+} GeneratorStatus;
+
+typedef struct Generator Generator;
+
+// NULL if a run is already active or the thread cannot be created.
+Generator *generator_start(void);
+void generator_cancel(Generator *g);
+void generator_pause(Generator *g);
+void generator_resume(Generator *g);
+GeneratorStatus generator_status(const Generator *g);
+// Blocks until the run ends; returns its result.
+int generator_wait(Generator *g);
+// Cancels a run that is still going, waits for it and frees the handle.
+void generator_free(Generator *g);
+
 // Back-compat: older UI code calls generator_run()
 #ifndef generator_run
   #define generator_run() run_generation()
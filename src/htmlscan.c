@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "htmlscan.h"
+#include "log.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void html_scan_init(HtmlScan *s, HtmlHrefFn on_href, void *user, bool want_script) {
+  memset(s, 0, sizeof(*s));
+  s->on_href = on_href;
+  s->user = user;
+  s->want_script = want_script;
+  s->state = HS_TEXT;
+}
+
+void html_scan_free(HtmlScan *s) {
+  if (!s) return;
+  free(s->pre.data);
+  free(s->scr.data);
+  s->pre = (HtmlRegion){0};
+  s->scr = (HtmlRegion){0};
+}
+
+char *html_scan_take_script(HtmlScan *s, size_t *len_out) {
+  HtmlRegion *r = NULL;
+  if (s->pre.done) r = &s->pre;
+  else if (s->scr.done) r = &s->scr;
+
+  if (!r) {
+    if (len_out) *len_out = 0;
+    return NULL;
+  }
+
+  char *out = r->data ? r->data : strdup("");
+  if (!out) die("OOM");
+  if (len_out) *len_out = r->len;
+  r->data = NULL;
+  r->len = r->cap = 0;
+  return out;
+}
+
+/* ------------------------ text regions ------------------------ */
+
+static void region_put(HtmlRegion *r, const char *p, size_t n) {
+  if (r->len + n + 1 > r->cap) {
+    size_t cap = r->cap ? r->cap : 64 * 1024;
+    while (r->len + n + 1 > cap) cap *= 2;
+    char *q = (char *)realloc(r->data, cap);
+    if (!q) die("OOM");
+    r->data = q;
+    r->cap = cap;
+  }
+  memcpy(r->data + r->len, p, n);
+  r->len += n;
+  r->data[r->len] = 0;
+}
+
+/* Once a <pre> block has closed it wins, so the scrtext copy can stop growing. */
+static bool capturing(const HtmlScan *s) {
+  return s->pre.open || (s->scr.open && !s->pre.done);
+}
+
+static void emit_text(HtmlScan *s, const char *p, size_t n) {
+  if (n == 0) return;
+  if (s->pre.open) region_put(&s->pre, p, n);
+  if (s->scr.open && !s->pre.done) region_put(&s->scr, p, n);
+}
+
+/* ------------------------ tags ------------------------ */
+
+static bool tag_is(const HtmlScan *s, const char *name) {
+  return strlen(name) == s->tag_len && memcmp(s->tag, name, s->tag_len) == 0;
+}
+
+static void attr_done(HtmlScan *s) {
+  if (s->closing) return;
+
+  if (s->attr_len == 4 && memcmp(s->attr, "href", 4) == 0) {
+    if (s->on_href && !s->on_href(s->user, s->val, s->val_len)) s->stopped = true;
+  } else if (s->attr_len == 5 && memcmp(s->attr, "class", 5) == 0) {
+    if (s->val_len == 7 && strncasecmp(s->val, "scrtext", 7) == 0) s->has_scrtext = true;
+  }
+}
+
+static void tag_done(HtmlScan *s) {
+  if (!s->want_script) return;
+
+  if (!s->closing) {
+    if (tag_is(s, "br")) emit_text(s, "\n", 1);
+    if (tag_is(s, "pre") && !s->pre.open && !s->pre.done) s->pre.open = true;
+    if (s->has_scrtext && !s->scr.open && !s->scr.done) s->scr.open = true;
+  } else {
+    if (tag_is(s, "pre") && s->pre.open) {
+      s->pre.open = false;
+      s->pre.done = true;
+      if (!s->on_href) s->stopped = true;
+    }
+    if ((tag_is(s, "td") || tag_is(s, "div")) && s->scr.open) {
+      s->scr.open = false;
+      s->scr.done = true;
+    }
+  }
+}
+
+static void tag_begin(HtmlScan *s) {
+  s->closing = false;
+  s->has_scrtext = false;
+  s->tag_len = 0;
+  s->attr_len = 0;
+  s->val_len = 0;
+}
+
+static void attr_begin(HtmlScan *s, char c) {
+  s->attr_len = 0;
+  s->val_len = 0;
+  s->attr[s->attr_len++] = (char)tolower((unsigned char)c);
+}
+
+static void val_put(HtmlScan *s, char c) {
+  if (s->val_len + 1 < sizeof(s->val)) s->val[s->val_len++] = c;
+  s->val[s->val_len] = 0;
+}
+
+/* ------------------------ entities ------------------------ */
+
+typedef struct { const char *name; char ch; } Entity;
+static const Entity k_entities[] = {
+  { "nbsp;", ' ' }, { "amp;", '&' }, { "lt;", '<' }, { "gt;", '>' },
+};
+
+/* 1 = complete match (decoded char in *out), 0 = still a prefix, -1 = no entity. */
+static int entity_match(const char *buf, size_t n, char *out) {
+  bool prefix = false;
+  for (size_t i = 0; i < sizeof(k_entities) / sizeof(k_entities[0]); i++) {
+    size_t en = strlen(k_entities[i].name);
+    if (n > en || memcmp(buf, k_entities[i].name, n) != 0) continue;
+    if (n == en) { *out = k_entities[i].ch; return 1; }
+    prefix = true;
+  }
+  return prefix ? 0 : -1;
+}
+
+static void scan_bytes(HtmlScan *s, const char *p, size_t n);
+
+static void entity_char(HtmlScan *s, char c) {
+  s->ent[s->ent_len++] = c;
+
+  char dec = 0;
+  int m = entity_match(s->ent, s->ent_len, &dec);
+  if (m == 0) return;
+
+  s->state = HS_TEXT;
+  if (m == 1) {
+    emit_text(s, &dec, 1);
+    s->ent_len = 0;
+    return;
+  }
+
+  /* Not an entity: the '&' is literal and the buffered bytes are ordinary input. */
+  char replay[sizeof(s->ent)];
+  size_t rn = s->ent_len;
+  memcpy(replay, s->ent, rn);
+  s->ent_len = 0;
+  emit_text(s, "&", 1);
+  scan_bytes(s, replay, rn);
+}
+
+/* ------------------------ main loop ------------------------ */
+
+static void scan_bytes(HtmlScan *s, const char *p, size_t n) {
+  size_t i = 0;
+  while (i < n && !s->stopped) {
+    if (s->state == HS_TEXT) {
+      /* Bulk path: jump to the next tag; inside a capture region, copy the
+         run up to each '&' in one go. */
+      const char *lt = (const char *)memchr(p + i, '<', n - i);
+      size_t end = lt ? (size_t)(lt - p) : n;
+
+      if (capturing(s)) {
+        const char *amp = (const char *)memchr(p + i, '&', end - i);
+        if (amp) {
+          size_t at = (size_t)(amp - p);
+          emit_text(s, p + i, at - i);
+          i = at + 1;
+          s->state = HS_ENTITY;
+          s->ent_len = 0;
+          continue;
+        }
+        emit_text(s, p + i, end - i);
+      }
+
+      i = end;
+      if (lt) {
+        i++;
+        s->state = HS_TAG_START;
+        tag_begin(s);
+      }
+      continue;
+    }
+
+    char c = p[i++];
+    unsigned char uc = (unsigned char)c;
+
+    switch (s->state) {
+      case HS_ENTITY:
+        entity_char(s, c);
+        break;
+
+      case HS_TAG_START:
+        if (c == '/') { s->closing = true; s->state = HS_TAG_NAME; }
+        else if (c == '!') { s->state = HS_DECL; s->decl_len = 0; s->dashes = 0; }
+        else if (c == '>') { tag_done(s); s->state = HS_TEXT; }
+        else if (!isspace(uc)) {
+          s->tag[s->tag_len++] = (char)tolower(uc);
+          s->state = HS_TAG_NAME;
+        }
+        break;
+
+      case HS_TAG_NAME:
+        if (c == '>') { tag_done(s); s->state = HS_TEXT; }
+        else if (isspace(uc) || c == '/') {
+          if (s->tag_len > 0) s->state = HS_ATTR_SPACE;
+        } else if (s->tag_len + 1 < sizeof(s->tag)) {
+          s->tag[s->tag_len++] = (char)tolower(uc);
+        }
+        break;
+
+      case HS_ATTR_SPACE:
+        if (c == '>') { tag_done(s); s->state = HS_TEXT; }
+        else if (!isspace(uc) && c != '/') { attr_begin(s, c); s->state = HS_ATTR_NAME; }
+        break;
+
+      case HS_ATTR_NAME:
+        if (c == '=') s->state = HS_ATTR_BEFORE_VALUE;
+        else if (c == '>') { attr_done(s); tag_done(s); s->state = HS_TEXT; }
+        else if (isspace(uc)) s->state = HS_ATTR_AFTER_NAME;
+        else if (c == '/') { attr_done(s); s->state = HS_ATTR_SPACE; }
+        else if (s->attr_len + 1 < sizeof(s->attr)) s->attr[s->attr_len++] = (char)tolower(uc);
+        break;
+
+      case HS_ATTR_AFTER_NAME:
+        if (c == '=') s->state = HS_ATTR_BEFORE_VALUE;
+        else if (c == '>') { attr_done(s); tag_done(s); s->state = HS_TEXT; }
+        else if (!isspace(uc)) { attr_done(s); attr_begin(s, c); s->state = HS_ATTR_NAME; }
+        break;
+
+      case HS_ATTR_BEFORE_VALUE:
+        if (c == '"' || c == '\'') { s->quote = c; s->state = HS_ATTR_VALUE_QUOTED; }
+        else if (c == '>') { attr_done(s); tag_done(s); s->state = HS_TEXT; }
+        else if (!isspace(uc)) { val_put(s, c); s->state = HS_ATTR_VALUE_BARE; }
+        break;
+
+      case HS_ATTR_VALUE_QUOTED: {
+        /* Copy the whole quoted run at once. */
+        size_t from = i - 1;
+        const char *q = (const char *)memchr(p + from, s->quote, n - from);
+        size_t end = q ? (size_t)(q - p) : n;
+        size_t room = sizeof(s->val) - 1 - s->val_len;
+        size_t take = (end - from < room) ? end - from : room;
+        memcpy(s->val + s->val_len, p + from, take);
+        s->val_len += take;
+        s->val[s->val_len] = 0;
+        i = end;
+        if (q) {
+          i++;
+          attr_done(s);
+          s->state = HS_ATTR_SPACE;
+        }
+        break;
+      }
+
+      case HS_ATTR_VALUE_BARE:
+        if (c == '>') { attr_done(s); tag_done(s); s->state = HS_TEXT; }
+        else if (isspace(uc)) { attr_done(s); s->state = HS_ATTR_SPACE; }
+        else val_put(s, c);
+        break;
+
+      case HS_DECL:
+        /* <!-- comment --> or <!DOCTYPE ...> */
+        if (s->decl_len < 2 && c == '-') {
+          if (++s->decl_len == 2) { s->state = HS_COMMENT; s->dashes = 0; }
+        } else if (c == '>') {
+          s->state = HS_TEXT;
+        } else {
+          s->decl_len = 2;
+        }
+        break;
+
+      case HS_COMMENT:
+        if (c == '>' && s->dashes >= 2) s->state = HS_TEXT;
+        else if (c == '-') s->dashes++;
+        else s->dashes = 0;
+        break;
+
+      case HS_TEXT:
+        break;
+    }
+  }
+}
+
+bool html_scan_feed(HtmlScan *s, const char *data, size_t n) {
+  if (s->stopped) return false;
+  if (data && n) scan_bytes(s, data, n);
+  return !s->stopped;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Single-pass, incremental HTML scanner for the subf2m and IMSDb pages.
+//
+// Feed the page in arbitrary chunks (e.g. straight from a curl write callback).
+// In one scan it reports every href attribute and, when want_script is set,
+// collects the decoded text of the first <pre> block and of the first
+// class="scrtext" element, with the same rules html_to_text_basic() applies:
+// tags stripped, <br> kept as a newline, &nbsp; &amp; &lt; &gt; decoded.
+
+// Return false to stop scanning (e.g. once the wanted link has been seen).
+typedef bool (*HtmlHrefFn)(void *user, const char *href, size_t len);
+
+typedef enum {
+  HS_TEXT = 0,
+  HS_ENTITY,
+  HS_TAG_START,
+  HS_TAG_NAME,
+  HS_ATTR_SPACE,
+  HS_ATTR_NAME,
+  HS_ATTR_AFTER_NAME,
+  HS_ATTR_BEFORE_VALUE,
+  HS_ATTR_VALUE_QUOTED,
+  HS_ATTR_VALUE_BARE,
+  HS_DECL,
+  HS_COMMENT
+} HtmlScanState;
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+  bool open;
+  bool done;
+} HtmlRegion;
+
+typedef struct {
+  HtmlHrefFn on_href;
+  void *user;
+  bool want_script;
+  bool stopped;
+
+  HtmlScanState state;
+  bool closing;
+  bool has_scrtext;
+  char quote;
+  int dashes;
+  size_t decl_len;
+
+  char tag[16];   size_t tag_len;
+  char attr[32];  size_t attr_len;
+  char val[2048]; size_t val_len;
+  char ent[8];    size_t ent_len;
+
+  HtmlRegion pre;
+  HtmlRegion scr;
+} HtmlScan;
+
+void html_scan_init(HtmlScan *s, HtmlHrefFn on_href, void *user, bool want_script);
+
+// Returns false once the scan has been stopped (by a callback or because the
+// <pre> script block is complete and nothing else was asked for).
+bool html_scan_feed(HtmlScan *s, const char *data, size_t n);
+
+// Script text (the <pre> block if one closed, else the scrtext element), or NULL.
+// Ownership passes to the caller.
+char *html_scan_take_script(HtmlScan *s, size_t *len_out);
+
+void html_scan_free(HtmlScan *s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "http.h"
+#include "fetch.h"
+#include "log.h"
+#include "metrics.h"
+
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <curl/curl.h>
+
+/*                                  name        tries base  max   conn  total  timeouts */
+const HttpPolicy HTTP_POLICY_PAGE     = { "page",     3, 0.5,  4.0, 10,   30,  true  };
+const HttpPolicy HTTP_POLICY_DOWNLOAD = { "download", 3, 1.0,  8.0, 10,  120,  true  };
+const HttpPolicy HTTP_POLICY_LLM      = { "openai",   4, 2.0, 30.0, 30, 3600,  false };
+const HttpPolicy HTTP_POLICY_TTS      = { "tts",      4, 1.0, 20.0, 30,  300,  true  };
+
+const char *http_error_name(HttpError err) {
+  switch (err) {
+    case HTTP_OK:               return "ok";
+    case HTTP_ERR_TRANSPORT:    return "transport";
+    case HTTP_ERR_STATUS:       return "status";
+    case HTTP_ERR_CIRCUIT_OPEN: return "circuit-open";
+    case HTTP_ERR_ABORTED:      return "aborted";
+    case HTTP_ERR_CANCELLED:    return "cancelled";
+  }
+  return "unknown";
+}
+
+/* ------------------------ retry policy ------------------------ */
+
+HttpError http_classify(int curl_code, long status) {
+  if (curl_code == CURLE_ABORTED_BY_CALLBACK) return HTTP_ERR_CANCELLED;
+  if (curl_code == CURLE_WRITE_ERROR || curl_code == CURLE_FILESIZE_EXCEEDED) return HTTP_ERR_ABORTED;
+  if (curl_code != CURLE_OK) return HTTP_ERR_TRANSPORT;
+  if (status < 200 || status >= 300) return HTTP_ERR_STATUS;
+  return HTTP_OK;
+}
+
+bool http_should_retry(const HttpPolicy *policy, int curl_code, long status) {
+  switch ((CURLcode)curl_code) {
+    case CURLE_OK:
+      return status == 408 || status == 429 || status == 500 || status == 502 ||
+             status == 503 || status == 504;
+    case CURLE_OPERATION_TIMEDOUT:
+      return policy->retry_timeouts;
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* splitmix64 over a shared atomic counter: lock-free and good enough for jitter. */
+static double jitter_unit(void) {
+  static _Atomic uint64_t state = 0;
+  uint64_t seed = atomic_load_explicit(&state, memory_order_relaxed);
+  if (seed == 0) {
+    uint64_t t = (uint64_t)(metrics_now() * 1e9) | 1u;
+    uint64_t expected = 0;
+    atomic_compare_exchange_strong(&state, &expected, t);
+  }
+  uint64_t z = atomic_fetch_add_explicit(&state, 0x9E3779B97F4A7C15ull, memory_order_relaxed);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z ^= z >> 31;
+  return (double)(z >> 11) / (double)(1ull << 53);
+}
+
+double http_backoff_delay(const HttpPolicy *policy, int attempt, double retry_after_s) {
+  double d = policy->base_delay_s;
+  for (int i = 1; i < attempt && d < policy->max_delay_s; i++) d *= 2.0;
+  if (d > policy->max_delay_s) d = policy->max_delay_s;
+
+  /* "Equal jitter": keep half the delay, randomise the other half. */
+  d = d * 0.5 + d * 0.5 * jitter_unit();
+
+  if (retry_after_s > d) d = retry_after_s < 120.0 ? retry_after_s : 120.0;
+  return d;
+}
+
+/* ------------------------ circuit breaker ------------------------ */
+
+#define BREAKER_HOSTS 32
+#define BREAKER_THRESHOLD 5
+#define BREAKER_COOLDOWN_S 30.0
+#define BREAKER_MAX_COOLDOWN_S 300.0
+#define BREAKER_TRIAL_TIMEOUT_S 150.0
+
+typedef enum { BREAKER_CLOSED = 0, BREAKER_OPEN, BREAKER_HALF_OPEN } BreakerState;
+
+typedef struct {
+  char host[128];
+  BreakerState state;
+  int failures;
+  double cooldown;
+  double open_until;
+  double trial_until;       /* a half-open trial that never reports expires */
+} Breaker;
+
+static Breaker g_breakers[BREAKER_HOSTS];
+static atomic_flag g_breaker_lock = ATOMIC_FLAG_INIT;
+
+static void breaker_lock(void) {
+  while (atomic_flag_test_and_set_explicit(&g_breaker_lock, memory_order_acquire)) {}
+}
+
+static void breaker_unlock(void) {
+  atomic_flag_clear_explicit(&g_breaker_lock, memory_order_release);
+}
+
+static void url_host(const char *url, char *out, size_t outsz) {
+  const char *p = strstr(url, "://");
+  p = p ? p + 3 : url;
+  size_t j = 0;
+  for (; *p && *p != '/' && *p != '?' && *p != '#' && j + 1 < outsz; p++) {
+    out[j++] = (char)tolower((unsigned char)*p);
+  }
+  out[j] = 0;
+}
+
+/* Caller holds the lock. Reuses the least interesting slot when full. */
+static Breaker *breaker_for(const char *host) {
+  Breaker *free_slot = NULL;
+  for (int i = 0; i < BREAKER_HOSTS; i++) {
+    Breaker *b = &g_breakers[i];
+    if (b->host[0] && strcmp(b->host, host) == 0) return b;
+    if (!free_slot && (!b->host[0] || (b->state == BREAKER_CLOSED && b->failures == 0))) free_slot = b;
+  }
+  if (!free_slot) return NULL;
+  memset(free_slot, 0, sizeof(*free_slot));
+  snprintf(free_slot->host, sizeof(free_slot->host), "%s", host);
+  return free_slot;
+}
+
+bool http_breaker_allow(const char *url) {
+  char host[128];
+  url_host(url, host, sizeof(host));
+  double now = metrics_now();
+
+  breaker_lock();
+  Breaker *b = breaker_for(host);
+  bool allow = true;
+  if (b) {
+    if (b->state == BREAKER_OPEN) {
+      if (now >= b->open_until) {
+        b->state = BREAKER_HALF_OPEN;
+        b->trial_until = now + BREAKER_TRIAL_TIMEOUT_S;
+      } else {
+        allow = false;
+      }
+    } else if (b->state == BREAKER_HALF_OPEN) {
+      if (now >= b->trial_until) b->trial_until = now + BREAKER_TRIAL_TIMEOUT_S;
+      else allow = false;
+    }
+  }
+  breaker_unlock();
+  return allow;
+}
+
+void http_breaker_report(const char *url, bool healthy) {
+  char host[128];
+  url_host(url, host, sizeof(host));
+  double now = metrics_now();
+  bool opened = false;
+  double cooldown = 0.0;
+
+  breaker_lock();
+  Breaker *b = breaker_for(host);
+  if (b) {
+    if (healthy) {
+      b->state = BREAKER_CLOSED;
+      b->failures = 0;
+      b->cooldown = 0.0;
+    } else if (b->state == BREAKER_HALF_OPEN) {
+      b->cooldown = b->cooldown * 2.0 < BREAKER_MAX_COOLDOWN_S ? b->cooldown * 2.0 : BREAKER_MAX_COOLDOWN_S;
+      b->state = BREAKER_OPEN;
+      b->open_until = now + b->cooldown;
+      opened = true;
+      cooldown = b->cooldown;
+    } else if (b->state == BREAKER_CLOSED && ++b->failures >= BREAKER_THRESHOLD) {
+      b->cooldown = BREAKER_COOLDOWN_S;
+      b->state = BREAKER_OPEN;
+      b->open_until = now + b->cooldown;
+      opened = true;
+      cooldown = b->cooldown;
+    }
+  }
+  breaker_unlock();
+
+  if (opened) logw("http: %s keeps failing; pausing requests to it for %.0fs", host, cooldown);
+}
+
+/* ------------------------ blocking calls ------------------------ */
+
+static void sync_done(FetchGroup *g, FetchJob *job) {
+  HttpResult *r = (HttpResult *)job->user;
+  (void)g;
+
+  r->err = job->err;
+  r->status = job->code;
+  r->curl_code = job->curl_code;
+  r->attempts = job->attempt;
+  r->body = job->body;
+  r->len = job->len;
+  job->body = NULL;
+
+  r->message[0] = 0;
+  if (r->err == HTTP_ERR_CIRCUIT_OPEN) {
+    snprintf(r->message, sizeof(r->message), "host temporarily disabled after repeated failures");
+  } else if (r->err == HTTP_ERR_STATUS) {
+    snprintf(r->message, sizeof(r->message), "HTTP %ld", r->status);
+  } else if (r->err == HTTP_ERR_CANCELLED) {
+    snprintf(r->message, sizeof(r->message), "cancelled");
+  } else if (r->err != HTTP_OK) {
+    snprintf(r->message, sizeof(r->message), "%s", curl_easy_strerror((CURLcode)r->curl_code));
+  }
+}
+
+/* body == NULL means GET. The body is borrowed: the call blocks until done. */
+static bool run_one(const char *url, const char *const *headers, const char *body, size_t body_len,
+                    const HttpPolicy *policy, HttpResult *out) {
+  memset(out, 0, sizeof(*out));
+  out->err = HTTP_ERR_ABORTED;
+  snprintf(out->message, sizeof(out->message), "request not run");
+
+  FetchGroup *g = fetch_group_new();
+  FetchJob *j = body ? fetch_post_borrowed(g, url, body, body_len, sync_done, out, 0)
+                     : fetch_get(g, url, sync_done, out, 0);
+  fetch_job_policy(j, policy);
+  for (const char *const *h = headers; h && *h; h++) fetch_job_header(j, *h);
+
+  fetch_group_run(g);
+  fetch_group_free(g);
+  return out->err == HTTP_OK;
+}
+
+bool http_get(const char *url, const char *const *headers, const HttpPolicy *policy, HttpResult *out) {
+  return run_one(url, headers, NULL, 0, policy, out);
+}
+
+bool http_post(const char *url, const char *const *headers, const char *body,
+               const HttpPolicy *policy, HttpResult *out) {
+  return run_one(url, headers, body ? body : "", body ? strlen(body) : 0, policy, out);
+}
+
+bool http_post_n(const char *url, const char *const *headers, const char *body, size_t len,
+                 const HttpPolicy *policy, HttpResult *out) {
+  return run_one(url, headers, body ? body : "", body ? len : 0, policy, out);
+}
+
+void http_result_free(HttpResult *r) {
+  if (!r) return;
+  free(r->body);
+  r->body = NULL;
+  r->len = 0;
+}
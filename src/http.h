@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// HTTP error model, per-endpoint retry policies and per-host circuit
+// breakers. Nothing here exits the process: failures come back as an
+// HttpError so one flaky host costs one movie, not the whole batch.
+//
+// The retries themselves run inside the fetch engine (fetch.h), so they apply
+// to concurrent lookups as well as to the blocking http_get/http_post calls.
+
+typedef enum {
+  HTTP_OK = 0,
+  HTTP_ERR_TRANSPORT,        // DNS, connect, TLS, reset, timeout
+  HTTP_ERR_STATUS,           // server answered with a non-2xx status
+  HTTP_ERR_CIRCUIT_OPEN,     // host is failing; request was not sent
+  HTTP_ERR_ABORTED,          // body too large or local write failure
+  HTTP_ERR_CANCELLED         // the run was cancelled (runctl.h)
+} HttpError;
+
+typedef struct {
+  const char *name;          // shows up in retry log lines
+  int max_attempts;          // including the first one
+  double base_delay_s;       // backoff before the first retry, doubled each time
+  double max_delay_s;
+  long connect_timeout_s;
+  long timeout_s;
+  bool retry_timeouts;       // false for calls whose timeout is already hours long
+} HttpPolicy;
+
+extern const HttpPolicy HTTP_POLICY_PAGE;       // scraped HTML pages
+extern const HttpPolicy HTTP_POLICY_DOWNLOAD;   // subtitle archives / files
+extern const HttpPolicy HTTP_POLICY_LLM;        // OpenAI; callers set timeout_s
+extern const HttpPolicy HTTP_POLICY_TTS;        // ElevenLabs
+
+typedef struct {
+  HttpError err;
+  long status;
+  int curl_code;
+  int attempts;
+  char *body;                // NUL-terminated, may be NULL; owned by the result
+  size_t len;
+  char message[256];         // human-readable failure, empty on success
+} HttpResult;
+
+// Headers are "Name: value" strings, NULL-terminated list (may be NULL).
+bool http_get(const char *url, const char *const *headers, const HttpPolicy *policy, HttpResult *out);
+bool http_post(const char *url, const char *const *headers, const char *body,
+               const HttpPolicy *policy, HttpResult *out);
+// Body of len bytes, sent in place (no copy is made).
+bool http_post_n(const char *url, const char *const *headers, const char *body, size_t len,
+                 const HttpPolicy *policy, HttpResult *out);
+void http_result_free(HttpResult *r);
+
+const char *http_error_name(HttpError err);
+
+// ---- building blocks used by the fetch engine ----
+
+HttpError http_classify(int curl_code, long status);
+
+// Whether a failed attempt is worth repeating under the policy.
+bool http_should_retry(const HttpPolicy *policy, int curl_code, long status);
+
+// Delay before retry number `attempt` (1-based): exponential with jitter,
+// or the server's Retry-After when it asked for longer.
+double http_backoff_delay(const HttpPolicy *policy, int attempt, double retry_after_s);
+
+// Circuit breaker keyed by URL host. After several consecutive failures a
+// host is skipped for a cool-down period, then a single trial request decides
+// whether it closes again.
+bool http_breaker_allow(const char *url);
+void http_breaker_report(const char *url, bool healthy);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,550 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "jobqueue.h"
+#include "jsonw.h"
+#include "log.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <direct.h>
+  #include <fcntl.h>
+  #include <io.h>
+  #include <process.h>
+  #include <sys/utime.h>
+
+  #define unlink _unlink
+  #define getpid _getpid
+  static int mkdir_portable(const char *p, int mode) { (void)mode; return _mkdir(p); }
+  #define mkdir(p,m) mkdir_portable((p),(m))
+#else
+  #include <fcntl.h>
+  #include <pthread.h>
+  #include <unistd.h>
+#endif
+
+#define JOBQ_MAX_HELD 32
+#define JOBQ_PATH_MAX 4096
+
+typedef struct {
+  char title[256];
+  bool lost;
+} HeldClaim;
+
+struct JobQueue {
+  char *dir;
+  char node[128];
+  char token[192];         /* unique per process; identifies our claim files */
+  char node_path[JOBQ_PATH_MAX];
+  int lease;
+  int max_attempts;
+
+  atomic_flag lock;        /* held[] */
+  HeldClaim held[JOBQ_MAX_HELD];
+  int nheld;
+
+  atomic_bool stop;
+#if defined(_WIN32)
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+  bool thread_running;
+};
+
+static void q_lock(JobQueue *q) {
+  while (atomic_flag_test_and_set_explicit(&q->lock, memory_order_acquire)) {}
+}
+
+static void q_unlock(JobQueue *q) {
+  atomic_flag_clear_explicit(&q->lock, memory_order_release);
+}
+
+/* ------------------------ files ------------------------ */
+
+static bool make_dir(const char *p) {
+  return mkdir(p, 0755) == 0 || errno == EEXIST;
+}
+
+static bool path_exists(const char *p) {
+  struct stat st;
+  return stat(p, &st) == 0;
+}
+
+static void touch(const char *path) {
+#if defined(_WIN32)
+  _utime(path, NULL);
+#else
+  utimensat(AT_FDCWD, path, NULL, 0);
+#endif
+}
+
+/* Fails with errno == EEXIST when the file is already there; that is the
+   whole claim protocol. */
+static bool create_exclusive(const char *path, const char *body, size_t len) {
+#if defined(_WIN32)
+  int fd = _open(path, _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+  if (fd < 0) return false;
+  bool ok = _write(fd, body, (unsigned)len) == (int)len;
+  _close(fd);
+#else
+  int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) return false;
+  bool ok = write(fd, body, len) == (ssize_t)len;
+  close(fd);
+#endif
+  if (!ok) {
+    int e = errno;
+    unlink(path);
+    errno = e;
+  }
+  return ok;
+}
+
+/* The temp name carries our token, so two workers writing the same marker
+   never share a temp file. */
+static bool write_replace(const JobQueue *q, const char *path, const char *body, size_t len) {
+  char tmp[JOBQ_PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.%s.part", path, q->token);
+  FILE *f = fopen(tmp, "wb");
+  if (!f) return false;
+  bool ok = fwrite(body, 1, len, f) == len;
+  if (fclose(f) != 0) ok = false;
+#if defined(_WIN32)
+  if (ok) unlink(path);
+#endif
+  if (!ok || rename(tmp, path) != 0) {
+    unlink(tmp);
+    return false;
+  }
+  return true;
+}
+
+/* Small JSON files only (claims, markers). malloc'd, NUL-terminated. */
+static char *read_small(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  char *buf = (char *)malloc(4096);
+  if (!buf) die("OOM");
+  size_t n = fread(buf, 1, 4095, f);
+  fclose(f);
+  buf[n] = 0;
+  return buf;
+}
+
+static void claim_path(const JobQueue *q, const char *title, char *out, size_t outsz) {
+  snprintf(out, outsz, "%s/claims/%s.claim", q->dir, title);
+}
+
+static void done_path(const JobQueue *q, const char *title, char *out, size_t outsz) {
+  snprintf(out, outsz, "%s/done/%s.json", q->dir, title);
+}
+
+static void failed_path(const JobQueue *q, const char *title, char *out, size_t outsz) {
+  snprintf(out, outsz, "%s/failed/%s.json", q->dir, title);
+}
+
+/* "now" on the file server's clock: the mtime of our freshly touched node file. */
+static long long fs_now(JobQueue *q) {
+  touch(q->node_path);
+  struct stat st;
+  if (stat(q->node_path, &st) != 0) return (long long)time(NULL);
+  return (long long)st.st_mtime;
+}
+
+static bool claim_is_ours(const JobQueue *q, const char *path) {
+  char *body = read_small(path);
+  if (!body) return false;
+  bool ours = strstr(body, q->token) != NULL;
+  free(body);
+  return ours;
+}
+
+static void claim_owner(const char *path, char *out, size_t outsz) {
+  if (!out || !outsz) return;
+  snprintf(out, outsz, "unknown");
+  char *body = read_small(path);
+  if (!body) return;
+  cJSON *root = cJSON_Parse(body);
+  const cJSON *node = cJSON_GetObjectItemCaseSensitive(root, "node");
+  const cJSON *pid = cJSON_GetObjectItemCaseSensitive(root, "pid");
+  if (cJSON_IsString(node) && node->valuestring) {
+    snprintf(out, outsz, "%s (pid %d)", node->valuestring, cJSON_IsNumber(pid) ? pid->valueint : 0);
+  }
+  cJSON_Delete(root);
+  free(body);
+}
+
+static int failed_attempts(const JobQueue *q, const char *title) {
+  char path[JOBQ_PATH_MAX];
+  failed_path(q, title, path, sizeof(path));
+  char *body = read_small(path);
+  if (!body) return 0;
+  cJSON *root = cJSON_Parse(body);
+  const cJSON *n = cJSON_GetObjectItemCaseSensitive(root, "attempts");
+  int attempts = cJSON_IsNumber(n) ? n->valueint : 1;
+  cJSON_Delete(root);
+  free(body);
+  return attempts;
+}
+
+/* ------------------------ held claims ------------------------ */
+
+static void held_add(JobQueue *q, const char *title) {
+  q_lock(q);
+  if (q->nheld < JOBQ_MAX_HELD) {
+    HeldClaim *h = &q->held[q->nheld++];
+    snprintf(h->title, sizeof(h->title), "%s", title);
+    h->lost = false;
+  } else {
+    logw("jobs: more than %d claims held; %s will not be heartbeated", JOBQ_MAX_HELD, title);
+  }
+  q_unlock(q);
+}
+
+static void held_remove(JobQueue *q, const char *title) {
+  q_lock(q);
+  for (int i = 0; i < q->nheld; i++) {
+    if (strcmp(q->held[i].title, title) == 0) {
+      q->held[i] = q->held[--q->nheld];
+      break;
+    }
+  }
+  q_unlock(q);
+}
+
+/* Removes our claim file (unless someone took it over) and forgets it. */
+static void drop_claim(JobQueue *q, const char *title) {
+  char path[JOBQ_PATH_MAX];
+  claim_path(q, title, path, sizeof(path));
+  if (claim_is_ours(q, path)) unlink(path);
+  held_remove(q, title);
+}
+
+/* ------------------------ heartbeat ------------------------ */
+
+static void heartbeat_once(JobQueue *q) {
+  touch(q->node_path);
+
+  HeldClaim snap[JOBQ_MAX_HELD];
+  q_lock(q);
+  int n = q->nheld;
+  memcpy(snap, q->held, (size_t)n * sizeof(HeldClaim));
+  q_unlock(q);
+
+  for (int i = 0; i < n; i++) {
+    if (snap[i].lost) continue;
+    char path[JOBQ_PATH_MAX];
+    claim_path(q, snap[i].title, path, sizeof(path));
+    if (claim_is_ours(q, path)) {
+      touch(path);
+      continue;
+    }
+    logw("jobs: lost the lease on %s; another worker took it over", snap[i].title);
+    q_lock(q);
+    for (int k = 0; k < q->nheld; k++) {
+      if (strcmp(q->held[k].title, snap[i].title) == 0) q->held[k].lost = true;
+    }
+    q_unlock(q);
+  }
+}
+
+static void heartbeat_loop(JobQueue *q) {
+  int period_ms = q->lease * 1000 / 3;
+  if (period_ms < 1000) period_ms = 1000;
+  while (!atomic_load(&q->stop)) {
+    for (int waited = 0; waited < period_ms && !atomic_load(&q->stop); waited += 100) {
+#if defined(_WIN32)
+      Sleep(100);
+#else
+      struct timespec ts = { 0, 100 * 1000000L };
+      nanosleep(&ts, NULL);
+#endif
+    }
+    if (!atomic_load(&q->stop)) heartbeat_once(q);
+  }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI heartbeat_thread(LPVOID p) {
+  heartbeat_loop((JobQueue *)p);
+  return 0;
+}
+#else
+static void *heartbeat_thread(void *p) {
+  heartbeat_loop((JobQueue *)p);
+  return NULL;
+}
+#endif
+
+/* ------------------------ API ------------------------ */
+
+static void default_node_name(char *out, size_t outsz) {
+#if defined(_WIN32)
+  DWORD n = (DWORD)outsz;
+  if (!GetComputerNameA(out, &n)) snprintf(out, outsz, "node");
+#else
+  if (gethostname(out, outsz) != 0) snprintf(out, outsz, "node");
+  out[outsz - 1] = 0;
+#endif
+}
+
+void jobq_node_name(const char *node, char *out, size_t outsz) {
+  if (node && node[0]) snprintf(out, outsz, "%s", node);
+  else default_node_name(out, outsz);
+  /* The node name ends up in file names. */
+  for (char *p = out; *p; p++) {
+    if (*p == '/' || *p == '\\' || *p == ':' || *p == ' ') *p = '_';
+  }
+}
+
+JobQueue *jobq_open(const char *dir, const char *node, int lease_seconds, int max_attempts) {
+  JobQueue *q = (JobQueue *)calloc(1, sizeof(JobQueue));
+  if (!q) die("OOM");
+  atomic_flag_clear(&q->lock);
+  atomic_init(&q->stop, false);
+  q->dir = strdup(dir);
+  if (!q->dir) die("OOM");
+  q->lease = lease_seconds > 0 ? lease_seconds : 60;
+  q->max_attempts = max_attempts > 0 ? max_attempts : 3;
+
+  jobq_node_name(node, q->node, sizeof(q->node));
+
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  snprintf(q->token, sizeof(q->token), "%s-%d-%lld%09ld", q->node, (int)getpid(),
+           (long long)ts.tv_sec, (long)ts.tv_nsec);
+
+  static const char *const subdirs[] = { "claims", "done", "failed", "nodes" };
+  char path[JOBQ_PATH_MAX];
+  bool ok = make_dir(dir);
+  for (size_t i = 0; ok && i < sizeof(subdirs) / sizeof(subdirs[0]); i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, subdirs[i]);
+    ok = make_dir(path);
+  }
+  snprintf(q->node_path, sizeof(q->node_path), "%s/nodes/%s.alive", dir, q->node);
+  if (ok) {
+    char body[256];
+    int n = snprintf(body, sizeof(body), "{\"node\":\"%s\",\"pid\":%d}\n", q->node, (int)getpid());
+    ok = write_replace(q, q->node_path, body, (size_t)n);
+  }
+  if (!ok) {
+    logw("jobs: cannot use queue directory %s: %s", dir, strerror(errno));
+    free(q->dir);
+    free(q);
+    return NULL;
+  }
+
+#if defined(_WIN32)
+  q->thread = CreateThread(NULL, 0, heartbeat_thread, q, 0, NULL);
+  q->thread_running = q->thread != NULL;
+#else
+  q->thread_running = pthread_create(&q->thread, NULL, heartbeat_thread, q) == 0;
+#endif
+  if (!q->thread_running) logw("jobs: heartbeat thread failed to start; long titles may be reclaimed");
+
+  logi("jobs: queue %s as node %s (lease %ds, %d attempts)", dir, q->node, q->lease, q->max_attempts);
+  return q;
+}
+
+void jobq_close(JobQueue *q) {
+  if (!q) return;
+  atomic_store(&q->stop, true);
+  if (q->thread_running) {
+#if defined(_WIN32)
+    WaitForSingleObject(q->thread, INFINITE);
+    CloseHandle(q->thread);
+#else
+    pthread_join(q->thread, NULL);
+#endif
+  }
+  while (q->nheld > 0) {
+    char title[256];
+    snprintf(title, sizeof(title), "%s", q->held[0].title);
+    drop_claim(q, title);
+  }
+  unlink(q->node_path);
+  free(q->dir);
+  free(q);
+}
+
+const char *jobq_node(const JobQueue *q) {
+  return q ? q->node : "";
+}
+
+/* Takes over a claim whose lease ran out. A reclaim lock keeps two workers
+   from both deciding the same claim is stale and one of them deleting the
+   other's fresh claim; a lock left behind by a crash expires like a lease. */
+static bool reclaim_stale(JobQueue *q, const char *title, const char *path) {
+  char lock[JOBQ_PATH_MAX];
+  snprintf(lock, sizeof(lock), "%s.reclaim", path);
+  if (!create_exclusive(lock, q->token, strlen(q->token))) {
+    struct stat st;
+    if (errno == EEXIST && stat(lock, &st) == 0 && fs_now(q) - (long long)st.st_mtime > q->lease) {
+      unlink(lock);
+    }
+    return false;
+  }
+
+  bool taken = false;
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    taken = true;                          /* released meanwhile */
+  } else {
+    long long age = fs_now(q) - (long long)st.st_mtime;
+    if (age > q->lease) {
+      char owner[192];
+      claim_owner(path, owner, sizeof(owner));
+      char stale[JOBQ_PATH_MAX];
+      snprintf(stale, sizeof(stale), "%s/claims/%s.stale", q->dir, title);
+#if defined(_WIN32)
+      unlink(stale);
+#endif
+      if (rename(path, stale) == 0) {
+        logw("jobs: reclaiming %s from %s (lease expired %llds ago)", title, owner, age - q->lease);
+        taken = true;
+      }
+    }
+  }
+  unlink(lock);
+  return taken;
+}
+
+JobClaim jobq_claim(JobQueue *q, const char *title, char *info, size_t infosz) {
+  if (info && infosz) info[0] = 0;
+  if (!q) return JOB_ERROR;
+
+  char done[JOBQ_PATH_MAX], path[JOBQ_PATH_MAX];
+  done_path(q, title, done, sizeof(done));
+  claim_path(q, title, path, sizeof(path));
+  if (path_exists(done)) return JOB_DONE;
+
+  int attempts = failed_attempts(q, title);
+  if (attempts >= q->max_attempts) {
+    if (info) snprintf(info, infosz, "%d", attempts);
+    return JOB_GAVE_UP;
+  }
+
+  JsonWriter w;
+  jw_init(&w, 256);
+  jw_object_begin(&w);
+  jw_key(&w, "title");
+  jw_string(&w, title);
+  jw_key(&w, "node");
+  jw_string(&w, q->node);
+  jw_key(&w, "pid");
+  jw_int(&w, (long long)getpid());
+  jw_key(&w, "token");
+  jw_string(&w, q->token);
+  jw_key(&w, "claimed");
+  jw_int(&w, (long long)time(NULL));
+  jw_key(&w, "attempt");
+  jw_int(&w, attempts + 1);
+  jw_object_end(&w);
+  size_t len = 0;
+  char *body = jw_take(&w, &len);
+
+  JobClaim res = JOB_HELD;
+  for (int tries = 0; tries < 3; tries++) {
+    if (create_exclusive(path, body, len)) {
+      res = JOB_CLAIMED;
+      break;
+    }
+    if (errno != EEXIST) {
+      logw("jobs: cannot create %s: %s", path, strerror(errno));
+      res = JOB_ERROR;
+      break;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0) continue;    /* released between open and stat */
+    if (fs_now(q) - (long long)st.st_mtime <= q->lease || !reclaim_stale(q, title, path)) {
+      claim_owner(path, info, infosz);
+      break;
+    }
+  }
+  free(body);
+
+  if (res == JOB_CLAIMED) {
+    /* Someone may have finished it between our done check and the claim. */
+    if (path_exists(done)) {
+      unlink(path);
+      return JOB_DONE;
+    }
+    held_add(q, title);
+  }
+  return res;
+}
+
+static char *marker_json(const JobQueue *q, const char *title, int attempts, const char *detail,
+                         size_t *len) {
+  JsonWriter w;
+  jw_init(&w, 256);
+  jw_object_begin(&w);
+  jw_key(&w, "title");
+  jw_string(&w, title);
+  jw_key(&w, "node");
+  jw_string(&w, q->node);
+  jw_key(&w, "finished");
+  jw_int(&w, (long long)time(NULL));
+  if (attempts > 0) {
+    jw_key(&w, "attempts");
+    jw_int(&w, attempts);
+  }
+  jw_key(&w, "detail");
+  jw_string(&w, detail ? detail : "");
+  jw_object_end(&w);
+  return jw_take(&w, len);
+}
+
+void jobq_complete(JobQueue *q, const char *title, const char *detail) {
+  if (!q) return;
+  char path[JOBQ_PATH_MAX];
+  done_path(q, title, path, sizeof(path));
+  size_t len = 0;
+  char *body = marker_json(q, title, 0, detail, &len);
+  if (!write_replace(q, path, body, len)) logw("jobs: could not write %s", path);
+  free(body);
+
+  failed_path(q, title, path, sizeof(path));
+  unlink(path);
+  drop_claim(q, title);
+}
+
+void jobq_fail(JobQueue *q, const char *title, const char *detail) {
+  if (!q) return;
+  int attempts = failed_attempts(q, title) + 1;
+  char path[JOBQ_PATH_MAX];
+  failed_path(q, title, path, sizeof(path));
+  size_t len = 0;
+  char *body = marker_json(q, title, attempts, detail, &len);
+  if (!write_replace(q, path, body, len)) logw("jobs: could not write %s", path);
+  free(body);
+  if (attempts >= q->max_attempts) logw("jobs: giving up on %s after %d attempts", title, attempts);
+  drop_claim(q, title);
+}
+
+void jobq_release(JobQueue *q, const char *title) {
+  if (!q) return;
+  drop_claim(q, title);
+}
+
+bool jobq_lost(JobQueue *q, const char *title) {
+  if (!q) return false;
+  bool lost = false;
+  q_lock(q);
+  for (int i = 0; i < q->nheld; i++) {
+    if (strcmp(q->held[i].title, title) == 0) lost = q->held[i].lost;
+  }
+  q_unlock(q);
+  return lost;
+}
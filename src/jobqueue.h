@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Work queue shared by generator processes, on one host or several, through
+// a directory on a shared filesystem. Every process lists the same titles and
+// a title is worked on by whoever claims it first:
+//
+//   <dir>/claims/<title>.claim   created with O_EXCL by the owner; its mtime is the lease
+//   <dir>/done/<title>.json      written on success; nobody claims the title again
+//   <dir>/failed/<title>.json    failed attempts so far; retried until max_attempts
+//   <dir>/nodes/<node>.alive     touched on every heartbeat
+//
+// A background thread refreshes the claims this process holds every
+// lease/3 seconds. A claim that has not been refreshed for a whole lease
+// belongs to a crashed or hung worker and is taken over by the next process
+// that wants the title. Lease ages are measured against the mtime of our own
+// node file, i.e. on the file server's clock, so hosts need not agree on the
+// time.
+//
+// All functions are thread-safe.
+
+typedef struct JobQueue JobQueue;
+
+typedef enum {
+  JOB_CLAIMED = 0,  // ours; finish with jobq_complete(), jobq_fail() or jobq_release()
+  JOB_DONE,         // completed by some worker
+  JOB_HELD,         // another worker holds a live lease
+  JOB_GAVE_UP,      // failed max_attempts times
+  JOB_ERROR         // the queue directory is not usable
+} JobClaim;
+
+// node names this process in claim files and node files; NULL or "" = host
+// name. Returns NULL (after a warning) if the directory cannot be set up.
+// lease_seconds <= 0 means 60, max_attempts <= 0 means 3.
+JobQueue *jobq_open(const char *dir, const char *node, int lease_seconds, int max_attempts);
+
+// Stops the heartbeat and releases any claim still held.
+void jobq_close(JobQueue *q);
+
+const char *jobq_node(const JobQueue *q);
+
+// The node name jobq_open() would use: node, or the host name when NULL or
+// "", made safe for file names.
+void jobq_node_name(const char *node, char *out, size_t outsz);
+
+// info (may be NULL) receives the holder for JOB_HELD and the attempt count
+// for JOB_GAVE_UP.
+JobClaim jobq_claim(JobQueue *q, const char *title, char *info, size_t infosz);
+
+// Finish a claimed title: done for good, one more failed attempt, or back to
+// the pool untouched (cancelled runs).
+void jobq_complete(JobQueue *q, const char *title, const char *detail);
+void jobq_fail(JobQueue *q, const char *title, const char *detail);
+void jobq_release(JobQueue *q, const char *title);
+
+// True once another worker has taken the title over because our lease
+// lapsed (e.g. the host was suspended).
+bool jobq_lost(JobQueue *q, const char *title);
+
+#ifdef __cplusplus
+}
+#endif
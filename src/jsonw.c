@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "jsonw.h"
+#include "log.h"
+#include "textproc.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------ buffer ------------------------ */
+
+static void jw_reserve(JsonWriter *w, size_t extra) {
+  size_t need = w->len + extra + 1;
+  if (need <= w->cap) return;
+  size_t cap = w->cap ? w->cap : 1024;
+  while (cap < need) cap *= 2;
+  char *p = (char *)realloc(w->buf, cap);
+  if (!p) die("OOM");
+  w->buf = p;
+  w->cap = cap;
+}
+
+static void put(JsonWriter *w, const char *s, size_t n) {
+  jw_reserve(w, n);
+  memcpy(w->buf + w->len, s, n);
+  w->len += n;
+  w->buf[w->len] = 0;
+}
+
+static void put_c(JsonWriter *w, char c) {
+  jw_reserve(w, 1);
+  w->buf[w->len++] = c;
+  w->buf[w->len] = 0;
+}
+
+void jw_init(JsonWriter *w, size_t reserve) {
+  memset(w, 0, sizeof(*w));
+  jw_reserve(w, reserve ? reserve : 256);
+  w->buf[0] = 0;
+  w->first[0] = true;
+}
+
+void jw_free(JsonWriter *w) {
+  free(w->buf);
+  memset(w, 0, sizeof(*w));
+}
+
+char *jw_take(JsonWriter *w, size_t *len) {
+  char *out = w->buf;
+  if (len) *len = w->len;
+  memset(w, 0, sizeof(*w));
+  return out;
+}
+
+/* ------------------------ structure ------------------------ */
+
+/* Separator before a value (or a key) at the current level. */
+static void before_value(JsonWriter *w) {
+  if (w->after_key) {
+    w->after_key = false;
+    return;
+  }
+  if (!w->first[w->depth]) put_c(w, ',');
+  w->first[w->depth] = false;
+}
+
+static void open_level(JsonWriter *w, char c) {
+  before_value(w);
+  put_c(w, c);
+  if (w->depth + 1 >= JSONW_MAX_DEPTH) die("jsonw: nesting too deep");
+  w->depth++;
+  w->first[w->depth] = true;
+}
+
+static void close_level(JsonWriter *w, char c) {
+  if (w->depth > 0) w->depth--;
+  put_c(w, c);
+}
+
+void jw_object_begin(JsonWriter *w) { open_level(w, '{'); }
+void jw_object_end(JsonWriter *w)   { close_level(w, '}'); }
+void jw_array_begin(JsonWriter *w)  { open_level(w, '['); }
+void jw_array_end(JsonWriter *w)    { close_level(w, ']'); }
+
+/* ------------------------ strings ------------------------ */
+
+/* Escapes like cJSON's printer: quote, backslash and control characters;
+   everything else (including UTF-8) is copied as is. Worst-case room for a
+   4 KB slice is reserved before it, so the inner loop only writes bytes and
+   the buffer never grows far past the real body size. */
+#define ESCAPE_SLICE 4096u
+
+static void put_escaped(JsonWriter *w, const char *s, size_t n) {
+  static const char hex[] = "0123456789abcdef";
+  for (size_t base = 0; base < n; base += ESCAPE_SLICE) {
+    size_t m = n - base < ESCAPE_SLICE ? n - base : ESCAPE_SLICE;
+    jw_reserve(w, 6 * m);
+    char *o = w->buf + w->len;
+    for (const unsigned char *p = (const unsigned char *)s + base, *end = p + m; p < end; p++) {
+      unsigned char c = *p;
+      if (c >= 0x20 && c != '"' && c != '\\') {
+        *o++ = (char)c;
+        continue;
+      }
+      *o++ = '\\';
+      switch (c) {
+        case '"':  *o++ = '"'; break;
+        case '\\': *o++ = '\\'; break;
+        case '\b': *o++ = 'b'; break;
+        case '\f': *o++ = 'f'; break;
+        case '\n': *o++ = 'n'; break;
+        case '\r': *o++ = 'r'; break;
+        case '\t': *o++ = 't'; break;
+        default:
+          *o++ = 'u'; *o++ = '0'; *o++ = '0';
+          *o++ = hex[c >> 4]; *o++ = hex[c & 15];
+      }
+    }
+    w->len = (size_t)(o - w->buf);
+  }
+  if (w->buf) w->buf[w->len] = 0;
+}
+
+void jw_key(JsonWriter *w, const char *key) {
+  before_value(w);
+  put_c(w, '"');
+  put_escaped(w, key, strlen(key));
+  put(w, "\":", 2);
+  w->after_key = true;
+}
+
+void jw_string_begin(JsonWriter *w) {
+  before_value(w);
+  put_c(w, '"');
+}
+
+void jw_string_append(JsonWriter *w, const char *s, size_t n) {
+  put_escaped(w, s, n);
+}
+
+size_t jw_string_append_lossy(JsonWriter *w, const char *s, size_t n, size_t max_bytes) {
+  size_t i = 0, out = 0;
+  while (i < n && out < max_bytes) {
+    size_t run = utf8_valid_prefix_len(s + i, n - i);
+    if (run > max_bytes - out) {
+      run = max_bytes - out;
+      while (run > 0 && ((unsigned char)s[i + run] & 0xC0) == 0x80) run--;
+      put_escaped(w, s + i, run);
+      out += run;
+      break;
+    }
+    put_escaped(w, s + i, run);
+    out += run;
+    i += run;
+    if (i >= n) break;
+
+    /* Stray byte -> Latin-1 code point (two UTF-8 bytes, never escaped). */
+    if (max_bytes - out < 2) break;
+    unsigned char c = (unsigned char)s[i++];
+    char pair[2] = { (char)(c < 0xC0 ? 0xC2 : 0xC3), (char)(c < 0xC0 ? c : c - 0x40) };
+    put(w, pair, 2);
+    out += 2;
+  }
+  return out;
+}
+
+void jw_string_end(JsonWriter *w) {
+  put_c(w, '"');
+}
+
+void jw_string(JsonWriter *w, const char *s) {
+  jw_string_begin(w);
+  put_escaped(w, s ? s : "", s ? strlen(s) : 0);
+  jw_string_end(w);
+}
+
+void jw_int(JsonWriter *w, long long v) {
+  char tmp[32];
+  int n = snprintf(tmp, sizeof(tmp), "%lld", v);
+  before_value(w);
+  put(w, tmp, (size_t)n);
+}
+
+void jw_double(JsonWriter *w, double v) {
+  char tmp[32];
+  int n = isfinite(v) ? snprintf(tmp, sizeof(tmp), "%.3f", v) : snprintf(tmp, sizeof(tmp), "null");
+  before_value(w);
+  put(w, tmp, (size_t)n);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming JSON writer for request bodies. Values are escaped straight into
+// one growing buffer, so large text (subtitles, scripts) is copied exactly
+// once on its way into a request instead of going through a DOM and a printer.
+//
+// Commas are inserted automatically; the caller is responsible for pairing
+// begin/end calls and for emitting a key before each value inside objects.
+
+#define JSONW_MAX_DEPTH 16
+
+typedef struct {
+  char *buf;                // NUL-terminated, malloc'd
+  size_t len;
+  size_t cap;
+  int depth;
+  bool first[JSONW_MAX_DEPTH];
+  bool after_key;
+} JsonWriter;
+
+// reserve is the expected body size (0 if unknown).
+void jw_init(JsonWriter *w, size_t reserve);
+void jw_free(JsonWriter *w);
+
+// Hands the buffer to the caller (free() it) and resets the writer.
+char *jw_take(JsonWriter *w, size_t *len);
+
+void jw_object_begin(JsonWriter *w);
+void jw_object_end(JsonWriter *w);
+void jw_array_begin(JsonWriter *w);
+void jw_array_end(JsonWriter *w);
+
+void jw_key(JsonWriter *w, const char *key);
+void jw_string(JsonWriter *w, const char *s);
+void jw_int(JsonWriter *w, long long v);
+// Three decimals; NaN and infinities are written as null.
+void jw_double(JsonWriter *w, double v);
+
+// A string value assembled from several pieces.
+void jw_string_begin(JsonWriter *w);
+void jw_string_append(JsonWriter *w, const char *s, size_t n);
+
+// Appends text that may not be valid UTF-8: stray bytes are re-encoded as
+// Latin-1 code points (like sanitize_utf8_lossy) and at most max_bytes of
+// sanitized text are written, never splitting a character (like
+// trim_copy_utf8_safe). Returns the sanitized bytes written.
+size_t jw_string_append_lossy(JsonWriter *w, const char *s, size_t n, size_t max_bytes);
+
+void jw_string_end(JsonWriter *w);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,68 @@
+#include "log.h"
+#include "generator.h"
+#include "logring.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #define LOG_TLS __declspec(thread)
+#else
+  #define LOG_TLS _Thread_local
+#endif
+
+/* ------------------------ Log hook plumbing (for UI) ------------------------ */
+static GeneratorLogHook g_log_hook = NULL;
+static LOG_TLS const char *t_stage = NULL;
+
+void log_set_stage(const char *stage) {
+  t_stage = stage;
+}
+
+void generator_set_log_hook(GeneratorLogHook hook) {
+  g_log_hook = hook;
+}
+
+static void logv(LogLevel level, const char *fmt, va_list ap) {
+  const char *tag = log_level_tag(level);
+  char msg[2048];
+
+  va_list ap2;
+  va_copy(ap2, ap);
+  vsnprintf(msg, sizeof(msg), fmt, ap2);
+  va_end(ap2);
+
+  fprintf(stderr, "[%s] %s\n", tag, msg);
+  logring_push(level, t_stage, msg);
+
+  if (g_log_hook) {
+    char line[2200];
+    snprintf(line, sizeof(line), "[%s] %s", tag, msg);
+    g_log_hook(line);
+  }
+}
+
+void logi(const char *fmt, ...) {
+  va_list ap; va_start(ap, fmt); logv(LOG_LEVEL_INFO, fmt, ap); va_end(ap);
+}
+void logok(const char *fmt, ...) {
+  va_list ap; va_start(ap, fmt); logv(LOG_LEVEL_OK, fmt, ap); va_end(ap);
+}
+void logw(const char *fmt, ...) {
+  va_list ap; va_start(ap, fmt); logv(LOG_LEVEL_WARN, fmt, ap); va_end(ap);
+}
+
+void die(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  logv(LOG_LEVEL_FATAL, fmt, ap);
+  va_end(ap);
+  exit(1);
+}
+
+void log_hook_line(const char *line) {
+  logring_push(LOG_LEVEL_CMD, t_stage, line);
+  if (g_log_hook) g_log_hook(line);
+}
+
@@ -0,0 +1,28 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Tagged logging shared by the generator modules. Lines go to stderr, to the
+// lock-free record ring in logring.h (which the UI reads) and, when
+// installed, to the hook from generator_set_log_hook().
+
+void logi(const char *fmt, ...);
+void logok(const char *fmt, ...);
+void logw(const char *fmt, ...);
+
+// Logs a FATAL line and exits the process.
+void die(const char *fmt, ...);
+
+// Forwards a preformatted command line to the ring and the UI hook only (no
+// stderr copy).
+void log_hook_line(const char *line);
+
+// Tags later records from the calling thread with a pipeline stage name
+// (a string literal, e.g. from metrics_stage_name()); NULL clears it.
+void log_set_stage(const char *stage);
+
+#ifdef __cplusplus
+}
+#endif
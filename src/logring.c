@@ -0,0 +1,113 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "logring.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define RING_MASK ((uint64_t)LOGRING_CAPACITY - 1)
+
+/* Each slot carries a sequence word (a per-slot seqlock):
+     0          never written
+     2*t + 1    record t is being written
+     2*t + 2    record t is complete
+   Writers claim a ticket from g_head, then take their slot with a CAS so a
+   lapping writer can never interleave with a slow one. Readers copy the
+   record and re-check the word to detect an overwrite in between. */
+typedef struct {
+  _Atomic uint64_t state;
+  LogRecord rec;
+} Slot;
+
+static Slot g_slots[LOGRING_CAPACITY];
+static _Atomic uint64_t g_head = 0;
+
+const char *log_level_tag(LogLevel level) {
+  switch (level) {
+    case LOG_LEVEL_INFO:  return "INFO";
+    case LOG_LEVEL_OK:    return "OK";
+    case LOG_LEVEL_WARN:  return "WARN";
+    case LOG_LEVEL_FATAL: return "FATAL";
+    case LOG_LEVEL_CMD:   return "cmd";
+  }
+  return "?";
+}
+
+static double wall_now(void) {
+  struct timespec ts;
+  if (timespec_get(&ts, TIME_UTC) != TIME_UTC) return 0.0;
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void logring_push(LogLevel level, const char *stage, const char *text) {
+  uint64_t t = atomic_fetch_add_explicit(&g_head, 1, memory_order_relaxed);
+  Slot *s = &g_slots[t & RING_MASK];
+
+  uint64_t cur = atomic_load_explicit(&s->state, memory_order_relaxed);
+  for (;;) {
+    if (cur != 0 && (cur - 1) / 2 >= t) return;    /* a newer record already owns it */
+    if (cur & 1u) {                                /* previous lap still writing */
+      cur = atomic_load_explicit(&s->state, memory_order_relaxed);
+      continue;
+    }
+    if (atomic_compare_exchange_weak_explicit(&s->state, &cur, 2 * t + 1,
+                                              memory_order_acquire, memory_order_relaxed)) {
+      break;
+    }
+  }
+  atomic_thread_fence(memory_order_release);
+
+  LogRecord *r = &s->rec;
+  r->seq = t;
+  r->time = wall_now();
+  r->level = level;
+  snprintf(r->stage, sizeof(r->stage), "%s", stage ? stage : "");
+  snprintf(r->text, sizeof(r->text), "%s", text ? text : "");
+
+  atomic_store_explicit(&s->state, 2 * t + 2, memory_order_release);
+}
+
+uint64_t logring_head(void) {
+  return atomic_load_explicit(&g_head, memory_order_acquire);
+}
+
+size_t logring_read(uint64_t *cursor, LogRecord *out, size_t max, uint64_t *dropped) {
+  uint64_t c = *cursor, lost = 0;
+  size_t n = 0;
+
+  while (n < max) {
+    uint64_t head = atomic_load_explicit(&g_head, memory_order_acquire);
+    if (c >= head) break;
+    if (head - c > LOGRING_CAPACITY) {             /* lapped: skip to the oldest kept */
+      lost += head - LOGRING_CAPACITY - c;
+      c = head - LOGRING_CAPACITY;
+    }
+
+    Slot *s = &g_slots[c & RING_MASK];
+    uint64_t before = atomic_load_explicit(&s->state, memory_order_acquire);
+    if (before == 2 * c + 2) {
+      out[n] = s->rec;
+      atomic_thread_fence(memory_order_acquire);
+      uint64_t after = atomic_load_explicit(&s->state, memory_order_relaxed);
+      if (after == before) {
+        n++;
+        c++;
+        continue;
+      }
+      before = after;                              /* overwritten while copying */
+    }
+
+    if (before != 0 && (before - 1) / 2 > c) {     /* slot moved on: record lost */
+      lost++;
+      c++;
+      continue;
+    }
+    break;                                         /* record c still being written */
+  }
+
+  *cursor = c;
+  if (dropped) *dropped = lost;
+  return n;
+}
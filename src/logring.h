@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free ring of recent log records. Any thread publishes (logi/logw/...
+// do it for you); readers keep their own cursor and copy only records they
+// have not seen yet. Writers never wait for readers: a reader that falls more
+// than LOGRING_CAPACITY records behind skips ahead and is told how many it
+// missed.
+
+#define LOGRING_CAPACITY 1024      // power of two
+#define LOGRING_TEXT     480
+
+typedef enum {
+  LOG_LEVEL_INFO = 0,
+  LOG_LEVEL_OK,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_FATAL,
+  LOG_LEVEL_CMD                    // external command lines ("[cmd] ...")
+} LogLevel;
+
+typedef struct {
+  uint64_t seq;                    // 0-based publish order
+  double time;                     // wall clock, seconds since the epoch
+  LogLevel level;
+  char stage[16];                  // pipeline stage of the publishing thread, or ""
+  char text[LOGRING_TEXT];         // without the "[TAG] " prefix; truncated if longer
+} LogRecord;
+
+void logring_push(LogLevel level, const char *stage, const char *text);
+
+// Copies up to max records starting at *cursor (start at 0) and advances it.
+// *dropped (optional) receives how many records were overwritten before
+// they could be read. Returns the number copied.
+size_t logring_read(uint64_t *cursor, LogRecord *out, size_t max, uint64_t *dropped);
+
+// Sequence number the next record will get.
+uint64_t logring_head(void);
+
+const char *log_level_tag(LogLevel level);
+
+#ifdef __cplusplus
+}
+#endif
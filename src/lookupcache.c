@@ -0,0 +1,447 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "lookupcache.h"
+#include "log.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <io.h>
+  #define unlink _unlink
+#else
+  #include <fcntl.h>
+  #include <pthread.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define LC_MAGIC "MSLC0001"
+#define LC_INITIAL_SLOTS 1024u
+#define LC_KEY_MAX 256
+
+enum { SLOT_EMPTY = 0, SLOT_LIVE = 1, SLOT_DELETED = 2 };
+
+typedef struct {
+  char magic[8];
+  uint32_t nslots;
+  uint32_t used;           /* live + deleted: both lengthen probe chains */
+  uint32_t slot_size;
+  uint8_t reserved[44];
+} LcHeader;
+
+typedef struct {
+  uint64_t hash;
+  int64_t stored_at;
+  int64_t expires_at;
+  int32_t http_code;
+  uint8_t state;
+  uint8_t outcome;
+  uint16_t key_len;
+  char key[LC_KEY_MAX];
+  char source[32];
+  char value[640];
+  uint8_t pad[64];
+} LcSlot;
+
+_Static_assert(sizeof(LcHeader) == 64, "lookup cache header layout");
+_Static_assert(sizeof(LcSlot) == 1024, "lookup cache slot layout");
+
+struct LookupCache {
+  /* get/put/del from several worker threads. A mutex, not a spinlock: a
+     resize writes the whole table to disk while holding it. */
+#if defined(_WIN32)
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+  char *path;
+  bool busy;               /* storage_open: another process holds the file */
+  bool broken;             /* lost the table mid-run; every call is a no-op */
+  unsigned char *base;
+  size_t size;
+#if defined(_WIN32)
+  bool dirty;
+#else
+  int fd;
+#endif
+};
+
+#if defined(_WIN32)
+static void lc_lock_init(LookupCache *lc) { InitializeCriticalSection(&lc->lock); }
+static void lc_lock_free(LookupCache *lc) { DeleteCriticalSection(&lc->lock); }
+static void lc_lock(LookupCache *lc) { EnterCriticalSection(&lc->lock); }
+static void lc_unlock(LookupCache *lc) { LeaveCriticalSection(&lc->lock); }
+#else
+static void lc_lock_init(LookupCache *lc) { pthread_mutex_init(&lc->lock, NULL); }
+static void lc_lock_free(LookupCache *lc) { pthread_mutex_destroy(&lc->lock); }
+static void lc_lock(LookupCache *lc) { pthread_mutex_lock(&lc->lock); }
+static void lc_unlock(LookupCache *lc) { pthread_mutex_unlock(&lc->lock); }
+#endif
+
+static LcHeader *hdr(const LookupCache *lc) { return (LcHeader *)lc->base; }
+static LcSlot *slots(const LookupCache *lc) { return (LcSlot *)(lc->base + sizeof(LcHeader)); }
+
+static size_t file_bytes(uint32_t nslots) {
+  return sizeof(LcHeader) + (size_t)nslots * sizeof(LcSlot);
+}
+
+static uint64_t fnv1a(const char *s, size_t n) {
+  uint64_t h = 1469598103934665603ull;
+  for (size_t i = 0; i < n; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ull;
+  }
+  return h ? h : 1;
+}
+
+static void init_header(unsigned char *base, uint32_t nslots) {
+  LcHeader *h = (LcHeader *)base;
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, LC_MAGIC, 8);
+  h->nslots = nslots;
+  h->slot_size = (uint32_t)sizeof(LcSlot);
+}
+
+static bool header_valid(const unsigned char *base, size_t size) {
+  if (size < sizeof(LcHeader)) return false;
+  const LcHeader *h = (const LcHeader *)base;
+  return memcmp(h->magic, LC_MAGIC, 8) == 0 && h->slot_size == sizeof(LcSlot) &&
+         h->nslots > 0 && (h->nslots & (h->nslots - 1)) == 0 && size >= file_bytes(h->nslots);
+}
+
+/* ------------------------ storage backends ------------------------ */
+
+#if defined(_WIN32)
+
+static bool storage_open(LookupCache *lc, uint32_t nslots_if_new) {
+  FILE *f = fopen(lc->path, "rb");
+  if (f) {
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (n > 0) {
+      lc->base = (unsigned char *)malloc((size_t)n);
+      if (!lc->base) die("OOM");
+      lc->size = fread(lc->base, 1, (size_t)n, f);
+    }
+    fclose(f);
+    if (lc->base && header_valid(lc->base, lc->size)) return true;
+    free(lc->base);
+    lc->base = NULL;
+  }
+
+  lc->size = file_bytes(nslots_if_new);
+  lc->base = (unsigned char *)calloc(1, lc->size);
+  if (!lc->base) die("OOM");
+  init_header(lc->base, nslots_if_new);
+  lc->dirty = true;
+  return true;
+}
+
+static void storage_close(LookupCache *lc) {
+  if (lc->dirty) {
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.part", lc->path);
+    FILE *f = fopen(tmp, "wb");
+    bool ok = f && fwrite(lc->base, 1, lc->size, f) == lc->size;
+    if (f && fclose(f) != 0) ok = false;
+    if (ok) unlink(lc->path);
+    if (!ok || rename(tmp, lc->path) != 0) {
+      unlink(tmp);
+      logw("lookup cache: could not write %s", lc->path);
+    }
+  }
+  free(lc->base);
+  lc->base = NULL;
+}
+
+static void storage_touch(LookupCache *lc) { lc->dirty = true; }
+
+/* Swap in a freshly built table (already complete in memory). */
+static bool storage_replace(LookupCache *lc, unsigned char *fresh, size_t size) {
+  free(lc->base);
+  lc->base = fresh;
+  lc->size = size;
+  lc->dirty = true;
+  return true;
+}
+
+#else
+
+static bool map_fd(LookupCache *lc, int fd, size_t size) {
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) return false;
+  lc->base = (unsigned char *)p;
+  lc->size = size;
+  lc->fd = fd;
+  return true;
+}
+
+/* Exclusive for as long as the fd stays open; never waits. */
+static bool lock_fd(int fd) {
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+  return fcntl(fd, F_SETLK, &fl) == 0;
+}
+
+/* Opens and locks the file at lc->path. The holder may rename a rebuilt
+   table over the path (storage_replace) between our open and our lock, so
+   the locked file has to still be the one the path names. */
+static int open_locked(LookupCache *lc, struct stat *st) {
+  for (int attempt = 0; attempt < 3; attempt++) {
+    int fd = open(lc->path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    if (!lock_fd(fd)) {
+      close(fd);
+      lc->busy = true;
+      return -1;
+    }
+    struct stat cur;
+    if (fstat(fd, st) == 0 && stat(lc->path, &cur) == 0 && cur.st_ino == st->st_ino &&
+        cur.st_dev == st->st_dev) {
+      return fd;
+    }
+    close(fd);
+  }
+  return -1;
+}
+
+static bool storage_open(LookupCache *lc, uint32_t nslots_if_new) {
+  struct stat st;
+  int fd = open_locked(lc, &st);
+  if (fd < 0) return false;
+
+  if (st.st_size > 0) {
+    if (map_fd(lc, fd, (size_t)st.st_size) && header_valid(lc->base, lc->size)) return true;
+    if (lc->base) munmap(lc->base, lc->size);
+    lc->base = NULL;
+    logw("lookup cache: %s is not a valid cache file, starting over", lc->path);
+  }
+
+  size_t size = file_bytes(nslots_if_new);
+  if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0 || !map_fd(lc, fd, size)) {
+    close(fd);
+    return false;
+  }
+  init_header(lc->base, nslots_if_new);
+  return true;
+}
+
+static void storage_close(LookupCache *lc) {
+  if (lc->base) {
+    msync(lc->base, lc->size, MS_ASYNC);
+    munmap(lc->base, lc->size);
+    lc->base = NULL;
+  }
+  if (lc->fd >= 0) close(lc->fd);
+  lc->fd = -1;
+}
+
+static void storage_touch(LookupCache *lc) { (void)lc; }
+
+/* Writes the rebuilt table to a sibling file, renames it over the old one and
+   maps the result, so a crash mid-resize leaves the previous table intact. */
+static bool storage_replace(LookupCache *lc, unsigned char *fresh, size_t size) {
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.part", lc->path);
+
+  int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  bool ok = fd >= 0;
+  for (size_t off = 0; ok && off < size;) {
+    ssize_t w = write(fd, fresh + off, size - off);
+    if (w <= 0) ok = false;
+    else off += (size_t)w;
+  }
+  /* Locked before it takes the path, so nobody else can claim it. */
+  if (ok) ok = lock_fd(fd) && rename(tmp, lc->path) == 0;
+  free(fresh);
+
+  if (!ok) {
+    if (fd >= 0) close(fd);
+    unlink(tmp);
+    return false;
+  }
+
+  /* The old table is no longer the file's; without the new one there is
+     nothing left to use. */
+  storage_close(lc);
+  if (!map_fd(lc, fd, size)) {
+    close(fd);
+    lc->broken = true;
+    return false;
+  }
+  return true;
+}
+
+#endif
+
+/* ------------------------ hash table ------------------------ */
+
+static bool slot_expired(const LcSlot *s, long long now) {
+  return s->expires_at <= now;
+}
+
+/* Returns the live slot for key, or NULL. */
+static LcSlot *find(LookupCache *lc, const char *key, size_t klen, uint64_t h) {
+  uint32_t mask = hdr(lc)->nslots - 1;
+  LcSlot *tab = slots(lc);
+  for (uint32_t i = 0, idx = (uint32_t)h & mask; i <= mask; i++, idx = (idx + 1) & mask) {
+    LcSlot *s = &tab[idx];
+    if (s->state == SLOT_EMPTY) return NULL;
+    if (s->state == SLOT_LIVE && s->hash == h && s->key_len == klen && memcmp(s->key, key, klen) == 0) {
+      return s;
+    }
+  }
+  return NULL;
+}
+
+/* Rebuilds the table at the given size, dropping deleted and expired slots. */
+static bool rehash(LookupCache *lc, uint32_t nslots) {
+  long long now = (long long)time(NULL);
+  size_t size = file_bytes(nslots);
+  unsigned char *fresh = (unsigned char *)calloc(1, size);
+  if (!fresh) die("OOM");
+  init_header(fresh, nslots);
+
+  LcHeader *nh = (LcHeader *)fresh;
+  LcSlot *ntab = (LcSlot *)(fresh + sizeof(LcHeader));
+  const LcSlot *otab = slots(lc);
+  for (uint32_t i = 0; i < hdr(lc)->nslots; i++) {
+    const LcSlot *s = &otab[i];
+    if (s->state != SLOT_LIVE || slot_expired(s, now)) continue;
+    uint32_t idx = (uint32_t)s->hash & (nslots - 1);
+    while (ntab[idx].state != SLOT_EMPTY) idx = (idx + 1) & (nslots - 1);
+    ntab[idx] = *s;
+    nh->used++;
+  }
+
+  return storage_replace(lc, fresh, size);
+}
+
+LookupCache *lookup_open(const char *path) {
+  LookupCache *lc = (LookupCache *)calloc(1, sizeof(*lc));
+  if (!lc) die("OOM");
+#if !defined(_WIN32)
+  lc->fd = -1;
+#endif
+  lc->path = strdup(path);
+  if (!lc->path) die("OOM");
+
+  if (!storage_open(lc, LC_INITIAL_SLOTS)) {
+    if (lc->busy) logw("lookup cache: %s is in use by another process; lookups will not be cached", path);
+    else logw("lookup cache: cannot open %s; lookups will not be cached", path);
+    free(lc->path);
+    free(lc);
+    return NULL;
+  }
+  lc_lock_init(lc);
+  return lc;
+}
+
+bool lookup_get(LookupCache *lc, const char *key, LookupRecord *out) {
+  if (!lc) return false;
+  size_t klen = strlen(key);
+  if (klen > LC_KEY_MAX) return false;
+
+  lc_lock(lc);
+  const LcSlot *s = lc->broken ? NULL : find(lc, key, klen, fnv1a(key, klen));
+  if (!s || slot_expired(s, (long long)time(NULL))) {
+    lc_unlock(lc);
+    return false;
+  }
+
+  if (out) {
+    memset(out, 0, sizeof(*out));
+    out->outcome = (LookupOutcome)s->outcome;
+    out->http_code = s->http_code;
+    out->stored_at = s->stored_at;
+    out->expires_at = s->expires_at;
+    memcpy(out->source, s->source, sizeof(out->source) - 1);
+    memcpy(out->value, s->value, sizeof(out->value) - 1);
+  }
+  lc_unlock(lc);
+  return true;
+}
+
+void lookup_put(LookupCache *lc, const char *key, LookupOutcome outcome, int http_code,
+                const char *source, const char *value, long ttl_seconds) {
+  if (!lc) return;
+  size_t klen = strlen(key);
+  if (klen == 0 || klen > LC_KEY_MAX) return;
+  uint64_t h = fnv1a(key, klen);
+
+  lc_lock(lc);
+  if (lc->broken) {
+    lc_unlock(lc);
+    return;
+  }
+  LcSlot *s = find(lc, key, klen, h);
+  if (!s) {
+    /* Keep the table at most 70% occupied (live + deleted). */
+    LcHeader *hd = hdr(lc);
+    if ((uint64_t)(hd->used + 1) * 10 > (uint64_t)hd->nslots * 7) {
+      uint32_t n = hd->nslots;
+      size_t live = 0;
+      for (uint32_t i = 0; i < n; i++) live += slots(lc)[i].state == SLOT_LIVE;
+      if ((live + 1) * 10 > (size_t)n * 5) n *= 2;
+      if (!rehash(lc, n)) {
+        lc_unlock(lc);
+        if (lc->broken) logw("lookup cache: lost %s while resizing; lookups will not be cached", lc->path);
+        else logw("lookup cache: resize failed for %s", lc->path);
+        return;
+      }
+      hd = hdr(lc);
+    }
+
+    uint32_t mask = hd->nslots - 1;
+    uint32_t idx = (uint32_t)h & mask;
+    LcSlot *tab = slots(lc);
+    while (tab[idx].state == SLOT_LIVE) idx = (idx + 1) & mask;
+    s = &tab[idx];
+    if (s->state == SLOT_EMPTY) hd->used++;
+  }
+
+  long long now = (long long)time(NULL);
+  memset(s, 0, sizeof(*s));
+  s->hash = h;
+  s->stored_at = now;
+  s->expires_at = now + ttl_seconds;
+  s->http_code = http_code;
+  s->outcome = (uint8_t)outcome;
+  s->key_len = (uint16_t)klen;
+  memcpy(s->key, key, klen);
+  if (source) strncpy(s->source, source, sizeof(s->source) - 1);
+  if (value) strncpy(s->value, value, sizeof(s->value) - 1);
+  s->state = SLOT_LIVE;
+  storage_touch(lc);
+  lc_unlock(lc);
+}
+
+void lookup_del(LookupCache *lc, const char *key) {
+  if (!lc) return;
+  size_t klen = strlen(key);
+  if (klen > LC_KEY_MAX) return;
+  lc_lock(lc);
+  LcSlot *s = lc->broken ? NULL : find(lc, key, klen, fnv1a(key, klen));
+  if (s) {
+    s->state = SLOT_DELETED;
+    storage_touch(lc);
+  }
+  lc_unlock(lc);
+}
+
+void lookup_close(LookupCache *lc) {
+  if (!lc) return;
+  storage_close(lc);
+  lc_lock_free(lc);
+  free(lc->path);
+  free(lc);
+}
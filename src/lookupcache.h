@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Embedded store of external lookup outcomes (subtitle searches, IMSDb URL
+// probes), so a large backlog does not repeat known misses every run and can
+// reuse URLs that resolved before.
+//
+// One file holds a header and an open-addressing hash table of fixed-size
+// slots. On POSIX it is mmap'd and updated in place; elsewhere it is read on
+// open and written back on close. The file uses native byte order and is
+// meant for the local machine only. Calls are serialized internally, so the
+// worker threads of one run can share a cache; separate processes cannot. On
+// POSIX the first process to open the file holds an exclusive lock on it
+// until lookup_close(), and any other process gets NULL (runs uncached).
+
+typedef enum {
+  LOOKUP_MISS = 0,
+  LOOKUP_HIT = 1
+} LookupOutcome;
+
+typedef struct {
+  LookupOutcome outcome;
+  int http_code;
+  long long stored_at;       // unix seconds
+  long long expires_at;
+  char source[32];           // provider / variant that produced the result
+  char value[640];           // hit: resolved URL; miss: reason
+} LookupRecord;
+
+typedef struct LookupCache LookupCache;
+
+// Creates the file if needed. Returns NULL (after a warning) if it cannot be
+// opened or another process holds it; every function below accepts NULL and then behaves as an empty cache.
+LookupCache *lookup_open(const char *path);
+
+// False when the key is absent or its record has expired.
+bool lookup_get(LookupCache *lc, const char *key, LookupRecord *out);
+
+// Stores a record that expires ttl_seconds from now. Keys longer than the
+// slot allows are ignored.
+void lookup_put(LookupCache *lc, const char *key, LookupOutcome outcome, int http_code,
+                const char *source, const char *value, long ttl_seconds);
+
+void lookup_del(LookupCache *lc, const char *key);
+
+void lookup_close(LookupCache *lc);
+
+#ifdef __cplusplus
+}
+#endif
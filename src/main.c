@@ -1,5 +1,7 @@
 #include "raylib.h"
 #include "generator.h"
+#include "logring.h"
+#include "metrics.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,40 +11,95 @@
 #ifdef _WIN32
   #include <windows.h>
   #include <shellapi.h>
-  static CRITICAL_SECTION g_log_lock;
-  static void log_lock_init(void) { InitializeCriticalSection(&g_log_lock); }
-  static void log_lock(void) { EnterCriticalSection(&g_log_lock); }
-  static void log_unlock(void) { LeaveCriticalSection(&g_log_lock); }
+  static CRITICAL_SECTION g_progress_lock;
+  static void progress_lock_init(void) { InitializeCriticalSection(&g_progress_lock); }
+  static void progress_lock(void) { EnterCriticalSection(&g_progress_lock); }
+  static void progress_unlock(void) { LeaveCriticalSection(&g_progress_lock); }
 #else
   #include <pthread.h>
   #include <unistd.h>   // getcwd
-  static pthread_mutex_t g_log_lock = PTHREAD_MUTEX_INITIALIZER;
-  static void log_lock_init(void) { /* nothing */ }
-  static void log_lock(void) { pthread_mutex_lock(&g_log_lock); }
-  static void log_unlock(void) { pthread_mutex_unlock(&g_log_lock); }
+  static pthread_mutex_t g_progress_lock = PTHREAD_MUTEX_INITIALIZER;
+  static void progress_lock_init(void) { /* nothing */ }
+  static void progress_lock(void) { pthread_mutex_lock(&g_progress_lock); }
+  static void progress_unlock(void) { pthread_mutex_unlock(&g_progress_lock); }
 #endif
 
-static volatile int g_running = 0;
-static volatile int g_last_rc = 0;
+static Generator *g_gen = NULL;
 
 #define LOG_MAX_LINES 300
 #define LOG_LINE_MAX  600
 
-static char g_log[LOG_MAX_LINES][LOG_LINE_MAX];
-static int  g_log_head = 0;
-static int  g_log_count = 0;
+// Lines shown in the log panel. Only the render thread touches these: new
+// records are pulled from the lock-free log ring once per frame.
+static LogRecord g_log[LOG_MAX_LINES];
+static int       g_log_head = 0;
+static int       g_log_count = 0;
+static uint64_t  g_log_cursor = 0;
 
 // UI font
 static Font g_uiFont = {0};
 static const float g_uiSpacing = 1.0f;
 
-static void ui_log_hook(const char *line) {
-  if (!line) return;
-  log_lock();
-  snprintf(g_log[g_log_head], LOG_LINE_MAX, "%s", line);
+static void log_append(const LogRecord *r) {
+  g_log[g_log_head] = *r;
   g_log_head = (g_log_head + 1) % LOG_MAX_LINES;
   if (g_log_count < LOG_MAX_LINES) g_log_count++;
-  log_unlock();
+}
+
+static void log_clear(void) {
+  g_log_head = 0;
+  g_log_count = 0;
+  g_log_cursor = logring_head();
+}
+
+// Pulls records published since the last frame.
+static void log_poll(void) {
+  LogRecord batch[32];
+  for (;;) {
+    uint64_t dropped = 0;
+    size_t n = logring_read(&g_log_cursor, batch, 32, &dropped);
+    if (dropped) {
+      LogRecord gap = { .level = LOG_LEVEL_WARN };
+      snprintf(gap.text, sizeof(gap.text), "(%llu log lines skipped)", (unsigned long long)dropped);
+      log_append(&gap);
+    }
+    for (size_t i = 0; i < n; i++) log_append(&batch[i]);
+    if (n < 32) break;
+  }
+}
+
+// Encoders currently reporting progress; written by the generator thread
+// through the progress hook, read by the dashboard under the progress lock.
+#define DASH_MAX_ENCODES 8
+
+typedef struct {
+  bool used;
+  GeneratorProgress p;
+} EncodeRow;
+
+static EncodeRow g_encodes[DASH_MAX_ENCODES];
+
+static void ui_progress_hook(const GeneratorProgress *p) {
+  progress_lock();
+  int slot = -1, free_slot = -1;
+  for (int i = 0; i < DASH_MAX_ENCODES; i++) {
+    EncodeRow *row = &g_encodes[i];
+    if (!row->used) {
+      if (free_slot < 0) free_slot = i;
+    } else if (row->p.clip == p->clip && strcmp(row->p.stage, p->stage) == 0) {
+      slot = i;
+    }
+  }
+  if (p->done) {
+    if (slot >= 0) g_encodes[slot].used = false;
+  } else {
+    if (slot < 0) slot = free_slot;
+    if (slot >= 0) {
+      g_encodes[slot].used = true;
+      g_encodes[slot].p = *p;
+    }
+  }
+  progress_unlock();
 }
 
 /* Portable "where am I running from?" */
@@ -107,37 +164,17 @@ static bool draw_button(Font font, Rectangle r, const char *label, bool enabled,
   return hot && IsMouseButtonReleased(MOUSE_LEFT_BUTTON);
 }
 
-#ifdef _WIN32
-static DWORD WINAPI worker_thread(LPVOID p) {
-  (void)p;
-  g_running = 1;
-  generator_set_log_hook(ui_log_hook);
-  g_last_rc = run_generation();
-  generator_set_log_hook(NULL);
-  g_running = 0;
-  return 0;
-}
-static void start_generation_thread(void) {
-  if (g_running) return;
-  HANDLE h = CreateThread(NULL, 0, worker_thread, NULL, 0, NULL);
-  if (h) CloseHandle(h);
-}
-#else
-static void *worker_thread(void *p) {
-  (void)p;
-  g_running = 1;
-  generator_set_log_hook(ui_log_hook);
-  g_last_rc = run_generation();
-  generator_set_log_hook(NULL);
-  g_running = 0;
-  return NULL;
-}
-static void start_generation_thread(void) {
-  if (g_running) return;
-  pthread_t t;
-  if (pthread_create(&t, NULL, worker_thread, NULL) == 0) pthread_detach(t);
+static const char *state_label(GeneratorState st) {
+  switch (st) {
+    case GENERATOR_IDLE:       return "IDLE";
+    case GENERATOR_RUNNING:    return "RUNNING";
+    case GENERATOR_PAUSED:     return "PAUSED";
+    case GENERATOR_CANCELLING: return "CANCELLING";
+    case GENERATOR_FINISHED:   return "FINISHED";
+    case GENERATOR_CANCELLED:  return "CANCELLED";
+  }
+  return "?";
 }
-#endif
 
 static void draw_log_panel(Font font, Rectangle r) {
   DrawRectangleRec(r, (Color){18, 18, 18, 255});
@@ -150,38 +187,202 @@ static void draw_log_panel(Font font, Rectangle r) {
   int maxLines = (int)((r.height - 2*pad) / (float)lineH);
   if (maxLines < 1) maxLines = 1;
 
-  // snapshot log under lock
-  char lines[LOG_MAX_LINES][LOG_LINE_MAX];
-  int count = 0;
-
-  log_lock();
-  count = g_log_count;
-  int head = g_log_head;
-  for (int i = 0; i < count; i++) {
-    int idx = (head - count + i);
-    while (idx < 0) idx += LOG_MAX_LINES;
-    idx %= LOG_MAX_LINES;
-    snprintf(lines[i], LOG_LINE_MAX, "%s", g_log[idx]);
-  }
-  log_unlock();
+  log_poll();
 
   int start = 0;
-  if (count > maxLines) start = count - maxLines;
+  if (g_log_count > maxLines) start = g_log_count - maxLines;
 
   BeginScissorMode((int)r.x, (int)r.y, (int)r.width, (int)r.height);
   float y = r.y + (float)pad;
-  for (int i = start; i < count; i++) {
-    DrawTextEx(font, lines[i], (Vector2){r.x + (float)pad, y}, fontSize, g_uiSpacing, (Color){210, 210, 210, 255});
+  for (int i = start; i < g_log_count; i++) {
+    int idx = (g_log_head - g_log_count + i + LOG_MAX_LINES) % LOG_MAX_LINES;
+    const LogRecord *rec = &g_log[idx];
+
+    char line[LOG_LINE_MAX];
+    if (rec->level == LOG_LEVEL_CMD) snprintf(line, sizeof(line), "%s", rec->text);
+    else snprintf(line, sizeof(line), "[%s] %s", log_level_tag(rec->level), rec->text);
+
+    Color c = (Color){210, 210, 210, 255};
+    if (rec->level == LOG_LEVEL_WARN || rec->level == LOG_LEVEL_FATAL) c = (Color){240, 190, 110, 255};
+    else if (rec->level == LOG_LEVEL_OK) c = (Color){150, 220, 150, 255};
+    else if (rec->level == LOG_LEVEL_CMD) c = (Color){140, 140, 140, 255};
+
+    DrawTextEx(font, line, (Vector2){r.x + (float)pad, y}, fontSize, g_uiSpacing, c);
     y += (float)lineH;
   }
   EndScissorMode();
 }
 
+/* ---- dashboard ---- */
+
+static void fmt_duration(char *out, size_t outsz, double s) {
+  if (s < 0.0) { snprintf(out, outsz, "n/a"); return; }
+  long t = (long)(s + 0.5);
+  if (t >= 3600) snprintf(out, outsz, "%ldh%02ldm", t / 3600, (t / 60) % 60);
+  else if (t >= 60) snprintf(out, outsz, "%ldm%02lds", t / 60, t % 60);
+  else snprintf(out, outsz, "%lds", t);
+}
+
+static void draw_bar(Rectangle r, double frac, Color fill) {
+  if (frac < 0.0) frac = 0.0;
+  if (frac > 1.0) frac = 1.0;
+  DrawRectangleRec(r, (Color){40, 40, 40, 255});
+  DrawRectangleRec((Rectangle){r.x, r.y, r.width * (float)frac, r.height}, fill);
+}
+
+static void draw_dash_text(Font font, const char *text, float x, float y, float size, Color c) {
+  DrawTextEx(font, text, (Vector2){x, y}, size, g_uiSpacing, c);
+}
+
+// Whole-batch estimate: mean movie time (from this process' history) for the
+// movies still queued, plus whatever the current one is expected to need.
+static double batch_eta(const GeneratorStatus *gs) {
+  unsigned long long n = 0;
+  double sum = 0.0;
+  metrics_stage_totals(STAGE_MOVIE, &n, &sum);
+  if (n == 0) return -1.0;
+
+  double mean = sum / (double)n;
+  int remaining = gs->movies_queued - gs->movies_finished;
+  if (remaining <= 0) return 0.0;
+
+  double eta = mean * (double)(remaining - (gs->movie[0] ? 1 : 0));
+  if (gs->movie[0]) eta += mean > gs->movie_elapsed_s ? mean - gs->movie_elapsed_s : 0.0;
+  return eta;
+}
+
+static void draw_dashboard(Font font, Rectangle r, const GeneratorStatus *gs, bool active) {
+  DrawRectangleRec(r, (Color){18, 18, 18, 255});
+  DrawRectangleLinesEx(r, 2.0f, (Color){40, 40, 40, 255});
+
+  const Color text = (Color){210, 210, 210, 255};
+  const Color dim = (Color){140, 140, 140, 255};
+  const Color blue = (Color){70, 120, 200, 255};
+  const Color green = (Color){90, 170, 110, 255};
+  const Color amber = (Color){220, 160, 70, 255};
+  const float x = r.x + 10.0f;
+  const float w = r.width - 20.0f;
+  float y = r.y + 10.0f;
+  char line[320], a[32], b[32];
+
+  BeginScissorMode((int)r.x, (int)r.y, (int)r.width, (int)r.height);
+
+  // Batch
+  snprintf(line, sizeof(line), "Batch  %d/%d movies  (%d ok)",
+           gs->movies_finished, gs->movies_queued, gs->movies_done);
+  draw_dash_text(font, line, x, y, 16, text);
+  y += 20;
+  draw_bar((Rectangle){x, y, w, 8},
+           gs->movies_queued > 0 ? (double)gs->movies_finished / gs->movies_queued : 0.0, blue);
+  y += 14;
+
+  fmt_duration(a, sizeof(a), gs->run_elapsed_s);
+  fmt_duration(b, sizeof(b), active ? batch_eta(gs) : -1.0);
+  double clips_per_min = 0.0;
+  {
+    unsigned long long n = 0;
+    double sum = 0.0;
+    metrics_stage_totals(STAGE_CLIP, &n, &sum);
+    // Wall-clock throughput over the run; clips overlap, so not sum/n.
+    if (gs->run_elapsed_s > 1.0) clips_per_min = (double)n * 60.0 / gs->run_elapsed_s;
+  }
+  snprintf(line, sizeof(line), "elapsed %s   eta %s   %.1f clips/min", a, b, clips_per_min);
+  draw_dash_text(font, line, x, y, 14, dim);
+  y += 18;
+
+  snprintf(line, sizeof(line), "queue: %lld movies, %lld clips   workers: %lld",
+           metrics_gauge_get(METRIC_QUEUE_MOVIES), metrics_gauge_get(METRIC_QUEUE_CLIPS),
+           metrics_gauge_get(METRIC_ACTIVE_WORKERS));
+  draw_dash_text(font, line, x, y, 14, dim);
+  y += 26;
+
+  // Current movie
+  if (active && gs->movie[0]) {
+    snprintf(line, sizeof(line), "%s", gs->movie);
+    draw_dash_text(font, line, x, y, 16, text);
+    y += 20;
+    fmt_duration(a, sizeof(a), gs->movie_elapsed_s);
+    snprintf(line, sizeof(line), "stage %s   %s", gs->stage[0] ? gs->stage : "-", a);
+    draw_dash_text(font, line, x, y, 14, dim);
+    y += 18;
+
+    if (gs->clips_planned > 0) {
+      int clips_done = gs->clips_built + gs->clips_failed;
+      snprintf(line, sizeof(line), "clips %d/%d  (%d failed)   encoders %d",
+               clips_done, gs->clips_planned, gs->clips_failed, gs->encoders_active);
+      draw_dash_text(font, line, x, y, 14, dim);
+      y += 18;
+      draw_bar((Rectangle){x, y, w, 8}, (double)clips_done / gs->clips_planned,
+               gs->clips_failed ? amber : green);
+      y += 14;
+    }
+  } else {
+    draw_dash_text(font, active ? "between movies" : "idle", x, y, 16, dim);
+    y += 20;
+  }
+  y += 8;
+
+  // Encoders
+  EncodeRow rows[DASH_MAX_ENCODES];
+  progress_lock();
+  memcpy(rows, g_encodes, sizeof(rows));
+  progress_unlock();
+
+  draw_dash_text(font, "Encoders", x, y, 16, text);
+  y += 20;
+  int shown = 0;
+  for (int i = 0; active && i < DASH_MAX_ENCODES; i++) {
+    const GeneratorProgress *p = &rows[i].p;
+    if (!rows[i].used) continue;
+
+    if (p->clip) snprintf(a, sizeof(a), "clip %d", p->clip);
+    else snprintf(a, sizeof(a), "%s", p->stage);
+    if (p->eta_s >= 0.0) fmt_duration(b, sizeof(b), p->eta_s);
+    else snprintf(b, sizeof(b), "?");
+    snprintf(line, sizeof(line), "%-8s %.0f fps  %.2fx  eta %s", a, p->fps, p->speed, b);
+    draw_dash_text(font, line, x, y, 14, p->speed > 0.0 && p->speed < 1.0 ? amber : dim);
+    y += 17;
+    draw_bar((Rectangle){x, y, w, 5}, p->total_s > 0.0 ? p->out_time_s / p->total_s : 0.0, blue);
+    y += 10;
+    shown++;
+  }
+  if (!shown) {
+    draw_dash_text(font, "none", x, y, 14, dim);
+    y += 17;
+  }
+  y += 8;
+
+  // Stage breakdown: share of total time per stage, so the bottleneck stands out.
+  draw_dash_text(font, "Stages (count, mean)", x, y, 16, text);
+  y += 20;
+  unsigned long long counts[STAGE_MOVIE];
+  double sums[STAGE_MOVIE], total = 0.0, top = 0.0;
+  for (int s = 0; s < STAGE_MOVIE; s++) {
+    metrics_stage_totals((MetricsStage)s, &counts[s], &sums[s]);
+    total += sums[s];
+    if (sums[s] > top) top = sums[s];
+  }
+  for (int s = 0; s < STAGE_MOVIE; s++) {
+    if (counts[s] == 0) continue;
+    fmt_duration(a, sizeof(a), sums[s] / (double)counts[s]);
+    snprintf(line, sizeof(line), "%-9s %4llu  %s", metrics_stage_name((MetricsStage)s), counts[s], a);
+    bool hot = sums[s] == top;
+    draw_dash_text(font, line, x, y, 14, hot ? amber : dim);
+    draw_bar((Rectangle){x + w * 0.6f, y + 4, w * 0.4f, 8}, total > 0.0 ? sums[s] / total : 0.0,
+             hot ? amber : blue);
+    y += 17;
+  }
+  if (total <= 0.0) draw_dash_text(font, "no timings yet", x, y, 14, dim);
+
+  EndScissorMode();
+}
+
 int main(void) {
-  log_lock_init();
+  progress_lock_init();
+  generator_set_progress_hook(ui_progress_hook);
 
   SetConfigFlags(FLAG_WINDOW_RESIZABLE);
-  InitWindow(920, 560, "C-AI Movie Shorts");
+  InitWindow(1200, 640, "C-AI Movie Shorts");
   SetTargetFPS(60);
 
   // Load Inter Regular from resources/
@@ -209,31 +410,56 @@ int main(void) {
 
     //DrawTextEx(g_uiFont, "Generation", (Vector2){30, 240}, 24, g_uiSpacing, RAYWHITE);
 
-    bool canStart = (g_running == 0);
-    const char *startLabel = canStart ? "START GENERATION" : "RUNNING...";
-    if (draw_button(g_uiFont, (Rectangle){30, 280, 260, 70}, startLabel, canStart, 22)) {
+    GeneratorStatus gs = generator_status(g_gen);
+    bool active = gs.state == GENERATOR_RUNNING || gs.state == GENERATOR_PAUSED ||
+                  gs.state == GENERATOR_CANCELLING;
+
+    const char *startLabel = active ? "RUNNING..." : "START GENERATION";
+    if (draw_button(g_uiFont, (Rectangle){30, 280, 260, 44}, startLabel, !active, 20)) {
       // clear UI log before run
-      log_lock();
-      g_log_head = 0;
-      g_log_count = 0;
-      log_unlock();
+      log_clear();
+      progress_lock();
+      memset(g_encodes, 0, sizeof(g_encodes));
+      progress_unlock();
+
+      generator_free(g_gen);
+      g_gen = generator_start();
+    }
 
-      start_generation_thread();
+    bool paused = gs.state == GENERATOR_PAUSED;
+    bool canControl = gs.state == GENERATOR_RUNNING || paused;
+    if (draw_button(g_uiFont, (Rectangle){30, 334, 125, 36}, paused ? "RESUME" : "PAUSE", canControl, 16)) {
+      if (paused) generator_resume(g_gen);
+      else generator_pause(g_gen);
+    }
+    if (draw_button(g_uiFont, (Rectangle){165, 334, 125, 36}, "CANCEL", canControl, 16)) {
+      generator_cancel(g_gen);
     }
 
     char status[256];
-    snprintf(status, sizeof(status),
-             "Status: %s   (last exit code: %d)",
-             (g_running ? "RUNNING" : "IDLE"),
-             (int)g_last_rc);
-    DrawTextEx(g_uiFont, status, (Vector2){30, 370}, 18, g_uiSpacing, (Color){220, 220, 220, 255});
+    if (active || gs.state == GENERATOR_IDLE) {
+      snprintf(status, sizeof(status), "Status: %s   (%d/%d movies)",
+               state_label(gs.state), gs.movies_done, gs.movies_queued);
+    } else {
+      snprintf(status, sizeof(status), "Status: %s   (processed: %d)",
+               state_label(gs.state), gs.result);
+    }
+    DrawTextEx(g_uiFont, status, (Vector2){30, 385}, 18, g_uiSpacing, (Color){220, 220, 220, 255});
 
     DrawTextEx(g_uiFont, "Log", (Vector2){320, 20}, 24, g_uiSpacing, RAYWHITE);
-    draw_log_panel(g_uiFont, (Rectangle){320, 60, 570, 470});
+    draw_log_panel(g_uiFont, (Rectangle){320, 60, 520, 560});
+
+    DrawTextEx(g_uiFont, "Pipeline", (Vector2){860, 20}, 24, g_uiSpacing, RAYWHITE);
+    draw_dashboard(g_uiFont, (Rectangle){860, 60, 320, 560}, &gs, active);
 
     EndDrawing();
   }
 
+  // Stop a running batch cleanly: encoders are terminated and nothing
+  // half-written is left in output/.
+  generator_free(g_gen);
+  generator_set_progress_hook(NULL);
+
   UnloadFont(g_uiFont);
   CloseWindow();
   return 0;
@@ -0,0 +1,426 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+  #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+#else
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <poll.h>
+  #include <pthread.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+#endif
+
+#define METRICS_PREFIX "movie_shorts_"
+
+/* ------------------------ storage ------------------------ */
+
+/* Upper bounds in seconds; the implicit last bucket is +Inf. */
+static const double k_stage_bounds[] = {
+  0.1, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600, 1800, 3600
+};
+#define STAGE_BUCKETS (sizeof(k_stage_bounds) / sizeof(k_stage_bounds[0]))
+
+static const double k_clip_bounds[] = { 0, 5, 10, 15, 20, 25, 30, 40, 50 };
+#define CLIP_BUCKETS (sizeof(k_clip_bounds) / sizeof(k_clip_bounds[0]))
+
+/* Each histogram sits on its own cache line(s) so unrelated stages updated
+   from different workers don't false-share. Buckets are stored non-cumulative
+   and summed at render time, so an observation is exactly two atomic adds. */
+typedef struct {
+  _Alignas(64) atomic_ullong buckets[STAGE_BUCKETS + 1];
+  atomic_ullong count;
+  atomic_ullong sum_us;
+} StageHist;
+
+typedef struct {
+  _Alignas(64) atomic_ullong buckets[CLIP_BUCKETS + 1];
+  atomic_ullong count;
+  atomic_ullong sum;
+} ClipHist;
+
+static _Alignas(64) atomic_ullong g_counters[METRIC_COUNTER_COUNT];
+static _Alignas(64) atomic_llong  g_gauges[METRIC_GAUGE_COUNT];
+static _Alignas(64) atomic_ullong g_encode_us;
+static StageHist g_stage[STAGE_COUNT];
+static ClipHist  g_clips;
+
+static const char *k_counter_names[METRIC_COUNTER_COUNT] = {
+  "movies_processed_total",
+  "movies_failed_total",
+  "clips_built_total",
+  "clips_failed_total",
+  "http_requests_total",
+  "http_errors_total",
+  "http_retries_total",
+  "bytes_downloaded_total",
+  "tts_characters_total",
+  "runs_total",
+};
+
+static const char *k_counter_help[METRIC_COUNTER_COUNT] = {
+  "Movies that produced an output video.",
+  "Movies that failed before producing an output video.",
+  "Clips successfully encoded.",
+  "Clips skipped because TTS or encoding failed.",
+  "HTTP transfers performed.",
+  "HTTP transfers that failed at the transport level.",
+  "HTTP transfers retried after a failure.",
+  "Response bytes received over HTTP.",
+  "Characters sent to text-to-speech.",
+  "Completed run_generation() passes.",
+};
+
+static const char *k_gauge_names[METRIC_GAUGE_COUNT] = {
+  "movies_queued",
+  "clips_queued",
+  "active_workers",
+};
+
+static const char *k_gauge_help[METRIC_GAUGE_COUNT] = {
+  "Movies waiting to be processed in the current run.",
+  "Clips waiting to be built for the current movie.",
+  "Workers currently processing a movie.",
+};
+
+static const char *k_stage_names[STAGE_COUNT] = {
+  "subtitles", "script", "plan", "tts", "clip",
+  "concat", "bgm", "mix", "vertical", "preview", "movie",
+};
+
+/* ------------------------ updates ------------------------ */
+
+double metrics_now(void) {
+#if defined(_WIN32)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER now;
+  if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&now);
+  return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+static unsigned long long seconds_to_us(double s) {
+  if (!(s > 0.0)) return 0;
+  return (unsigned long long)(s * 1e6 + 0.5);
+}
+
+void metrics_inc(MetricsCounter c, unsigned long long n) {
+  if ((unsigned)c >= METRIC_COUNTER_COUNT) return;
+  atomic_fetch_add_explicit(&g_counters[c], n, memory_order_relaxed);
+}
+
+void metrics_gauge_set(MetricsGauge g, long long v) {
+  if ((unsigned)g >= METRIC_GAUGE_COUNT) return;
+  atomic_store_explicit(&g_gauges[g], v, memory_order_relaxed);
+}
+
+void metrics_gauge_add(MetricsGauge g, long long delta) {
+  if ((unsigned)g >= METRIC_GAUGE_COUNT) return;
+  atomic_fetch_add_explicit(&g_gauges[g], delta, memory_order_relaxed);
+}
+
+void metrics_observe_stage(MetricsStage s, double seconds) {
+  if ((unsigned)s >= STAGE_COUNT) return;
+  if (seconds < 0.0) seconds = 0.0;
+
+  size_t b = 0;
+  while (b < STAGE_BUCKETS && seconds > k_stage_bounds[b]) b++;
+
+  StageHist *h = &g_stage[s];
+  atomic_fetch_add_explicit(&h->buckets[b], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->sum_us, seconds_to_us(seconds), memory_order_relaxed);
+}
+
+void metrics_observe_clips_per_movie(size_t clips) {
+  size_t b = 0;
+  while (b < CLIP_BUCKETS && (double)clips > k_clip_bounds[b]) b++;
+
+  atomic_fetch_add_explicit(&g_clips.buckets[b], 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&g_clips.count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&g_clips.sum, (unsigned long long)clips, memory_order_relaxed);
+}
+
+void metrics_add_encode_seconds(double seconds) {
+  atomic_fetch_add_explicit(&g_encode_us, seconds_to_us(seconds), memory_order_relaxed);
+}
+
+const char *metrics_stage_name(MetricsStage s) {
+  if ((unsigned)s >= STAGE_COUNT) return "unknown";
+  return k_stage_names[s];
+}
+
+unsigned long long metrics_counter_get(MetricsCounter c) {
+  if ((unsigned)c >= METRIC_COUNTER_COUNT) return 0;
+  return atomic_load_explicit(&g_counters[c], memory_order_relaxed);
+}
+
+long long metrics_gauge_get(MetricsGauge g) {
+  if ((unsigned)g >= METRIC_GAUGE_COUNT) return 0;
+  return atomic_load_explicit(&g_gauges[g], memory_order_relaxed);
+}
+
+double metrics_encode_seconds(void) {
+  return (double)atomic_load_explicit(&g_encode_us, memory_order_relaxed) / 1e6;
+}
+
+void metrics_stage_totals(MetricsStage s, unsigned long long *count_out, double *sum_out) {
+  unsigned long long cnt = 0, us = 0;
+  if ((unsigned)s < STAGE_COUNT) {
+    cnt = atomic_load_explicit(&g_stage[s].count, memory_order_relaxed);
+    us  = atomic_load_explicit(&g_stage[s].sum_us, memory_order_relaxed);
+  }
+  if (count_out) *count_out = cnt;
+  if (sum_out) *sum_out = (double)us / 1e6;
+}
+
+/* ------------------------ exposition ------------------------ */
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} TextBuf;
+
+static void tb_printf(TextBuf *tb, const char *fmt, ...) {
+  for (;;) {
+    size_t room = tb->cap - tb->len;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tb->data ? tb->data + tb->len : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n < room) { tb->len += (size_t)n; return; }
+
+    size_t want = tb->cap ? tb->cap * 2 : 8192;
+    while (want < tb->len + (size_t)n + 1) want *= 2;
+    char *p = (char *)realloc(tb->data, want);
+    if (!p) return;
+    tb->data = p;
+    tb->cap = want;
+  }
+}
+
+static void fmt_bound(char *out, size_t outsz, double v) {
+  snprintf(out, outsz, "%g", v);
+}
+
+char *metrics_render_text(size_t *len_out) {
+  TextBuf tb = {0};
+
+  for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+    unsigned long long v = atomic_load_explicit(&g_counters[c], memory_order_relaxed);
+    tb_printf(&tb, "# HELP " METRICS_PREFIX "%s %s\n", k_counter_names[c], k_counter_help[c]);
+    tb_printf(&tb, "# TYPE " METRICS_PREFIX "%s counter\n", k_counter_names[c]);
+    tb_printf(&tb, METRICS_PREFIX "%s %llu\n", k_counter_names[c], v);
+  }
+
+  tb_printf(&tb, "# HELP " METRICS_PREFIX "encode_seconds_total Wall time spent in FFmpeg.\n");
+  tb_printf(&tb, "# TYPE " METRICS_PREFIX "encode_seconds_total counter\n");
+  tb_printf(&tb, METRICS_PREFIX "encode_seconds_total %.6f\n",
+            (double)atomic_load_explicit(&g_encode_us, memory_order_relaxed) / 1e6);
+
+  for (int g = 0; g < METRIC_GAUGE_COUNT; g++) {
+    long long v = atomic_load_explicit(&g_gauges[g], memory_order_relaxed);
+    tb_printf(&tb, "# HELP " METRICS_PREFIX "%s %s\n", k_gauge_names[g], k_gauge_help[g]);
+    tb_printf(&tb, "# TYPE " METRICS_PREFIX "%s gauge\n", k_gauge_names[g]);
+    tb_printf(&tb, METRICS_PREFIX "%s %lld\n", k_gauge_names[g], v);
+  }
+
+  char le[32];
+
+  tb_printf(&tb, "# HELP " METRICS_PREFIX "stage_seconds Latency of each pipeline stage.\n");
+  tb_printf(&tb, "# TYPE " METRICS_PREFIX "stage_seconds histogram\n");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    const StageHist *h = &g_stage[s];
+    unsigned long long cum = 0;
+    for (size_t b = 0; b < STAGE_BUCKETS; b++) {
+      cum += atomic_load_explicit(&h->buckets[b], memory_order_relaxed);
+      fmt_bound(le, sizeof(le), k_stage_bounds[b]);
+      tb_printf(&tb, METRICS_PREFIX "stage_seconds_bucket{stage=\"%s\",le=\"%s\"} %llu\n",
+                k_stage_names[s], le, cum);
+    }
+    cum += atomic_load_explicit(&h->buckets[STAGE_BUCKETS], memory_order_relaxed);
+    tb_printf(&tb, METRICS_PREFIX "stage_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+              k_stage_names[s], cum);
+    tb_printf(&tb, METRICS_PREFIX "stage_seconds_sum{stage=\"%s\"} %.6f\n",
+              k_stage_names[s], (double)atomic_load_explicit(&h->sum_us, memory_order_relaxed) / 1e6);
+    tb_printf(&tb, METRICS_PREFIX "stage_seconds_count{stage=\"%s\"} %llu\n",
+              k_stage_names[s], cum);
+  }
+
+  tb_printf(&tb, "# HELP " METRICS_PREFIX "clips_per_movie Clips built per processed movie.\n");
+  tb_printf(&tb, "# TYPE " METRICS_PREFIX "clips_per_movie histogram\n");
+  {
+    unsigned long long cum = 0;
+    for (size_t b = 0; b < CLIP_BUCKETS; b++) {
+      cum += atomic_load_explicit(&g_clips.buckets[b], memory_order_relaxed);
+      fmt_bound(le, sizeof(le), k_clip_bounds[b]);
+      tb_printf(&tb, METRICS_PREFIX "clips_per_movie_bucket{le=\"%s\"} %llu\n", le, cum);
+    }
+    cum += atomic_load_explicit(&g_clips.buckets[CLIP_BUCKETS], memory_order_relaxed);
+    tb_printf(&tb, METRICS_PREFIX "clips_per_movie_bucket{le=\"+Inf\"} %llu\n", cum);
+    tb_printf(&tb, METRICS_PREFIX "clips_per_movie_sum %llu\n",
+              atomic_load_explicit(&g_clips.sum, memory_order_relaxed));
+    tb_printf(&tb, METRICS_PREFIX "clips_per_movie_count %llu\n", cum);
+  }
+
+  if (len_out) *len_out = tb.len;
+  return tb.data;
+}
+
+/* ------------------------ HTTP endpoint ------------------------ */
+
+#if defined(_WIN32)
+
+bool metrics_server_start(const char *bind_addr, int port) {
+  (void)bind_addr; (void)port;
+  fprintf(stderr, "[WARN] metrics endpoint is not supported on Windows builds\n");
+  return false;
+}
+
+void metrics_server_stop(void) {}
+
+#else
+
+static int g_listen_fd = -1;
+static atomic_int g_server_stop;
+static pthread_t g_server_thread;
+static bool g_server_running = false;
+
+static void send_all(int fd, const char *p, size_t n) {
+  while (n > 0) {
+    ssize_t w = send(fd, p, n, 0);
+    if (w <= 0) return;
+    p += w;
+    n -= (size_t)w;
+  }
+}
+
+static void serve_one(int fd) {
+  char req[2048];
+  size_t got = 0;
+
+  /* We only need the request line; stop at the end of headers or when full. */
+  while (got + 1 < sizeof(req)) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, 2000) <= 0) break;
+    ssize_t r = recv(fd, req + got, sizeof(req) - 1 - got, 0);
+    if (r <= 0) break;
+    got += (size_t)r;
+    req[got] = 0;
+    if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+  }
+  req[got] = 0;
+
+  bool is_get = strncmp(req, "GET ", 4) == 0 || strncmp(req, "HEAD ", 5) == 0;
+  const char *path = strchr(req, ' ');
+  bool want_metrics = is_get && path &&
+                      (strncmp(path + 1, "/metrics", 8) == 0) &&
+                      (path[9] == ' ' || path[9] == '?');
+
+  char hdr[256];
+  if (!want_metrics) {
+    static const char body[] = "not found\n";
+    int hn = snprintf(hdr, sizeof(hdr),
+                      "HTTP/1.1 404 Not Found\r\n"
+                      "Content-Type: text/plain\r\n"
+                      "Content-Length: %zu\r\n"
+                      "Connection: close\r\n\r\n",
+                      sizeof(body) - 1);
+    send_all(fd, hdr, (size_t)hn);
+    send_all(fd, body, sizeof(body) - 1);
+    return;
+  }
+
+  size_t blen = 0;
+  char *body = metrics_render_text(&blen);
+  int hn = snprintf(hdr, sizeof(hdr),
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: %zu\r\n"
+                    "Connection: close\r\n\r\n",
+                    blen);
+  send_all(fd, hdr, (size_t)hn);
+  if (body && strncmp(req, "HEAD ", 5) != 0) send_all(fd, body, blen);
+  free(body);
+}
+
+static void *server_main(void *p) {
+  (void)p;
+  while (!atomic_load(&g_server_stop)) {
+    struct pollfd pfd = { g_listen_fd, POLLIN, 0 };
+    int pr = poll(&pfd, 1, 250);
+    if (pr <= 0) continue;
+
+    int cfd = accept(g_listen_fd, NULL, NULL);
+    if (cfd < 0) continue;
+    serve_one(cfd);
+    close(cfd);
+  }
+  return NULL;
+}
+
+bool metrics_server_start(const char *bind_addr, int port) {
+  if (g_server_running) return true;
+  if (port <= 0 || port > 65535) return false;
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((unsigned short)port);
+  if (inet_pton(AF_INET, (bind_addr && bind_addr[0]) ? bind_addr : "127.0.0.1", &addr.sin_addr) != 1) {
+    close(fd);
+    return false;
+  }
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+    close(fd);
+    return false;
+  }
+
+  g_listen_fd = fd;
+  atomic_store(&g_server_stop, 0);
+  if (pthread_create(&g_server_thread, NULL, server_main, NULL) != 0) {
+    close(fd);
+    g_listen_fd = -1;
+    return false;
+  }
+  g_server_running = true;
+  return true;
+}
+
+void metrics_server_stop(void) {
+  if (!g_server_running) return;
+  atomic_store(&g_server_stop, 1);
+  pthread_join(g_server_thread, NULL);
+  close(g_listen_fd);
+  g_listen_fd = -1;
+  g_server_running = false;
+}
+
+#endif
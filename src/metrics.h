@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free process-wide metrics. Every update is a relaxed atomic add, so the
+// generator can instrument hot paths from any thread without taking a lock.
+
+typedef enum {
+  METRIC_MOVIES_PROCESSED = 0,
+  METRIC_MOVIES_FAILED,
+  METRIC_CLIPS_BUILT,
+  METRIC_CLIPS_FAILED,
+  METRIC_HTTP_REQUESTS,
+  METRIC_HTTP_ERRORS,
+  METRIC_HTTP_RETRIES,
+  METRIC_BYTES_DOWNLOADED,
+  METRIC_TTS_CHARS,
+  METRIC_RUNS,
+  METRIC_COUNTER_COUNT
+} MetricsCounter;
+
+typedef enum {
+  METRIC_QUEUE_MOVIES = 0,   // movies still waiting in the current run
+  METRIC_QUEUE_CLIPS,        // clips still waiting for the current movie
+  METRIC_ACTIVE_WORKERS,
+  METRIC_GAUGE_COUNT
+} MetricsGauge;
+
+typedef enum {
+  STAGE_SUBTITLES = 0,
+  STAGE_SCRIPT,
+  STAGE_PLAN,
+  STAGE_TTS,
+  STAGE_CLIP,
+  STAGE_CONCAT,
+  STAGE_BGM,
+  STAGE_MIX,
+  STAGE_VERTICAL,
+  STAGE_PREVIEW,
+  STAGE_MOVIE,               // whole process_movie() wall time
+  STAGE_COUNT
+} MetricsStage;
+
+// Monotonic clock in seconds (arbitrary epoch); use for durations only.
+double metrics_now(void);
+
+void metrics_inc(MetricsCounter c, unsigned long long n);
+void metrics_gauge_set(MetricsGauge g, long long v);
+void metrics_gauge_add(MetricsGauge g, long long delta);
+
+void metrics_observe_stage(MetricsStage s, double seconds);
+void metrics_observe_clips_per_movie(size_t clips);
+void metrics_add_encode_seconds(double seconds);
+
+const char *metrics_stage_name(MetricsStage s);
+
+unsigned long long metrics_counter_get(MetricsCounter c);
+long long metrics_gauge_get(MetricsGauge g);
+double metrics_encode_seconds(void);
+
+// Snapshot of one stage histogram (count of observations + summed seconds).
+void metrics_stage_totals(MetricsStage s, unsigned long long *count_out, double *sum_out);
+
+// Prometheus text exposition format (version 0.0.4). Caller frees.
+char *metrics_render_text(size_t *len_out);
+
+// Serve GET /metrics on bind_addr:port from a background thread.
+bool metrics_server_start(const char *bind_addr, int port);
+void metrics_server_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
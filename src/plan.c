@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "plan.h"
+#include "jsonw.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+void free_clip_plan_list(ClipPlanList *lst) {
+  if (!lst) return;
+  if (!lst->arena) {
+    for (size_t i = 0; i < lst->count; i++) {
+      free(lst->items[i].narration);
+    }
+    free(lst->items);
+  }
+  lst->items = NULL;
+  lst->count = 0;
+  lst->arena = NULL;
+}
+
+ClipPlanList parse_clip_plan_json(const char *json_text) {
+  return parse_clip_plan_json_in(NULL, json_text);
+}
+
+/* Reads the "clips" array of an already parsed object. */
+static ClipPlanList clips_from_root(Arena *a, const cJSON *root) {
+  ClipPlanList out = {0};
+  out.arena = a;
+
+  cJSON *clips = cJSON_GetObjectItemCaseSensitive(root, "clips");
+  if (!cJSON_IsArray(clips)) return out;
+
+  size_t n = (size_t)cJSON_GetArraySize(clips);
+  if (a) {
+    out.items = (ClipPlan *)arena_alloc(a, n * sizeof(ClipPlan));
+    memset(out.items, 0, n * sizeof(ClipPlan));
+  } else {
+    out.items = (ClipPlan *)calloc(n, sizeof(ClipPlan));
+    if (!out.items) die("OOM");
+  }
+  out.count = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    cJSON *obj = cJSON_GetArrayItem(clips, (int)i);
+    if (!cJSON_IsObject(obj)) continue;
+
+    cJSON *s = cJSON_GetObjectItemCaseSensitive(obj, "start");
+    cJSON *e = cJSON_GetObjectItemCaseSensitive(obj, "end");
+    cJSON *nar = cJSON_GetObjectItemCaseSensitive(obj, "narration");
+
+    if (!cJSON_IsNumber(s) || !cJSON_IsNumber(e) || !cJSON_IsString(nar) || !nar->valuestring) continue;
+
+    out.items[out.count].start = s->valueint;
+    out.items[out.count].end = e->valueint;
+    out.items[out.count].narration = a ? arena_strdup(a, nar->valuestring) : strdup(nar->valuestring);
+    out.count++;
+  }
+  return out;
+}
+
+ClipPlanList parse_clip_plan_json_in(Arena *a, const char *json_text) {
+  cJSON *root = cJSON_Parse(json_text);
+  if (!root) return (ClipPlanList){ .arena = a };
+  ClipPlanList out = clips_from_root(a, root);
+  cJSON_Delete(root);
+  return out;
+}
+
+/* ------------------------ plan files ------------------------ */
+
+static const char PLAN_FORMAT[] = "movie-shorts-plan";
+
+char *clip_plan_to_json(const ClipPlanList *lst, const ClipPlanInfo *info, size_t *len) {
+  JsonWriter w;
+  jw_init(&w, 256 + lst->count * 512);
+  jw_object_begin(&w);
+  jw_key(&w, "format");
+  jw_string(&w, PLAN_FORMAT);
+  jw_key(&w, "version");
+  jw_int(&w, CLIP_PLAN_VERSION);
+  if (info && info->title[0]) {
+    jw_key(&w, "title");
+    jw_string(&w, info->title);
+  }
+  if (info && info->source[0]) {
+    jw_key(&w, "source");
+    jw_string(&w, info->source);
+  }
+  if (info && info->source_seconds > 0) {
+    jw_key(&w, "source_seconds");
+    jw_double(&w, info->source_seconds);
+  }
+  jw_key(&w, "clips");
+  jw_array_begin(&w);
+  for (size_t i = 0; i < lst->count; i++) {
+    jw_object_begin(&w);
+    jw_key(&w, "start");
+    jw_int(&w, lst->items[i].start);
+    jw_key(&w, "end");
+    jw_int(&w, lst->items[i].end);
+    jw_key(&w, "narration");
+    jw_string(&w, lst->items[i].narration);
+    jw_object_end(&w);
+  }
+  jw_array_end(&w);
+  jw_object_end(&w);
+  return jw_take(&w, len);
+}
+
+static void copy_string_item(const cJSON *root, const char *key, char *out, size_t outsz) {
+  const cJSON *it = cJSON_GetObjectItemCaseSensitive(root, key);
+  if (cJSON_IsString(it) && it->valuestring) snprintf(out, outsz, "%s", it->valuestring);
+}
+
+bool clip_plan_from_json(Arena *a, const char *json_text, size_t len, ClipPlanInfo *info,
+                         ClipPlanList *lst, char *err, size_t errsz) {
+  memset(info, 0, sizeof(*info));
+  memset(lst, 0, sizeof(*lst));
+  if (errsz) err[0] = 0;
+
+  cJSON *root = cJSON_ParseWithLength(json_text, len);
+  if (!cJSON_IsObject(root)) {
+    snprintf(err, errsz, "not valid JSON");
+    cJSON_Delete(root);
+    return false;
+  }
+
+  const cJSON *fmt = cJSON_GetObjectItemCaseSensitive(root, "format");
+  if (fmt && !(cJSON_IsString(fmt) && fmt->valuestring && strcmp(fmt->valuestring, PLAN_FORMAT) == 0)) {
+    snprintf(err, errsz, "not a plan file (format is not \"%s\")", PLAN_FORMAT);
+    cJSON_Delete(root);
+    return false;
+  }
+
+  const cJSON *ver = cJSON_GetObjectItemCaseSensitive(root, "version");
+  info->version = cJSON_IsNumber(ver) ? ver->valueint : 1;
+  if (info->version < 1 || info->version > CLIP_PLAN_VERSION) {
+    snprintf(err, errsz, "plan version %d not supported (this build reads 1..%d)",
+             info->version, CLIP_PLAN_VERSION);
+    cJSON_Delete(root);
+    return false;
+  }
+
+  copy_string_item(root, "title", info->title, sizeof(info->title));
+  copy_string_item(root, "source", info->source, sizeof(info->source));
+  const cJSON *secs = cJSON_GetObjectItemCaseSensitive(root, "source_seconds");
+  if (cJSON_IsNumber(secs) && secs->valuedouble > 0) info->source_seconds = secs->valuedouble;
+
+  *lst = clips_from_root(a, root);
+  cJSON_Delete(root);
+  if (lst->count == 0) {
+    snprintf(err, errsz, "no usable clips");
+    return false;
+  }
+  return true;
+}
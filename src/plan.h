@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  int start;
+  int end;
+  char *narration;
+} ClipPlan;
+
+typedef struct {
+  ClipPlan *items;
+  size_t count;
+  Arena *arena;             // owner of items/narrations, or NULL for the heap
+} ClipPlanList;
+
+void free_clip_plan_list(ClipPlanList *lst);
+
+// Parses {"clips":[{"start":N,"end":N,"narration":"..."}]}; malformed items are skipped.
+ClipPlanList parse_clip_plan_json(const char *json_text);
+
+// Same, with items and narrations allocated in a (freeing the list is then a no-op).
+ClipPlanList parse_clip_plan_json_in(Arena *a, const char *json_text);
+
+// ---- Plan files ----
+//
+// A plan written by a planning run and read back by a rendering run, possibly
+// on another machine and after hand edits:
+//   {"format":"movie-shorts-plan","version":1,"title":"...","source":"Title.mp4",
+//    "source_seconds":6512.4,"clips":[{"start":N,"end":N,"narration":"..."}]}
+// Readers accept any version up to CLIP_PLAN_VERSION; files without a version
+// (the first plan-only runs) read as version 1.
+
+#define CLIP_PLAN_VERSION 1
+
+typedef struct {
+  int version;
+  char title[256];
+  char source[256];         // movie file name the plan was made from, "" if unknown
+  double source_seconds;    // its duration; 0 = unknown
+} ClipPlanInfo;
+
+// malloc'd; free() it.
+char *clip_plan_to_json(const ClipPlanList *lst, const ClipPlanInfo *info, size_t *len);
+
+// Parses a plan file. Returns false (with a reason in err) when the text is
+// not a plan, is newer than this build understands, or holds no usable clip;
+// malformed clips are skipped. lst is allocated like parse_clip_plan_json_in.
+bool clip_plan_from_json(Arena *a, const char *json_text, size_t len, ClipPlanInfo *info,
+                         ClipPlanList *lst, char *err, size_t errsz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,493 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "proc.h"
+#include "log.h"
+#include "metrics.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #define popen  _popen
+  #define pclose _pclose
+#else
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <signal.h>
+  #include <spawn.h>
+  #include <sys/types.h>
+  #include <sys/wait.h>
+  #include <time.h>
+  #include <unistd.h>
+
+  extern char **environ;
+#endif
+
+#define PROC_KILL_GRACE_S 3.0
+#define PROC_CANCEL_POLL_MS 100
+#define PROC_MAX_WAIT_SET 64
+
+struct Proc {
+  ProcSpec spec;
+  char name[64];                /* argv[0], for log messages */
+  bool done;
+  double started;
+  ProcResult res;
+  size_t out_cap;
+
+  char *line;                   /* partial stdout line for on_stdout_line */
+  size_t line_len, line_cap;
+  size_t tail_len;
+
+#if !defined(_WIN32)
+  pid_t pid;
+  int out_fd, err_fd;
+  double deadline;              /* 0 = none */
+  double kill_at;               /* SIGKILL time once SIGTERM was sent */
+  ProcStatus stop_reason;       /* why we sent signals, if we did */
+  bool term_sent;
+  bool suspended;
+  double suspended_at;
+#endif
+};
+
+const char *proc_status_name(ProcStatus s) {
+  switch (s) {
+    case PROC_EXITED:       return "exited";
+    case PROC_SIGNALED:     return "signaled";
+    case PROC_TIMED_OUT:    return "timed out";
+    case PROC_CANCELLED:    return "cancelled";
+    case PROC_SPAWN_FAILED: return "spawn failed";
+  }
+  return "unknown";
+}
+
+/* ------------------------ output handling ------------------------ */
+
+static void grow(char **buf, size_t *cap, size_t need) {
+  if (need <= *cap) return;
+  size_t c = *cap ? *cap : 4096;
+  while (c < need) c *= 2;
+  char *p = (char *)realloc(*buf, c);
+  if (!p) die("OOM");
+  *buf = p;
+  *cap = c;
+}
+
+static void emit_lines(Proc *p, const char *data, size_t n, bool flush) {
+  const char *s = data, *end = data + n;
+  while (s < end) {
+    const char *nl = (const char *)memchr(s, '\n', (size_t)(end - s));
+    if (!nl) {
+      grow(&p->line, &p->line_cap, p->line_len + (size_t)(end - s) + 1);
+      memcpy(p->line + p->line_len, s, (size_t)(end - s));
+      p->line_len += (size_t)(end - s);
+      break;
+    }
+    size_t k = (size_t)(nl - s);
+    grow(&p->line, &p->line_cap, p->line_len + k + 1);
+    memcpy(p->line + p->line_len, s, k);
+    p->line_len += k;
+    if (p->line_len && p->line[p->line_len - 1] == '\r') p->line_len--;
+    p->line[p->line_len] = 0;
+    p->spec.on_stdout_line(p->spec.user, p->line, p->line_len);
+    p->line_len = 0;
+    s = nl + 1;
+  }
+  if (flush && p->line_len) {
+    p->line[p->line_len] = 0;
+    p->spec.on_stdout_line(p->spec.user, p->line, p->line_len);
+    p->line_len = 0;
+  }
+}
+
+static void on_stdout(Proc *p, const char *data, size_t n) {
+  if (p->spec.capture_stdout) {
+    grow(&p->res.out, &p->out_cap, p->res.out_len + n + 1);
+    memcpy(p->res.out + p->res.out_len, data, n);
+    p->res.out_len += n;
+    p->res.out[p->res.out_len] = 0;
+  }
+  if (p->spec.on_stdout_line) emit_lines(p, data, n, false);
+}
+
+static void on_stderr(Proc *p, const char *data, size_t n) {
+  fwrite(data, 1, n, stderr);
+
+  /* Keep only the tail: shift out the oldest bytes when full. */
+  const size_t room = PROC_ERR_TAIL - 1;
+  if (n >= room) {
+    memcpy(p->res.err_tail, data + n - room, room);
+    p->tail_len = room;
+  } else {
+    if (p->tail_len + n > room) {
+      size_t drop = p->tail_len + n - room;
+      memmove(p->res.err_tail, p->res.err_tail + drop, p->tail_len - drop);
+      p->tail_len -= drop;
+    }
+    memcpy(p->res.err_tail + p->tail_len, data, n);
+    p->tail_len += n;
+  }
+  p->res.err_tail[p->tail_len] = 0;
+}
+
+static Proc *proc_alloc(const ProcSpec *spec) {
+  Proc *p = (Proc *)calloc(1, sizeof(*p));
+  if (!p) die("OOM");
+  p->spec = *spec;
+  p->spec.argv = NULL;          /* not kept; posix_spawn copies it */
+  snprintf(p->name, sizeof(p->name), "%s", spec->argv[0]);
+  p->started = metrics_now();
+  return p;
+}
+
+static void finish(Proc *p) {
+  if (p->spec.on_stdout_line) emit_lines(p, "", 0, true);
+  p->res.seconds = metrics_now() - p->started;
+  p->done = true;
+}
+
+#if defined(_WIN32)
+
+/* ------------------------ Windows (synchronous) ------------------------ */
+
+static void append_quoted(char **cmd, size_t *len, size_t *cap, const char *arg) {
+  size_t n = strlen(arg);
+  grow(cmd, cap, *len + 2 * n + 4);
+  char *o = *cmd + *len;
+  *o++ = '"';
+  for (size_t i = 0; i < n; i++) {
+    if (arg[i] == '"') *o++ = '\\';
+    *o++ = arg[i];
+  }
+  *o++ = '"';
+  *o++ = ' ';
+  *len = (size_t)(o - *cmd);
+  (*cmd)[*len] = 0;
+}
+
+Proc *proc_start(const ProcSpec *spec) {
+  Proc *p = proc_alloc(spec);
+
+  char *cmd = NULL;
+  size_t len = 0, cap = 0;
+  for (const char *const *a = spec->argv; *a; a++) append_quoted(&cmd, &len, &cap, *a);
+
+  FILE *f = cmd ? popen(cmd, "rb") : NULL;
+  free(cmd);
+  if (!f) {
+    p->res.status = PROC_SPAWN_FAILED;
+    finish(p);
+    return p;
+  }
+
+  char buf[16384];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) on_stdout(p, buf, n);
+  int rc = pclose(f);
+  p->res.status = PROC_EXITED;
+  p->res.exit_code = rc;
+  finish(p);
+  return p;
+}
+
+int proc_wait_any(Proc *const *procs, size_t n, int timeout_ms) {
+  (void)timeout_ms;
+  for (size_t i = 0; i < n; i++) {
+    if (procs[i] && procs[i]->done) return (int)i;
+  }
+  return -1;
+}
+
+void proc_cancel(Proc *p) {
+  (void)p;
+}
+
+static void reap_now(Proc *p) {
+  (void)p;
+}
+
+#else
+
+/* ------------------------ POSIX ------------------------ */
+
+static void set_cloexec_nonblock(int fd, bool nonblock) {
+  fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+  if (nonblock) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void close_fd(int *fd) {
+  if (*fd >= 0) close(*fd);
+  *fd = -1;
+}
+
+Proc *proc_start(const ProcSpec *spec) {
+  Proc *p = proc_alloc(spec);
+  p->out_fd = p->err_fd = -1;
+  p->pid = -1;
+  if (spec->timeout_s > 0) p->deadline = p->started + spec->timeout_s;
+
+  int outp[2] = { -1, -1 }, errp[2] = { -1, -1 };
+  if (pipe(outp) != 0 || pipe(errp) != 0) {
+    logw("proc: pipe: %s", strerror(errno));
+    close_fd(&outp[0]); close_fd(&outp[1]);
+    p->res.status = PROC_SPAWN_FAILED;
+    finish(p);
+    return p;
+  }
+  set_cloexec_nonblock(outp[0], true);
+  set_cloexec_nonblock(errp[0], true);
+  set_cloexec_nonblock(outp[1], false);
+  set_cloexec_nonblock(errp[1], false);
+
+  posix_spawn_file_actions_t fa;
+  posix_spawn_file_actions_init(&fa);
+  posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&fa, outp[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2(&fa, errp[1], STDERR_FILENO);
+
+  pid_t pid = -1;
+  int rc = posix_spawnp(&pid, spec->argv[0], &fa, NULL, (char *const *)spec->argv, environ);
+  posix_spawn_file_actions_destroy(&fa);
+  close(outp[1]);
+  close(errp[1]);
+
+  if (rc != 0) {
+    logw("proc: cannot start %s: %s", spec->argv[0], strerror(rc));
+    close(outp[0]);
+    close(errp[0]);
+    p->res.status = PROC_SPAWN_FAILED;
+    finish(p);
+    return p;
+  }
+
+  p->pid = pid;
+  p->out_fd = outp[0];
+  p->err_fd = errp[0];
+  return p;
+}
+
+/* Drains whatever is readable without blocking; closes the fd at EOF. */
+static void pump(Proc *p, int *fd, bool is_err) {
+  char buf[16384];
+  for (;;) {
+    ssize_t n = read(*fd, buf, sizeof(buf));
+    if (n > 0) {
+      if (is_err) on_stderr(p, buf, (size_t)n);
+      else on_stdout(p, buf, (size_t)n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    close_fd(fd);
+    return;
+  }
+}
+
+static void record_exit(Proc *p, int st) {
+  if (WIFEXITED(st)) {
+    p->res.status = PROC_EXITED;
+    p->res.exit_code = WEXITSTATUS(st);
+  } else if (WIFSIGNALED(st)) {
+    p->res.status = PROC_SIGNALED;
+    p->res.signal = WTERMSIG(st);
+  }
+  /* A child that dies from our TERM/KILL reports why we sent it. */
+  if (p->term_sent && p->res.status == PROC_SIGNALED) p->res.status = p->stop_reason;
+  if (p->term_sent && p->res.status == PROC_EXITED && p->res.exit_code != 0) p->res.status = p->stop_reason;
+  p->pid = -1;
+  finish(p);
+}
+
+/* Non-blocking reap once the pipes are closed (or when forced). */
+static bool try_reap(Proc *p, bool block) {
+  if (p->done) return true;
+  if (p->pid < 0) return false;
+  int st = 0;
+  pid_t r;
+  do {
+    r = waitpid(p->pid, &st, block ? 0 : WNOHANG);
+  } while (r < 0 && errno == EINTR);
+  if (r == p->pid) {
+    record_exit(p, st);
+    return true;
+  }
+  if (r < 0) {                  /* already reaped elsewhere: treat as gone */
+    p->res.status = p->term_sent ? p->stop_reason : PROC_SIGNALED;
+    p->pid = -1;
+    finish(p);
+    return true;
+  }
+  return false;
+}
+
+static void send_stop(Proc *p, ProcStatus why) {
+  if (p->done || p->pid < 0 || p->term_sent) return;
+  p->term_sent = true;
+  p->stop_reason = why;
+  p->kill_at = metrics_now() + PROC_KILL_GRACE_S;
+  kill(p->pid, SIGTERM);
+  if (p->suspended) {           /* a stopped child only sees TERM once continued */
+    kill(p->pid, SIGCONT);
+    p->suspended = false;
+  }
+}
+
+/* SIGSTOP/SIGCONT to follow should_pause; the deadline moves by the time the
+   child spent stopped. */
+static void follow_pause(Proc *p, double now) {
+  if (!p->spec.should_pause || p->term_sent) return;
+  bool want = p->spec.should_pause(p->spec.user);
+  if (want && !p->suspended) {
+    if (kill(p->pid, SIGSTOP) == 0) {
+      p->suspended = true;
+      p->suspended_at = now;
+    }
+  } else if (!want && p->suspended) {
+    kill(p->pid, SIGCONT);
+    p->suspended = false;
+    if (p->deadline > 0) p->deadline += now - p->suspended_at;
+  }
+}
+
+void proc_cancel(Proc *p) {
+  if (p) send_stop(p, PROC_CANCELLED);
+}
+
+/* Deadlines, cancellation and the SIGKILL escalation. Returns the ms until the
+   next thing to check, or -1 for none. */
+static int check_timers(Proc *p, double now) {
+  if (p->done) return -1;
+  follow_pause(p, now);
+  if (!p->term_sent && !p->suspended && p->deadline > 0 && now >= p->deadline) {
+    logw("proc: %s exceeded %gs, stopping it", p->name, p->spec.timeout_s);
+    send_stop(p, PROC_TIMED_OUT);
+  }
+  if (!p->term_sent && p->spec.should_cancel && p->spec.should_cancel(p->spec.user)) {
+    send_stop(p, PROC_CANCELLED);
+  }
+  if (p->term_sent && now >= p->kill_at) {
+    kill(p->pid, SIGKILL);
+    p->kill_at = now + 3600.0;
+  }
+
+  double next = -1.0;
+  if (p->term_sent) next = p->kill_at - now;
+  else if (p->deadline > 0 && !p->suspended) next = p->deadline - now;
+  int ms = next < 0 ? -1 : (int)(next * 1000.0) + 1;
+  bool polled = p->spec.should_cancel || p->spec.should_pause;
+  if (polled && !p->term_sent && (ms < 0 || ms > PROC_CANCEL_POLL_MS)) ms = PROC_CANCEL_POLL_MS;
+  return ms;
+}
+
+static void reap_now(Proc *p) {
+  send_stop(p, PROC_CANCELLED);
+  while (!p->done) {
+    close_fd(&p->out_fd);
+    close_fd(&p->err_fd);
+    if (try_reap(p, false)) break;
+    check_timers(p, metrics_now());
+    struct timespec ts = { 0, 20 * 1000000L };
+    nanosleep(&ts, NULL);
+  }
+}
+
+int proc_wait_any(Proc *const *procs, size_t n, int timeout_ms) {
+  if (n > PROC_MAX_WAIT_SET) n = PROC_MAX_WAIT_SET;
+  double until = timeout_ms >= 0 ? metrics_now() + timeout_ms / 1000.0 : -1.0;
+
+  for (;;) {
+    struct pollfd fds[2 * PROC_MAX_WAIT_SET];
+    Proc *owner[2 * PROC_MAX_WAIT_SET];
+    nfds_t nf = 0;
+    int wait_ms = -1;
+    double now = metrics_now();
+
+    for (size_t i = 0; i < n; i++) {
+      Proc *p = procs[i];
+      if (!p || p->done) continue;
+      if (p->out_fd < 0 && p->err_fd < 0) try_reap(p, false);
+      if (p->done) continue;
+
+      int t = check_timers(p, now);
+      if (t >= 0 && (wait_ms < 0 || t < wait_ms)) wait_ms = t;
+      /* Pipes closed but the child lingers: poll its status. */
+      if (p->out_fd < 0 && p->err_fd < 0 && (wait_ms < 0 || wait_ms > 20)) wait_ms = 20;
+
+      if (p->out_fd >= 0) { fds[nf].fd = p->out_fd; fds[nf].events = POLLIN; owner[nf++] = p; }
+      if (p->err_fd >= 0) { fds[nf].fd = p->err_fd; fds[nf].events = POLLIN; owner[nf++] = p; }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      if (procs[i] && procs[i]->done) return (int)i;
+    }
+
+    if (until >= 0.0) {
+      int left = (int)((until - now) * 1000.0);
+      if (left <= 0) return -1;
+      if (wait_ms < 0 || left < wait_ms) wait_ms = left;
+    }
+
+    int rc = poll(fds, nf, wait_ms);
+    if (rc < 0 && errno != EINTR) {
+      logw("proc: poll: %s", strerror(errno));
+      struct timespec ts = { 0, 20 * 1000000L };
+      nanosleep(&ts, NULL);
+    }
+    for (nfds_t k = 0; rc > 0 && k < nf; k++) {
+      if (!fds[k].revents) continue;
+      Proc *p = owner[k];
+      if (fds[k].fd == p->out_fd) pump(p, &p->out_fd, false);
+      else if (fds[k].fd == p->err_fd) pump(p, &p->err_fd, true);
+      if (p->out_fd < 0 && p->err_fd < 0) try_reap(p, false);
+    }
+  }
+}
+
+#endif
+
+/* ------------------------ common ------------------------ */
+
+bool proc_done(const Proc *p) {
+  return p->done;
+}
+
+void proc_wait(Proc *p) {
+  Proc *one[1] = { p };
+  while (!p->done) proc_wait_any(one, 1, -1);
+}
+
+const ProcResult *proc_result(const Proc *p) {
+  return &p->res;
+}
+
+ProcResult proc_finish(Proc *p) {
+  if (!p->done) reap_now(p);
+  ProcResult r = p->res;
+  p->res.out = NULL;
+  free(p->line);
+  free(p);
+  return r;
+}
+
+void proc_free(Proc *p) {
+  if (!p) return;
+  ProcResult r = proc_finish(p);
+  proc_result_free(&r);
+}
+
+ProcResult proc_run(const ProcSpec *spec) {
+  Proc *p = proc_start(spec);
+  proc_wait(p);
+  return proc_finish(p);
+}
+
+void proc_result_free(ProcResult *r) {
+  if (!r) return;
+  free(r->out);
+  r->out = NULL;
+  r->out_len = 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Child processes started from argv vectors (posix_spawnp, no shell), with
+// non-blocking capture of stdout/stderr, timeouts, cancellation and exit
+// status. Several processes can run at once; proc_wait_any() sleeps in poll()
+// until one of them finishes.
+//
+// stderr is always read: each chunk is echoed to our stderr and the last
+// PROC_ERR_TAIL bytes are kept for error messages. stdout is captured,
+// split into lines, or discarded, as the spec asks.
+//
+// A child is suspended (SIGSTOP) while should_pause says so and continued
+// afterwards; time spent suspended does not count towards the timeout.
+//
+// On Windows processes run synchronously through _popen; timeouts,
+// cancellation and pausing are not available there.
+
+#define PROC_ERR_TAIL 2048
+
+typedef void (*ProcLineFn)(void *user, const char *line, size_t len);
+
+typedef struct {
+  const char *const *argv;      // NULL-terminated; argv[0] is looked up in PATH
+  double timeout_s;             // 0 = no limit
+  bool capture_stdout;          // keep all of stdout in the result
+  ProcLineFn on_stdout_line;    // called for each stdout line (without '\n')
+  bool (*should_cancel)(void *user);  // polled while waiting; true stops the child
+  bool (*should_pause)(void *user);   // polled while waiting; true suspends the child
+  void *user;
+} ProcSpec;
+
+typedef enum {
+  PROC_EXITED = 0,              // exit_code is valid
+  PROC_SIGNALED,                // killed by a signal we did not send
+  PROC_TIMED_OUT,
+  PROC_CANCELLED,
+  PROC_SPAWN_FAILED
+} ProcStatus;
+
+typedef struct {
+  ProcStatus status;
+  int exit_code;
+  int signal;
+  double seconds;               // wall time from spawn to exit
+  char *out;                    // capture_stdout: NUL-terminated, owned by the result
+  size_t out_len;
+  char err_tail[PROC_ERR_TAIL]; // last bytes of stderr, NUL-terminated
+} ProcResult;
+
+typedef struct Proc Proc;
+
+// Never NULL; a spawn failure shows up as a finished process with
+// PROC_SPAWN_FAILED. argv only needs to live for this call.
+Proc *proc_start(const ProcSpec *spec);
+
+bool proc_done(const Proc *p);
+
+// Pumps output of all running processes until at least one in procs[] has
+// finished or timeout_ms (-1 = no limit) passes. Returns the lowest index of
+// a finished process, or -1 on timeout. NULL entries are skipped.
+int proc_wait_any(Proc *const *procs, size_t n, int timeout_ms);
+void proc_wait(Proc *p);
+
+// Asks the child to stop (SIGTERM, then SIGKILL after a grace period).
+void proc_cancel(Proc *p);
+
+// Valid once the process is done.
+const ProcResult *proc_result(const Proc *p);
+
+// Moves the result out (the Proc keeps nothing to free) and frees the Proc.
+// A still-running process is cancelled and reaped first.
+ProcResult proc_finish(Proc *p);
+void proc_free(Proc *p);
+
+// proc_start + proc_wait + proc_finish.
+ProcResult proc_run(const ProcSpec *spec);
+void proc_result_free(ProcResult *r);
+
+static inline bool proc_ok(const ProcResult *r) {
+  return r->status == PROC_EXITED && r->exit_code == 0;
+}
+
+const char *proc_status_name(ProcStatus s);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "runctl.h"
+
+#include <stdatomic.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+#define RUNCTL_POLL_S 0.05
+
+static atomic_bool g_cancel = false;
+static atomic_bool g_pause = false;
+
+static void nap(double s) {
+  if (s <= 0.0) return;
+#if defined(_WIN32)
+  Sleep((DWORD)(s * 1000.0));
+#else
+  struct timespec ts;
+  ts.tv_sec = (time_t)s;
+  ts.tv_nsec = (long)((s - (double)ts.tv_sec) * 1e9);
+  nanosleep(&ts, NULL);
+#endif
+}
+
+void runctl_reset(void) {
+  atomic_store(&g_cancel, false);
+  atomic_store(&g_pause, false);
+}
+
+void runctl_cancel(void) {
+  atomic_store(&g_cancel, true);
+}
+
+bool runctl_cancelled(void) {
+  return atomic_load_explicit(&g_cancel, memory_order_relaxed);
+}
+
+void runctl_pause(bool paused) {
+  atomic_store(&g_pause, paused);
+}
+
+bool runctl_paused(void) {
+  return atomic_load_explicit(&g_pause, memory_order_relaxed);
+}
+
+bool runctl_checkpoint(void) {
+  while (runctl_paused() && !runctl_cancelled()) nap(RUNCTL_POLL_S);
+  return !runctl_cancelled();
+}
+
+bool runctl_sleep(double s) {
+  while (s > 0.0 && !runctl_cancelled()) {
+    double step = s < RUNCTL_POLL_S ? s : RUNCTL_POLL_S;
+    nap(step);
+    s -= step;
+  }
+  return !runctl_cancelled();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide stop/pause flags for the generation run in progress. The
+// generator polls them at stage boundaries, the fetch engine aborts transfers
+// from curl's progress callback, and encoder processes are stopped (cancel)
+// or suspended (pause) while they are being waited on.
+//
+// All functions are lock-free; runctl_cancel() is safe in a signal handler.
+
+// Clears both flags; called when a run starts.
+void runctl_reset(void);
+
+void runctl_cancel(void);
+bool runctl_cancelled(void);
+
+void runctl_pause(bool paused);
+bool runctl_paused(void);
+
+// Blocks while paused. Returns false once the run has been cancelled.
+bool runctl_checkpoint(void);
+
+// Sleeps up to s seconds, waking early on cancel. Returns !runctl_cancelled().
+bool runctl_sleep(double s);
+
+#ifdef __cplusplus
+}
+#endif
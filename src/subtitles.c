@@ -0,0 +1,451 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "subtitles.h"
+#include "fetch.h"
+#include "htmlscan.h"
+#include "log.h"
+#include "zipread.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cJSON.h"
+
+#define SUBF2M_MAX_PROFILES 12
+#define SUBF2M_MAX_DETAILS 4        /* detail pages taken from the list page */
+#define SUBF2M_MAX_PROFILE_LINKS 2  /* detail pages taken from each profile page */
+#define SUBS_MAX_SEEN 64
+#define OPENSUBS_MAX_FILES 3
+
+typedef struct SubsRun SubsRun;
+
+typedef struct {
+  const char *name;
+  bool (*enabled)(const SubsSources *src);
+  void (*start)(SubsRun *run);
+} SubsProvider;
+
+struct SubsRun {
+  const SubsSources *src;
+  const char *title;
+  const char *slug;
+  SubsAcceptFn accept;
+  void *user;
+  FetchGroup *g;
+  bool won;
+  SubsResult result;
+
+  char subpage_prefix[768];
+  char seen[SUBS_MAX_SEEN][512];    /* subf2m detail pages already queued */
+  int nseen;
+};
+
+/* Hands a downloaded candidate to the caller; the first accepted one ends the race. */
+static void offer(SubsRun *run, const char *provider, const char *url,
+                  const char *data, size_t len, SubsFormat fmt) {
+  if (run->won || !data || len == 0) return;
+  if (run->accept(run->user, provider, data, len, fmt)) {
+    run->won = true;
+    snprintf(run->result.provider, sizeof(run->result.provider), "%s", provider);
+    snprintf(run->result.url, sizeof(run->result.url), "%s", url);
+    run->result.fmt = fmt;
+    logi("subtitles: using %s result, cancelling remaining lookups", provider);
+    fetch_group_cancel(run->g);
+  }
+}
+
+/* Remembers why the search came up empty; the first failure is the most telling. */
+static void note_failure(SubsRun *run, long code, const char *reason) {
+  if (run->result.reason[0]) return;
+  run->result.http_code = code;
+  snprintf(run->result.reason, sizeof(run->result.reason), "%s", reason);
+}
+
+/* A step that got no answer, or an error the server may not repeat, makes the
+   whole search inconclusive whatever the other steps said. */
+static void note_job(SubsRun *run, const FetchJob *job) {
+  if (!job->ok && (job->code == 0 || job->code == 429 || job->code >= 500)) run->result.transient = true;
+}
+
+static void pct_encode(const char *in, char *out, size_t outsz) {
+  static const char *hex = "0123456789ABCDEF";
+  size_t j = 0;
+  for (size_t i = 0; in[i] && j + 4 < outsz; i++) {
+    unsigned char c = (unsigned char)in[i];
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      out[j++] = (char)c;
+    } else {
+      out[j++] = '%';
+      out[j++] = hex[(c >> 4) & 0xF];
+      out[j++] = hex[c & 0xF];
+    }
+  }
+  out[j] = 0;
+}
+
+/* ------------------------ subf2m ------------------------ */
+
+typedef enum { SUBF2M_LIST = 1, SUBF2M_PROFILE, SUBF2M_DETAIL, SUBF2M_ZIP } Subf2mStep;
+
+/* One subf2m HTML page in flight; links are collected while it streams. */
+typedef struct {
+  SubsRun *run;
+  Subf2mStep step;
+  HtmlScan scan;
+  char links[SUBF2M_MAX_DETAILS][512];
+  int nlinks;
+  char profiles[SUBF2M_MAX_PROFILES][512];
+  int nprofiles;
+} Subf2mPage;
+
+static bool add_link(char (*dst)[512], int *n, int max, const char *href, size_t len) {
+  if (*n >= max || len >= sizeof(dst[0])) return *n < max;
+  memcpy(dst[*n], href, len + 1);
+  (*n)++;
+  return *n < max;
+}
+
+static bool subf2m_on_href(void *user, const char *href, size_t len) {
+  Subf2mPage *pg = (Subf2mPage *)user;
+  const char *want = pg->run->subpage_prefix;
+
+  switch (pg->step) {
+    case SUBF2M_LIST:
+      if (strncmp(href, want, strlen(want)) == 0) {
+        if (strstr(href, "english-german")) return true;
+        return add_link(pg->links, &pg->nlinks, SUBF2M_MAX_DETAILS, href, len);
+      }
+      if (strncmp(href, "/u/", 3) == 0) {
+        add_link(pg->profiles, &pg->nprofiles, SUBF2M_MAX_PROFILES, href, len);
+      }
+      return true;
+
+    case SUBF2M_PROFILE:
+      if (strncmp(href, want, strlen(want)) != 0) return true;
+      return add_link(pg->links, &pg->nlinks, SUBF2M_MAX_PROFILE_LINKS, href, len);
+
+    case SUBF2M_DETAIL:
+      if (len >= 8 && strcmp(href + len - 8, "download") == 0) {
+        return add_link(pg->links, &pg->nlinks, 1, href, len);
+      }
+      return true;
+
+    default:
+      return true;
+  }
+}
+
+static void subf2m_page_done(FetchGroup *g, FetchJob *job);
+static void subf2m_zip_done(FetchGroup *g, FetchJob *job);
+
+static void subf2m_page_free(void *user) {
+  Subf2mPage *pg = (Subf2mPage *)user;
+  html_scan_free(&pg->scan);
+  free(pg);
+}
+
+static void subf2m_queue_page(SubsRun *run, Subf2mStep step, const char *path) {
+  Subf2mPage *pg = (Subf2mPage *)calloc(1, sizeof(*pg));
+  if (!pg) die("OOM");
+  pg->run = run;
+  pg->step = step;
+  html_scan_init(&pg->scan, subf2m_on_href, pg, false);
+
+  char url[1024];
+  snprintf(url, sizeof(url), "%s%s", run->src->subf2m_base, path);
+  FetchJob *j = fetch_get(run->g, url, subf2m_page_done, pg, (int)step);
+  j->scan = &pg->scan;
+  j->cleanup = subf2m_page_free;
+}
+
+static void subf2m_queue_detail(SubsRun *run, const char *path) {
+  for (int i = 0; i < run->nseen; i++) {
+    if (strcmp(run->seen[i], path) == 0) return;
+  }
+  if (run->nseen >= SUBS_MAX_SEEN) return;
+  snprintf(run->seen[run->nseen++], sizeof(run->seen[0]), "%s", path);
+  subf2m_queue_page(run, SUBF2M_DETAIL, path);
+}
+
+static void subf2m_page_done(FetchGroup *g, FetchJob *job) {
+  Subf2mPage *pg = (Subf2mPage *)job->user;
+  SubsRun *run = pg->run;
+  (void)g;
+
+  note_job(run, job);
+  if (!job->ok) {
+    if (pg->step != SUBF2M_PROFILE) logw("subf2m: HTTP %ld for %s", job->code, job->url);
+    if (pg->step == SUBF2M_LIST) note_failure(run, job->code, "subf2m: title page unavailable");
+  } else if (pg->step == SUBF2M_LIST) {
+    for (int i = 0; i < pg->nlinks; i++) subf2m_queue_detail(run, pg->links[i]);
+
+    /* No direct link: try every uploader profile at once. */
+    if (pg->nlinks == 0) {
+      for (int i = 0; i < pg->nprofiles; i++) subf2m_queue_page(run, SUBF2M_PROFILE, pg->profiles[i]);
+      if (pg->nprofiles == 0) {
+        logw("subf2m: couldn't locate subtitle detail page for %s (slug=%s)", run->title, run->slug);
+        note_failure(run, job->code, "subf2m: no English subtitles listed");
+      }
+    }
+  } else if (pg->step == SUBF2M_PROFILE) {
+    for (int i = 0; i < pg->nlinks; i++) subf2m_queue_detail(run, pg->links[i]);
+  } else if (pg->step == SUBF2M_DETAIL) {
+    if (pg->nlinks > 0) {
+      char url[1024];
+      snprintf(url, sizeof(url), "%s%s", run->src->subf2m_base, pg->links[0]);
+      FetchJob *zj = fetch_get(run->g, url, subf2m_zip_done, run, SUBF2M_ZIP);
+      fetch_job_policy(zj, &HTTP_POLICY_DOWNLOAD);
+    } else {
+      logw("subf2m: couldn't find download link on %s", job->url);
+    }
+  }
+}
+
+static void subf2m_zip_done(FetchGroup *g, FetchJob *job) {
+  (void)g;
+  note_job((SubsRun *)job->user, job);
+  if (!job->ok) {
+    logw("subf2m: zip download failed (HTTP %ld) for %s", job->code, job->url);
+    return;
+  }
+  offer((SubsRun *)job->user, "subf2m", job->url, job->body, job->len, SUBS_FMT_ZIP);
+}
+
+static bool subf2m_enabled(const SubsSources *src) {
+  return src->subf2m_base && src->subf2m_base[0];
+}
+
+static void subf2m_start(SubsRun *run) {
+  snprintf(run->subpage_prefix, sizeof(run->subpage_prefix), "/subtitles/%s/english/", run->slug);
+
+  char path[768];
+  snprintf(path, sizeof(path), "/subtitles/%s/english", run->slug);
+  subf2m_queue_page(run, SUBF2M_LIST, path);
+}
+
+/* ------------------------ OpenSubtitles (REST API) ------------------------ */
+
+typedef enum { OPENSUBS_SEARCH = 1, OPENSUBS_LINK, OPENSUBS_FILE } OpenSubsStep;
+
+static void opensubs_done(FetchGroup *g, FetchJob *job);
+
+static void opensubs_headers(const SubsRun *run, FetchJob *j) {
+  char key[600];
+  snprintf(key, sizeof(key), "Api-Key: %s", run->src->opensubtitles_key);
+  fetch_job_header(j, key);
+  fetch_job_header(j, "Accept: application/json");
+  fetch_job_header(j, "User-Agent: movie-shorts v1.0");
+}
+
+static void opensubs_on_search(SubsRun *run, const char *body) {
+  cJSON *root = cJSON_Parse(body);
+  const cJSON *data = root ? cJSON_GetObjectItemCaseSensitive(root, "data") : NULL;
+  int queued = 0;
+
+  for (const cJSON *it = cJSON_IsArray(data) ? data->child : NULL; it && queued < OPENSUBS_MAX_FILES; it = it->next) {
+    const cJSON *attrs = cJSON_GetObjectItemCaseSensitive(it, "attributes");
+    const cJSON *files = attrs ? cJSON_GetObjectItemCaseSensitive(attrs, "files") : NULL;
+    const cJSON *f0 = cJSON_IsArray(files) ? files->child : NULL;
+    const cJSON *fid = f0 ? cJSON_GetObjectItemCaseSensitive(f0, "file_id") : NULL;
+    if (!cJSON_IsNumber(fid)) continue;
+
+    char url[1024], req[64];
+    snprintf(url, sizeof(url), "%s/api/v1/download", run->src->opensubtitles_base);
+    snprintf(req, sizeof(req), "{\"file_id\":%.0f}", fid->valuedouble);
+    FetchJob *j = fetch_post(run->g, url, req, opensubs_done, run, OPENSUBS_LINK);
+    opensubs_headers(run, j);
+    fetch_job_header(j, "Content-Type: application/json");
+    queued++;
+  }
+
+  if (queued == 0) {
+    logw("opensubtitles: no results for %s", run->title);
+    note_failure(run, 200, "opensubtitles: no results");
+  }
+  cJSON_Delete(root);
+}
+
+static void opensubs_on_link(SubsRun *run, const char *body) {
+  cJSON *root = cJSON_Parse(body);
+  const cJSON *link = root ? cJSON_GetObjectItemCaseSensitive(root, "link") : NULL;
+  if (cJSON_IsString(link) && link->valuestring && link->valuestring[0]) {
+    FetchJob *j = fetch_get(run->g, link->valuestring, opensubs_done, run, OPENSUBS_FILE);
+    fetch_job_policy(j, &HTTP_POLICY_DOWNLOAD);
+  }
+  cJSON_Delete(root);
+}
+
+static void opensubs_done(FetchGroup *g, FetchJob *job) {
+  SubsRun *run = (SubsRun *)job->user;
+  (void)g;
+
+  note_job(run, job);
+  if (!job->ok || !job->body) {
+    logw("opensubtitles: HTTP %ld for %s", job->code, job->url);
+    return;
+  }
+
+  switch ((OpenSubsStep)job->tag) {
+    case OPENSUBS_SEARCH: opensubs_on_search(run, job->body); break;
+    case OPENSUBS_LINK:   opensubs_on_link(run, job->body); break;
+    case OPENSUBS_FILE:   offer(run, "opensubtitles", job->url, job->body, job->len, SUBS_FMT_SRT); break;
+  }
+}
+
+static bool opensubs_enabled(const SubsSources *src) {
+  return src->opensubtitles_key && src->opensubtitles_key[0] &&
+         src->opensubtitles_base && src->opensubtitles_base[0];
+}
+
+static void opensubs_start(SubsRun *run) {
+  char q[512], url[1024];
+  pct_encode(run->title, q, sizeof(q));
+  snprintf(url, sizeof(url), "%s/api/v1/subtitles?query=%s&languages=en",
+           run->src->opensubtitles_base, q);
+  FetchJob *j = fetch_get(run->g, url, opensubs_done, run, OPENSUBS_SEARCH);
+  opensubs_headers(run, j);
+}
+
+/* ------------------------ archive entry selection ------------------------ */
+
+static bool name_has(const char *lower, const char *const *words) {
+  for (; *words; words++) {
+    if (strstr(lower, *words)) return true;
+  }
+  return false;
+}
+
+/* Higher is better; -1000 rules the entry out. */
+static int srt_entry_score(const ZipEntry *e) {
+  if (e->name_len < 5 || e->name_len >= 512 || e->usize == 0) return -1000;
+  if (e->name[e->name_len - 1] == '/') return -1000;
+
+  char lower[512];
+  for (size_t i = 0; i < e->name_len; i++) lower[i] = (char)tolower((unsigned char)e->name[i]);
+  lower[e->name_len] = 0;
+
+  if (strcmp(lower + e->name_len - 4, ".srt") != 0) return -1000;
+  if (strncmp(lower, "__macosx/", 9) == 0 || strstr(lower, "/._")) return -1000;
+
+  static const char *const k_english[] = { "english", ".eng.", ".en.", "_eng", "-eng", ".eng", NULL };
+  static const char *const k_other[] = {
+    "german", "french", "spanish", "italian", "portuguese", "dutch", "russian", "arabic",
+    "chinese", "korean", "japanese", ".ger.", ".fre.", ".spa.", ".ita.", ".por.", ".rus.", NULL
+  };
+  static const char *const k_partial[] = { "forced", "commentary", "signs", NULL };
+  static const char *const k_hearing[] = { "sdh", ".hi.", "hearing", NULL };
+  static const char *const k_later_part[] = { "cd2", "cd3", "part2", "part 2", NULL };
+
+  int score = 0;
+  if (name_has(lower, k_english)) score += 40;
+  if (name_has(lower, k_other)) score -= 60;
+  if (name_has(lower, k_partial)) score -= 80;
+  if (name_has(lower, k_hearing)) score -= 5;
+  if (name_has(lower, k_later_part)) score -= 30;
+  return score;
+}
+
+char *subs_extract_srt(const void *zip, size_t zip_len, size_t *out_len,
+                       char *name_out, size_t name_outsz) {
+  if (out_len) *out_len = 0;
+
+  ZipArchive z;
+  if (!zip_open_mem(&z, zip, zip_len)) return NULL;
+
+  /* Try entries best-first, so a corrupt favourite falls back to the next one. */
+  bool *tried = (bool *)calloc(z.count ? z.count : 1, sizeof(bool));
+  if (!tried) die("OOM");
+
+  char *out = NULL;
+  for (;;) {
+    const ZipEntry *best = NULL;
+    size_t best_i = 0;
+    int best_score = 0;
+    for (size_t i = 0; i < z.count; i++) {
+      if (tried[i]) continue;
+      int sc = srt_entry_score(&z.entries[i]);
+      if (sc <= -1000) continue;
+      if (!best || sc > best_score || (sc == best_score && z.entries[i].usize > best->usize)) {
+        best = &z.entries[i];
+        best_i = i;
+        best_score = sc;
+      }
+    }
+    if (!best) break;
+    tried[best_i] = true;
+
+    out = zip_extract(&z, best, out_len);
+    if (out) {
+      if (name_out && name_outsz) {
+        size_t n = best->name_len < name_outsz - 1 ? best->name_len : name_outsz - 1;
+        memcpy(name_out, best->name, n);
+        name_out[n] = 0;
+      }
+      break;
+    }
+  }
+
+  free(tried);
+  zip_close(&z);
+  return out;
+}
+
+/* ------------------------ cached download ------------------------ */
+
+static void known_done(FetchGroup *g, FetchJob *job) {
+  SubsRun *run = (SubsRun *)job->user;
+  (void)g;
+  note_job(run, job);
+  if (!job->ok) {
+    logi("subtitles: cached download %s no longer works (HTTP %ld)", job->url, job->code);
+    return;
+  }
+  offer(run, "cache", job->url, job->body, job->len, run->src->known_fmt);
+}
+
+static bool known_enabled(const SubsSources *src) {
+  return src->known_url && src->known_url[0];
+}
+
+static void known_start(SubsRun *run) {
+  FetchJob *j = fetch_get(run->g, run->src->known_url, known_done, run, 0);
+  fetch_job_policy(j, &HTTP_POLICY_DOWNLOAD);
+}
+
+/* ------------------------ driver ------------------------ */
+
+static const SubsProvider k_providers[] = {
+  { "cache",         known_enabled,    known_start },
+  { "subf2m",        subf2m_enabled,   subf2m_start },
+  { "opensubtitles", opensubs_enabled, opensubs_start },
+};
+
+bool subs_fetch(const SubsSources *src, const char *title, const char *slug,
+                SubsAcceptFn accept, void *user, SubsResult *res) {
+  SubsRun *run = (SubsRun *)calloc(1, sizeof(*run));
+  if (!run) die("OOM");
+  run->src = src;
+  run->title = title;
+  run->slug = slug;
+  run->accept = accept;
+  run->user = user;
+  run->g = fetch_group_new();
+
+  int started = 0;
+  for (size_t i = 0; i < sizeof(k_providers) / sizeof(k_providers[0]); i++) {
+    if (!k_providers[i].enabled(src)) continue;
+    k_providers[i].start(run);
+    started++;
+  }
+
+  if (started > 0) fetch_group_run(run->g);
+
+  bool won = run->won;
+  fetch_group_free(run->g);
+  if (!won) note_failure(run, 0, started ? "no usable subtitle found" : "no subtitle providers configured");
+  if (res) *res = run->result;
+  free(run);
+  return won;
+}
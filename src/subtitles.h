@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Subtitle acquisition across several providers at once. Every enabled
+// provider starts its lookup concurrently (subf2m also fans out over uploader
+// profiles); the first download the caller accepts wins and everything still
+// in flight is cancelled.
+
+typedef enum {
+  SUBS_FMT_ZIP = 0,         // archive that should contain an .srt
+  SUBS_FMT_SRT              // plain SRT text
+} SubsFormat;
+
+// Called for each downloaded candidate. Return true to accept it (the caller
+// has stored a valid SRT) and end the search.
+typedef bool (*SubsAcceptFn)(void *user, const char *provider,
+                             const char *data, size_t len, SubsFormat fmt);
+
+typedef struct {
+  const char *subf2m_base;          // scheme://host, no trailing slash
+  const char *opensubtitles_base;
+  const char *opensubtitles_key;    // OpenSubtitles is skipped when empty
+
+  // Download that resolved on an earlier run (lookup cache); raced against
+  // the providers when set.
+  const char *known_url;
+  SubsFormat known_fmt;
+} SubsSources;
+
+typedef struct {
+  char provider[32];        // winner, or empty
+  char url[1024];           // accepted download
+  SubsFormat fmt;
+  long http_code;           // on failure: status of the first lookup that failed, else 0
+  char reason[128];         // on failure
+  bool transient;           // some step timed out or hit a server error, so a
+                            // miss is not a definite answer
+} SubsResult;
+
+// slug is the subf2m title slug; title is used for free-text search.
+// res (optional) describes the outcome for the lookup cache.
+bool subs_fetch(const SubsSources *src, const char *title, const char *slug,
+                SubsAcceptFn accept, void *user, SubsResult *res);
+
+// Picks the best .srt entry of a zip held in memory (English over other
+// languages, full subtitles over forced/commentary tracks, then the largest)
+// and returns its text, NUL-terminated and owned by the caller. The chosen
+// entry name is copied to name_out when given. NULL if there is no usable SRT.
+char *subs_extract_srt(const void *zip, size_t zip_len, size_t *out_len,
+                       char *name_out, size_t name_outsz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,375 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "textproc.h"
+#include "fileview.h"
+#include "log.h"
+
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+  #define TEXTPROC_X86_SIMD 1
+  #include <emmintrin.h>
+#else
+  #define TEXTPROC_X86_SIMD 0
+#endif
+
+#if TEXTPROC_X86_SIMD && (defined(__GNUC__) || defined(__clang__))
+  #define TEXTPROC_HAVE_AVX2 1
+  #include <immintrin.h>
+#else
+  #define TEXTPROC_HAVE_AVX2 0
+#endif
+
+static int timestamp_to_seconds(const char *ts) {
+  int hh = 0, mm = 0, ss = 0, ms = 0;
+  if (sscanf(ts, "%d:%d:%d,%d", &hh, &mm, &ss, &ms) != 4) return -1;
+  (void)ms;
+  return hh * 3600 + mm * 60 + ss;
+}
+
+/* Writes [p, end) with every "<i>" / "</i>" removed. */
+static void put_without_italics(FILE *out, const char *p, const char *end) {
+  while (p < end) {
+    const char *lt = (const char *)memchr(p, '<', (size_t)(end - p));
+    if (!lt) break;
+    size_t tag = 0;
+    if (end - lt >= 3 && memcmp(lt, "<i>", 3) == 0) tag = 3;
+    else if (end - lt >= 4 && memcmp(lt, "</i>", 4) == 0) tag = 4;
+    if (!tag) {
+      fwrite(p, 1, (size_t)(lt - p) + 1, out);
+      p = lt + 1;
+      continue;
+    }
+    fwrite(p, 1, (size_t)(lt - p), out);
+    p = lt + tag;
+  }
+  if (p < end) fwrite(p, 1, (size_t)(end - p), out);
+}
+
+/* Only lines holding "-->" can be cue timings; they are short, so they are
+   parsed from a small copy. Everything else is streamed out of the view. */
+static void convert_srt_line(FILE *out, const char *p, const char *end) {
+  char line[4096];
+  size_t n = (size_t)(end - p);
+  if (n >= sizeof(line) || !memchr(p, '>', n)) {
+    put_without_italics(out, p, end);
+    return;
+  }
+
+  size_t j = 0;
+  for (size_t i = 0; i < n;) {
+    if (n - i >= 3 && memcmp(p + i, "<i>", 3) == 0) { i += 3; continue; }
+    if (n - i >= 4 && memcmp(p + i, "</i>", 4) == 0) { i += 4; continue; }
+    line[j++] = p[i++];
+  }
+  line[j] = 0;
+
+  char a[64], b[64];
+  if (sscanf(line, "%63s --> %63s", a, b) == 2 && strchr(a, ':') && strchr(b, ':')) {
+    int s1 = timestamp_to_seconds(a);
+    int s2 = timestamp_to_seconds(b);
+    if (s1 >= 0 && s2 >= 0) {
+      fprintf(out, "%d --> %d\n", s1, s2);
+      return;
+    }
+  }
+  fwrite(line, 1, j, out);
+}
+
+bool convert_srt_timestamps_to_seconds(const char *input_srt, const char *output_srt) {
+  FileView in;
+  if (!file_view_open(&in, input_srt)) return false;
+  FILE *out = fopen(output_srt, "wb");
+  if (!out) {
+    file_view_close(&in);
+    return false;
+  }
+
+  const char *p = in.data, *end = in.data + in.len;
+  while (p < end) {
+    const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+    const char *eol = nl ? nl + 1 : end;
+    convert_srt_line(out, p, eol);
+    p = eol;
+  }
+
+  bool ok = !ferror(out);
+  if (fclose(out) != 0) ok = false;
+  file_view_close(&in);
+  return ok;
+}
+
+char *strcasestr_local(const char *haystack, const char *needle) {
+  if (!haystack || !needle) return NULL;
+  if (*needle == '\0') return (char *)haystack;
+
+  for (const char *h = haystack; *h; h++) {
+    const char *h2 = h;
+    const char *n2 = needle;
+    while (*h2 && *n2 &&
+           tolower((unsigned char)*h2) == tolower((unsigned char)*n2)) {
+      h2++;
+      n2++;
+    }
+    if (*n2 == '\0') return (char *)h;
+  }
+  return NULL;
+}
+
+/* Tiny string builder */
+void sb_append(char **buf, size_t *len, size_t *cap, const char *s, size_t n) {
+  if (*len + n + 1 > *cap) {
+    *cap = (*cap == 0) ? 8192 : (*cap * 2);
+    while (*len + n + 1 > *cap) *cap *= 2;
+    *buf = (char *)realloc(*buf, *cap);
+    if (!*buf) die("OOM");
+  }
+  memcpy(*buf + *len, s, n);
+  *len += n;
+  (*buf)[*len] = 0;
+}
+
+/* Very simple HTML->text: strips tags, preserves <br> as newline, decodes a few entities */
+char *html_to_text_basic(const char *html, size_t n, size_t *out_n) {
+  char *out = NULL;
+  size_t len = 0, cap = 0;
+
+  for (size_t i = 0; i < n;) {
+    if (html[i] == '<') {
+      size_t j = i + 1;
+      while (j < n && isspace((unsigned char)html[j])) j++;
+      if (j + 1 < n &&
+          tolower((unsigned char)html[j]) == 'b' &&
+          tolower((unsigned char)html[j + 1]) == 'r') {
+        sb_append(&out, &len, &cap, "\n", 1);
+      }
+      while (i < n && html[i] != '>') i++;
+      if (i < n) i++;
+      continue;
+    }
+
+    if (html[i] == '&') {
+      const char *p = html + i;
+      if (i + 6 <= n && !strncmp(p, "&nbsp;", 6)) { sb_append(&out, &len, &cap, " ", 1); i += 6; continue; }
+      if (i + 5 <= n && !strncmp(p, "&amp;", 5))  { sb_append(&out, &len, &cap, "&", 1); i += 5; continue; }
+      if (i + 4 <= n && !strncmp(p, "&lt;", 4))   { sb_append(&out, &len, &cap, "<", 1); i += 4; continue; }
+      if (i + 4 <= n && !strncmp(p, "&gt;", 4))   { sb_append(&out, &len, &cap, ">", 1); i += 4; continue; }
+    }
+
+    sb_append(&out, &len, &cap, &html[i], 1);
+    i++;
+  }
+
+  if (!out) out = strdup("");
+  if (out_n) *out_n = len;
+  return out;
+}
+
+/* ----------------------- UTF-8 validation / repair ----------------------- */
+
+/* Length of the leading run of ASCII bytes. The vector variants test a whole
+   16/32-byte block with one movemask; the portable one tests 8 bytes per step. */
+typedef size_t (*AsciiPrefixFn)(const unsigned char *s, size_t n);
+
+static size_t ascii_prefix_scalar(const unsigned char *s, size_t n) {
+  size_t i = 0;
+  while (i + 8 <= n) {
+    uint64_t w;
+    memcpy(&w, s + i, 8);
+    if (w & UINT64_C(0x8080808080808080)) break;
+    i += 8;
+  }
+  while (i < n && s[i] < 0x80) i++;
+  return i;
+}
+
+#if TEXTPROC_X86_SIMD
+static size_t ascii_prefix_sse2(const unsigned char *s, size_t n) {
+  size_t i = 0;
+  while (i + 16 <= n) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    if (_mm_movemask_epi8(v)) break;
+    i += 16;
+  }
+  while (i < n && s[i] < 0x80) i++;
+  return i;
+}
+#endif
+
+#if TEXTPROC_HAVE_AVX2
+__attribute__((target("avx2")))
+static size_t ascii_prefix_avx2(const unsigned char *s, size_t n) {
+  size_t i = 0;
+  while (i + 64 <= n) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(s + i + 32));
+    if (_mm256_movemask_epi8(_mm256_or_si256(a, b))) break;
+    i += 64;
+  }
+  while (i + 32 <= n) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+    if (_mm256_movemask_epi8(v)) break;
+    i += 32;
+  }
+  while (i < n && s[i] < 0x80) i++;
+  return i;
+}
+#endif
+
+static _Atomic(AsciiPrefixFn) g_ascii_prefix = NULL;
+static const char *g_simd_level = "scalar";
+
+/* Picks the widest ASCII scanner the CPU supports. TEXTPROC_SIMD=scalar|sse2|avx2
+   caps the choice, which the micro-benchmark uses to compare paths. */
+static AsciiPrefixFn ascii_prefix_fn(void) {
+  AsciiPrefixFn fn = atomic_load_explicit(&g_ascii_prefix, memory_order_acquire);
+  if (fn) return fn;
+
+  const char *want = getenv("TEXTPROC_SIMD");
+  fn = ascii_prefix_scalar;
+  const char *level = "scalar";
+#if TEXTPROC_X86_SIMD
+  if (!want || strcmp(want, "scalar") != 0) {
+    fn = ascii_prefix_sse2;
+    level = "sse2";
+  }
+#endif
+#if TEXTPROC_HAVE_AVX2
+  if ((!want || strcmp(want, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+    fn = ascii_prefix_avx2;
+    level = "avx2";
+  }
+#endif
+  (void)want;
+  g_simd_level = level;
+  atomic_store_explicit(&g_ascii_prefix, fn, memory_order_release);
+  return fn;
+}
+
+const char *textproc_simd_level(void) {
+  (void)ascii_prefix_fn();
+  return g_simd_level;
+}
+
+/* Length of the well-formed UTF-8 sequence at s[0], or 0 if it is invalid or
+   truncated. Same acceptance rules as before: no overlongs, no surrogates,
+   nothing above U+10FFFF. */
+static size_t utf8_seq_len(const unsigned char *s, size_t n) {
+  unsigned char c = s[0];
+  if (c < 0x80) return 1;
+
+  if (c >= 0xC2 && c <= 0xDF) {
+    if (n >= 2 && (s[1] & 0xC0) == 0x80) return 2;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    if (n >= 3 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80) {
+      if (c == 0xE0 && s[1] < 0xA0) return 0;
+      if (c == 0xED && s[1] >= 0xA0) return 0;
+      return 3;
+    }
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    if (n >= 4 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80) {
+      if (c == 0xF0 && s[1] < 0x90) return 0;
+      if (c == 0xF4 && s[1] > 0x8F) return 0;
+      return 4;
+    }
+  }
+  return 0;
+}
+
+/* Bytes of s that form valid UTF-8 before the first invalid sequence. ASCII
+   stretches go through the vector scanner; only multi-byte sequences are
+   decoded one at a time. */
+static size_t utf8_valid_prefix(const unsigned char *s, size_t n) {
+  AsciiPrefixFn ascii = ascii_prefix_fn();
+  size_t i = 0;
+  while (i < n) {
+    i += ascii(s + i, n - i);
+    while (i < n && s[i] >= 0x80) {
+      size_t k = utf8_seq_len(s + i, n - i);
+      if (k == 0) return i;
+      i += k;
+    }
+  }
+  return n;
+}
+
+size_t utf8_valid_prefix_len(const char *s, size_t n) {
+  return utf8_valid_prefix((const unsigned char *)s, n);
+}
+
+char *sanitize_utf8_lossy_n(const char *in, size_t n, size_t *out_n) {
+  const unsigned char *s = (const unsigned char *)(in ? in : "");
+  if (!in) n = 0;
+
+  /* Common case: already valid, so one scan and one memcpy. */
+  size_t first_bad = utf8_valid_prefix(s, n);
+  if (first_bad == n) {
+    char *out = (char *)malloc(n + 1);
+    if (!out) die("OOM");
+    memcpy(out, s, n);
+    out[n] = 0;
+    if (out_n) *out_n = n;
+    return out;
+  }
+
+  /* Sizing pass: each stray byte becomes a 2-byte Latin-1 code point. */
+  size_t total = first_bad;
+  for (size_t i = first_bad; i < n;) {
+    total += 2;
+    i++;
+    size_t run = utf8_valid_prefix(s + i, n - i);
+    total += run;
+    i += run;
+  }
+
+  char *out = (char *)malloc(total + 1);
+  if (!out) die("OOM");
+
+  memcpy(out, s, first_bad);
+  size_t j = first_bad;
+  for (size_t i = first_bad; i < n;) {
+    unsigned char c = s[i++];
+    if (c < 0xC0) {
+      out[j++] = (char)0xC2;
+      out[j++] = (char)c;
+    } else {
+      out[j++] = (char)0xC3;
+      out[j++] = (char)(c - 0x40);
+    }
+    size_t run = utf8_valid_prefix(s + i, n - i);
+    memcpy(out + j, s + i, run);
+    j += run;
+    i += run;
+  }
+
+  out[j] = 0;
+  if (out_n) *out_n = j;
+  return out;
+}
+
+char *sanitize_utf8_lossy(const char *in) {
+  if (!in) return strdup("");
+  return sanitize_utf8_lossy_n(in, strlen(in), NULL);
+}
+
+char *trim_copy_utf8_safe(const char *s, size_t max_bytes) {
+  if (!s) return strdup("");
+  size_t n = strlen(s);
+  if (n <= max_bytes) return strdup(s);
+
+  size_t cut = max_bytes;
+  if (cut >= n) cut = n;
+
+  while (cut > 0 && cut < n && (((unsigned char)s[cut] & 0xC0) == 0x80)) cut--;
+
+  char *out = (char *)malloc(cut + 1);
+  if (!out) die("OOM");
+  memcpy(out, s, cut);
+  out[cut] = 0;
+  return out;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Text helpers used on whole subtitle/script/page buffers.
+
+// Rewrites "HH:MM:SS,mmm --> HH:MM:SS,mmm" cue lines as whole seconds and strips <i> tags.
+bool convert_srt_timestamps_to_seconds(const char *input_srt, const char *output_srt);
+
+char *strcasestr_local(const char *haystack, const char *needle);
+
+// Appends n bytes to a growable NUL-terminated buffer.
+void sb_append(char **buf, size_t *len, size_t *cap, const char *s, size_t n);
+
+// Very simple HTML->text: strips tags, keeps <br> as newline, decodes a few entities.
+char *html_to_text_basic(const char *html, size_t n, size_t *out_n);
+
+// Copies input as valid UTF-8; stray bytes are re-encoded as Latin-1 code points.
+// The output is sized exactly; valid runs are found with an SSE2/AVX2 ASCII scan
+// (picked at runtime) and copied in bulk.
+char *sanitize_utf8_lossy(const char *in);
+char *sanitize_utf8_lossy_n(const char *in, size_t n, size_t *out_n);
+
+// Bytes of s that form valid UTF-8 before the first invalid or truncated sequence.
+size_t utf8_valid_prefix_len(const char *s, size_t n);
+
+// "avx2", "sse2" or "scalar": the UTF-8 scanner selected for this CPU.
+const char *textproc_simd_level(void);
+
+// Copies at most max_bytes without splitting a UTF-8 sequence.
+char *trim_copy_utf8_safe(const char *s, size_t max_bytes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,141 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "zipread.h"
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#define ZIP_SIG_LOCAL   0x04034b50u
+#define ZIP_SIG_CENTRAL 0x02014b50u
+#define ZIP_SIG_EOCD    0x06054b50u
+
+#define ZIP_EOCD_SIZE 22
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_MAX_ENTRY (64u * 1024u * 1024u)
+
+static uint16_t rd16(const unsigned char *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* The end-of-central-directory record sits in the last 64 KB + 22 bytes
+   (its trailing comment is at most 65535 bytes). */
+static const unsigned char *find_eocd(const unsigned char *d, size_t len) {
+  if (len < ZIP_EOCD_SIZE) return NULL;
+  size_t stop = len > ZIP_EOCD_SIZE + 65535 ? len - ZIP_EOCD_SIZE - 65535 : 0;
+  for (size_t i = len - ZIP_EOCD_SIZE + 1; i-- > stop;) {
+    if (rd32(d + i) == ZIP_SIG_EOCD) return d + i;
+  }
+  return NULL;
+}
+
+bool zip_open_mem(ZipArchive *z, const void *data, size_t len) {
+  memset(z, 0, sizeof(*z));
+  const unsigned char *d = (const unsigned char *)data;
+
+  const unsigned char *eocd = find_eocd(d, len);
+  if (!eocd) return false;
+
+  uint16_t total = rd16(eocd + 10);
+  uint32_t cd_size = rd32(eocd + 12);
+  uint32_t cd_off = rd32(eocd + 16);
+  if (total == 0xFFFF || cd_off == 0xFFFFFFFFu) return false;   /* zip64 */
+  if ((size_t)cd_off + cd_size > len) return false;
+
+  ZipEntry *entries = total ? (ZipEntry *)calloc(total, sizeof(*entries)) : NULL;
+  if (total && !entries) die("OOM");
+
+  const unsigned char *p = d + cd_off;
+  const unsigned char *end = p + cd_size;
+  size_t n = 0;
+
+  while (n < total && p + ZIP_CENTRAL_SIZE <= end && rd32(p) == ZIP_SIG_CENTRAL) {
+    uint16_t name_len = rd16(p + 28);
+    uint16_t extra_len = rd16(p + 30);
+    uint16_t comment_len = rd16(p + 32);
+    if (p + ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len > end) break;
+
+    ZipEntry *e = &entries[n++];
+    e->flags = rd16(p + 8);
+    e->method = rd16(p + 10);
+    e->crc = rd32(p + 16);
+    e->csize = rd32(p + 20);
+    e->usize = rd32(p + 24);
+    e->local_off = rd32(p + 42);
+    e->name = (const char *)(p + ZIP_CENTRAL_SIZE);
+    e->name_len = name_len;
+
+    p += ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len;
+  }
+
+  z->data = d;
+  z->len = len;
+  z->entries = entries;
+  z->count = n;
+  return true;
+}
+
+static bool inflate_raw(const unsigned char *src, size_t srclen, unsigned char *dst, size_t dstlen) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) return false;
+
+  zs.next_in = (Bytef *)src;
+  zs.avail_in = (uInt)srclen;
+  zs.next_out = (Bytef *)dst;
+  zs.avail_out = (uInt)dstlen;
+
+  int rc = inflate(&zs, Z_FINISH);
+  bool ok = (rc == Z_STREAM_END && zs.total_out == dstlen);
+  inflateEnd(&zs);
+  return ok;
+}
+
+char *zip_extract(const ZipArchive *z, const ZipEntry *e, size_t *out_len) {
+  if (out_len) *out_len = 0;
+  if (e->flags & 0x1) return NULL;                        /* encrypted */
+  if (e->method != 0 && e->method != 8) return NULL;
+  if (e->usize > ZIP_MAX_ENTRY) return NULL;
+
+  /* Sizes come from the central directory; the local header only tells us
+     where the data starts (its own sizes may be zero with a data descriptor). */
+  size_t lo = e->local_off;
+  if (lo + ZIP_LOCAL_SIZE > z->len || rd32(z->data + lo) != ZIP_SIG_LOCAL) return NULL;
+  size_t data_off = lo + ZIP_LOCAL_SIZE + rd16(z->data + lo + 26) + rd16(z->data + lo + 28);
+  if (data_off > z->len || e->csize > z->len - data_off) return NULL;
+  const unsigned char *src = z->data + data_off;
+
+  char *out = (char *)malloc((size_t)e->usize + 1);
+  if (!out) die("OOM");
+
+  bool ok;
+  if (e->method == 0) {
+    ok = (e->csize == e->usize);
+    if (ok) memcpy(out, src, e->usize);
+  } else {
+    ok = inflate_raw(src, e->csize, (unsigned char *)out, e->usize);
+  }
+
+  if (ok && crc32(0L, (const Bytef *)out, (uInt)e->usize) != e->crc) ok = false;
+  if (!ok) {
+    free(out);
+    return NULL;
+  }
+
+  out[e->usize] = 0;
+  if (out_len) *out_len = e->usize;
+  return out;
+}
+
+void zip_close(ZipArchive *z) {
+  if (!z) return;
+  free(z->entries);
+  memset(z, 0, sizeof(*z));
+}
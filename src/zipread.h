@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Minimal in-memory zip reader: walks the central directory of a buffer that
+// is already in memory (e.g. a curl download) and inflates single entries.
+// Supports stored and deflate entries; zip64 and encrypted archives are rejected.
+
+typedef struct {
+  const char *name;         // points into the archive, not NUL-terminated
+  size_t name_len;
+  uint16_t method;          // 0 = stored, 8 = deflate
+  uint16_t flags;
+  uint32_t crc;
+  uint32_t csize;
+  uint32_t usize;
+  uint32_t local_off;
+} ZipEntry;
+
+typedef struct {
+  const unsigned char *data;
+  size_t len;
+  ZipEntry *entries;
+  size_t count;
+} ZipArchive;
+
+// The archive borrows data; keep the buffer alive until zip_close().
+bool zip_open_mem(ZipArchive *z, const void *data, size_t len);
+
+// Decompresses one entry and checks its CRC. Returns a NUL-terminated
+// buffer owned by the caller, or NULL on any error.
+char *zip_extract(const ZipArchive *z, const ZipEntry *e, size_t *out_len);
+
+void zip_close(ZipArchive *z);
+
+#ifdef __cplusplus
+}
+#endif